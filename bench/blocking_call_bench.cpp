@@ -0,0 +1,72 @@
+#include "marl_bench.hpp"
+
+#include "marl/blocking_call.hpp"
+#include "marl/wait_group.hpp"
+
+#include <thread>
+
+namespace {
+
+constexpr int kNumCalls = 1000;
+
+/// 旧版blocking_call的实现：每次调用创建一个新线程，并在其上绑定Scheduler
+void callOnNewThread() {
+  marl::WaitGroup wg(1);
+  auto scheduler = marl::Scheduler::get();
+  std::thread thread([&, wg] {
+    scheduler->bind();
+    benchmark::DoNotOptimize(wg);
+    marl::Scheduler::unbind();
+    wg.done();
+  });
+  wg.wait();
+  thread.join();
+}
+
+} // anonymous namespace
+
+/// 每个任务执行一次空的blocking_call()，测试线程池分派调用的开销
+BENCHMARK_DEFINE_F(Schedule, BlockingCall)(benchmark::State &state) {
+  run(state, [&](int num_tasks) {
+    for (auto _ : state) {
+      marl::WaitGroup wg(num_tasks);
+      for (int i = 0; i < num_tasks; ++i) {
+        marl::schedule([wg] {
+          marl::blocking_call([] {});
+          wg.done();
+        });
+      }
+      wg.wait();
+    }
+    auto stats = marl::Scheduler::get()->blockingCallPool()->stats();
+    state.counters["threads_created"] = static_cast<double>(stats.num_threads_created);
+    state.counters["queue_wait_ns"] = static_cast<double>(stats.total_queue_wait.count()) /
+                                      static_cast<double>(std::max<uint64_t>(stats.num_calls, 1));
+    state.counters["exec_ns"] = static_cast<double>(stats.total_exec.count()) /
+                                static_cast<double>(std::max<uint64_t>(stats.num_calls, 1));
+  });
+  state.SetItemsProcessed(state.iterations() * numTasks(state));
+}
+BENCHMARK_REGISTER_F(Schedule, BlockingCall)->Apply([](auto b) {
+  Schedule::args(b, kNumCalls);
+})->UseRealTime();
+
+/// 作为对照，每次调用都创建一个新线程
+BENCHMARK_DEFINE_F(Schedule, BlockingCallNewThread)(benchmark::State &state) {
+  run(state, [&](int num_tasks) {
+    for (auto _ : state) {
+      marl::WaitGroup wg(num_tasks);
+      for (int i = 0; i < num_tasks; ++i) {
+        marl::schedule([wg] {
+          callOnNewThread();
+          wg.done();
+        });
+      }
+      wg.wait();
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * numTasks(state));
+}
+BENCHMARK_REGISTER_F(Schedule, BlockingCallNewThread)->Apply([](auto b) {
+  Schedule::args(b, kNumCalls);
+})->UseRealTime();
@@ -0,0 +1,125 @@
+#include "marl_bench.hpp"
+
+#include "marl/completion.hpp"
+#include "marl/event.hpp"
+#include "marl/wait_group.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int kNumRoundTrips = 1000;
+
+/// 一个外部线程和一个fiber之间来回kNumRoundTrips次：fiber发出请求后挂起，外部线程看到请求后唤醒它\n
+/// Waiter需要提供arm()（在fiber中、发出请求之前调用），wait()和wake()（在外部线程中调用）
+template<typename Waiter>
+void foreignLatency(Schedule &fixture, benchmark::State &state) {
+  fixture.run(state, [&](int) {
+    for (auto _ : state) {
+      std::atomic<int> requested{-1};
+      std::atomic<Waiter *> waiter{nullptr};
+      std::thread foreign([&] {
+        for (int i = 0; i < kNumRoundTrips; ++i) {
+          while (requested.load(std::memory_order_acquire) != i) {
+            std::this_thread::yield();
+          }
+          waiter.load()->wake();
+        }
+      });
+      marl::WaitGroup wg(1);
+      marl::schedule([&, wg] {
+        Waiter w;
+        waiter = &w;
+        for (int i = 0; i < kNumRoundTrips; ++i) {
+          w.arm();
+          requested.store(i, std::memory_order_release);
+          w.wait();
+        }
+        wg.done();
+      });
+      wg.wait();
+      foreign.join();
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * kNumRoundTrips);
+}
+
+/// 由外部线程依次唤醒num_tasks个正在等待的fiber，Waiter的要求同上
+template<typename Waiter>
+void foreignThroughput(Schedule &fixture, benchmark::State &state) {
+  fixture.run(state, [&](int num_tasks) {
+    for (auto _ : state) {
+      std::vector<std::atomic<Waiter *>> waiters(num_tasks);
+      std::atomic<int> num_ready{0};
+      std::thread foreign([&] {
+        while (num_ready.load(std::memory_order_acquire) != num_tasks) {
+          std::this_thread::yield();
+        }
+        for (auto &waiter : waiters) {
+          waiter.load()->wake();
+        }
+      });
+      marl::WaitGroup wg(num_tasks);
+      for (int i = 0; i < num_tasks; ++i) {
+        marl::schedule([&, i, wg] {
+          Waiter w;
+          w.arm();
+          waiters[i] = &w;
+          num_ready.fetch_add(1, std::memory_order_release);
+          w.wait();
+          wg.done();
+        });
+      }
+      wg.wait();
+      foreign.join();
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * Schedule::numTasks(state));
+}
+
+struct CompletionWaiter {
+  void arm() {}
+  void wait() { completion.wait(); }
+  void wake() { completion.post(); }
+  marl::Completion completion;
+};
+
+/// 通过Event::signal()唤醒，内部会获取Event和Worker的锁
+struct EventWaiter {
+  void arm() { event.clear(); }
+  void wait() { event.wait(); }
+  void wake() { event.signal(); }
+  marl::Event event{marl::Event::Mode::Manual};
+};
+
+} // anonymous namespace
+
+BENCHMARK_DEFINE_F(Schedule, ForeignLatencyCompletion)(benchmark::State &state) {
+  foreignLatency<CompletionWaiter>(*this, state);
+}
+BENCHMARK_REGISTER_F(Schedule, ForeignLatencyCompletion)->Apply([](auto b) {
+  Schedule::args(b, 1);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, ForeignLatencyEvent)(benchmark::State &state) {
+  foreignLatency<EventWaiter>(*this, state);
+}
+BENCHMARK_REGISTER_F(Schedule, ForeignLatencyEvent)->Apply([](auto b) {
+  Schedule::args(b, 1);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, ForeignThroughputCompletion)(benchmark::State &state) {
+  foreignThroughput<CompletionWaiter>(*this, state);
+}
+BENCHMARK_REGISTER_F(Schedule, ForeignThroughputCompletion)->Apply([](auto b) {
+  Schedule::args(b, 4096);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, ForeignThroughputEvent)(benchmark::State &state) {
+  foreignThroughput<EventWaiter>(*this, state);
+}
+BENCHMARK_REGISTER_F(Schedule, ForeignThroughputEvent)->Apply([](auto b) {
+  Schedule::args(b, 4096);
+})->UseRealTime();
@@ -0,0 +1,393 @@
+#include "marl_bench.hpp"
+
+#include "marl/dag.hpp"
+#include "marl/wait_group.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int kNumNodes = 50000;
+
+/// DAGMakespan中长链的节点数，独立节点的数量，以及每个节点的执行时间
+constexpr int kChainLength = 32;
+constexpr int kNumShortNodes = 128;
+constexpr auto kNodeDuration = std::chrono::microseconds(50);
+
+/// DAGRuns中每次迭代的运行次数，每次运行的DAG的节点数，以及runAsync()同时进行的运行数
+constexpr int kNumRuns = 100;
+constexpr int kNumRunNodes = 256;
+constexpr int kMaxInFlight = 4;
+
+/// DAGIncremental中被标记的节点与最后一个节点的距离，受影响的节点数不超过该值
+constexpr int kIncrementalDistance = 1000;
+
+/// 随机图中每个节点最多的前置节点数，以及前置节点与当前节点的最大距离
+constexpr int kMaxRandomIns = 3;
+constexpr int kRandomWindow = 64;
+
+using Builder = marl::DAG<std::atomic<uint32_t> &>::Builder;
+using NodeBuilder = marl::DAG<std::atomic<uint32_t> &>::NodeBuilder;
+
+/// 每个节点的工作量都很小，测量的主要是DAG本身的调度开销
+inline void work(std::atomic<uint32_t> &count) {
+  count.fetch_add(1, std::memory_order_relaxed);
+}
+
+/// root -> num_nodes个并行的节点 -> sink
+void buildWide(Builder &builder, int num_nodes) {
+  auto root = builder.root();
+  std::vector<NodeBuilder> nodes;
+  nodes.reserve(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    nodes.push_back(root.then(work));
+  }
+  auto sink = builder.node(work);
+  for (auto &node : nodes) {
+    builder.addDependency(node, sink);
+  }
+}
+
+/// num_nodes个节点组成的链
+void buildDeep(Builder &builder, int num_nodes) {
+  auto node = builder.root();
+  for (int i = 0; i < num_nodes; ++i) {
+    node = node.then(work);
+  }
+}
+
+/// 每个节点随机依赖于它之前kRandomWindow个节点中的至多kMaxRandomIns个节点
+void buildRandom(Builder &builder, int num_nodes, std::vector<NodeBuilder> &nodes) {
+  std::mt19937 rng(12345);
+  nodes.reserve(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    auto node = builder.node(work);
+    if (i == 0) {
+      builder.addDependency(builder.root(), node);
+    } else {
+      auto num_ins = 1 + static_cast<int>(rng() % kMaxRandomIns);
+      for (int j = 0; j < num_ins; ++j) {
+        auto window = std::min(i, kRandomWindow);
+        auto parent = i - 1 - static_cast<int>(rng() % window);
+        builder.addDependency(nodes[parent], node);
+      }
+    }
+    nodes.push_back(node);
+  }
+}
+
+void buildRandom(Builder &builder, int num_nodes) {
+  std::vector<NodeBuilder> nodes;
+  buildRandom(builder, num_nodes, nodes);
+}
+
+template<typename BuildFunc>
+void runDAG(Schedule &fixture, benchmark::State &state, BuildFunc &&build, bool profiling = false) {
+  fixture.run(state, [&](int num_nodes) {
+    Builder builder;
+    build(builder, num_nodes);
+    auto dag = builder.build();
+    dag->setProfiling(profiling);
+    std::atomic<uint32_t> count{0};
+    for (auto _ : state) {
+      dag->run(count);
+    }
+    benchmark::DoNotOptimize(count.load());
+  });
+  state.SetItemsProcessed(state.iterations() * Schedule::numTasks(state));
+}
+
+} // anonymous namespace
+
+BENCHMARK_DEFINE_F(Schedule, DAGWide)(benchmark::State &state) {
+  runDAG(*this, state, buildWide);
+}
+BENCHMARK_REGISTER_F(Schedule, DAGWide)->Apply([](auto b) {
+  Schedule::args(b, kNumNodes);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, DAGDeep)(benchmark::State &state) {
+  runDAG(*this, state, buildDeep);
+}
+BENCHMARK_REGISTER_F(Schedule, DAGDeep)->Apply([](auto b) {
+  Schedule::args(b, kNumNodes);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, DAGRandom)(benchmark::State &state) {
+  runDAG(*this, state, [](Builder &builder, int num_nodes) {
+    buildRandom(builder, num_nodes);
+  });
+}
+BENCHMARK_REGISTER_F(Schedule, DAGRandom)->Apply([](auto b) {
+  Schedule::args(b, kNumNodes);
+})->UseRealTime();
+
+/// 与DAGRandom相同，但是开启了profiling，两者之差为profiling的开销
+BENCHMARK_DEFINE_F(Schedule, DAGRandomProfiled)(benchmark::State &state) {
+  runDAG(*this, state, [](Builder &builder, int num_nodes) {
+    buildRandom(builder, num_nodes);
+  }, true);
+}
+BENCHMARK_REGISTER_F(Schedule, DAGRandomProfiled)->Apply([](auto b) {
+  Schedule::args(b, kNumNodes);
+})->UseRealTime();
+
+/// 与DAGRandom相同的图，但是每次只标记一个靠近末尾的节点，以增量模式运行\n
+/// 运行的开销只与受影响的节点数（affected_nodes）有关，而与图的大小无关
+BENCHMARK_DEFINE_F(Schedule, DAGIncremental)(benchmark::State &state) {
+  uint32_t affected = 0;
+  run(state, [&](int num_nodes) {
+    Builder builder;
+    std::vector<NodeBuilder> nodes;
+    buildRandom(builder, num_nodes, nodes);
+    auto dag = builder.build();
+    dag->setIncremental(true);
+    std::atomic<uint32_t> count{0};
+    dag->run(count);
+    auto dirty = nodes[num_nodes - kIncrementalDistance];
+    for (auto _ : state) {
+      count = 0;
+      dag->markDirty(dirty);
+      dag->run(count);
+    }
+    affected = count.load();
+  });
+  state.counters["affected_nodes"] = affected;
+}
+BENCHMARK_REGISTER_F(Schedule, DAGIncremental)->Apply([](auto b) {
+  Schedule::args(b, kNumNodes);
+})->UseRealTime();
+
+/// 一个kNumRunNodes个节点的随机图被反复运行num_tasks次，items_per_second为每秒的运行次数
+BENCHMARK_DEFINE_F(Schedule, DAGRuns)(benchmark::State &state) {
+  run(state, [&](int num_runs) {
+    Builder builder;
+    buildRandom(builder, kNumRunNodes);
+    auto dag = builder.build();
+    std::atomic<uint32_t> count{0};
+    for (auto _ : state) {
+      for (int i = 0; i < num_runs; ++i) {
+        dag->run(count);
+      }
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * numTasks(state));
+}
+BENCHMARK_REGISTER_F(Schedule, DAGRuns)->Apply([](auto b) {
+  Schedule::args(b, kNumRuns);
+})->UseRealTime();
+
+/// 与DAGRuns相同，但是通过runAsync()使最多kMaxInFlight次运行同时进行
+BENCHMARK_DEFINE_F(Schedule, DAGRunsAsync)(benchmark::State &state) {
+  run(state, [&](int num_runs) {
+    Builder builder;
+    buildRandom(builder, kNumRunNodes);
+    auto dag = builder.build();
+    dag->setMaxInFlight(kMaxInFlight);
+    std::atomic<uint32_t> count{0};
+    for (auto _ : state) {
+      std::deque<marl::DAG<std::atomic<uint32_t> &>::RunHandle> handles;
+      for (int i = 0; i < num_runs; ++i) {
+        handles.push_back(dag->runAsync(count));
+      }
+      for (auto &handle : handles) {
+        handle.wait();
+      }
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * numTasks(state));
+}
+BENCHMARK_REGISTER_F(Schedule, DAGRunsAsync)->Apply([](auto b) {
+  Schedule::args(b, kNumRuns);
+})->UseRealTime();
+
+namespace {
+
+/// 忙等待kNodeDuration，模拟一个开销固定的节点
+inline void spin(std::atomic<uint32_t> &count) {
+  auto end = std::chrono::steady_clock::now() + kNodeDuration;
+  while (std::chrono::steady_clock::now() < end) {}
+  count.fetch_add(1, std::memory_order_relaxed);
+}
+
+/// 不平衡的图：root之后是一条kChainLength个节点的长链和kNumShortNodes个独立的节点，最后汇合到sink
+/// chain_first决定长链在root的后置节点中排在前面还是后面
+void buildUnbalanced(Builder &builder, bool chain_first) {
+  auto root = builder.root();
+  auto sink = builder.node(work);
+  auto add_chain = [&] {
+    auto node = root;
+    for (int i = 0; i < kChainLength; ++i) {
+      node = node.then(spin);
+    }
+    builder.addDependency(node, sink);
+  };
+  if (chain_first) {
+    add_chain();
+  }
+  for (int i = 0; i < kNumShortNodes; ++i) {
+    builder.addDependency(root.then(spin), sink);
+  }
+  if (!chain_first) {
+    add_chain();
+  }
+}
+
+void runMakespan(Schedule &fixture, benchmark::State &state, bool chain_first) {
+  fixture.run(state, [&](int) {
+    Builder builder;
+    buildUnbalanced(builder, chain_first);
+    auto dag = builder.build();
+    std::atomic<uint32_t> count{0};
+    for (auto _ : state) {
+      dag->run(count);
+    }
+  });
+  // 关键路径的长度，makespan的下限
+  state.counters["critical_path_ms"] =
+      std::chrono::duration<double, std::milli>(kNodeDuration * kChainLength).count();
+}
+
+} // anonymous namespace
+
+/// 不平衡的图运行一次所需的时间（makespan），长链会优先开始执行，与它被添加的顺序无关
+BENCHMARK_DEFINE_F(Schedule, DAGMakespanChainFirst)(benchmark::State &state) {
+  runMakespan(*this, state, true);
+}
+BENCHMARK_REGISTER_F(Schedule, DAGMakespanChainFirst)->Apply([](auto b) {
+  Schedule::args(b, kChainLength + kNumShortNodes);
+})->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_DEFINE_F(Schedule, DAGMakespanChainLast)(benchmark::State &state) {
+  runMakespan(*this, state, false);
+}
+BENCHMARK_REGISTER_F(Schedule, DAGMakespanChainLast)->Apply([](auto b) {
+  Schedule::args(b, kChainLength + kNumShortNodes);
+})->UseRealTime()->Unit(benchmark::kMillisecond);
+
+namespace {
+
+/// DAGSpawn中递归派生出的叶子任务数，必须是2的幂
+constexpr int kNumSpawnLeaves = 1 << 14;
+
+using VoidDAG = marl::DAG<>;
+
+/// 通过DAGSpawner递归地二分派生子任务，不会阻塞任何fiber
+void spawnTree(VoidDAG::Spawner spawner, int leaves, std::atomic<uint32_t> &count) {
+  if (leaves == 1) {
+    work(count);
+    return;
+  }
+  for (int i = 0; i < 2; ++i) {
+    spawner.spawn([spawner, leaves, &count] { spawnTree(spawner, leaves / 2, count); });
+  }
+}
+
+/// 手动的方式：每一层都通过marl::schedule()调度子任务，然后在WaitGroup上阻塞等待
+void scheduleTree(int leaves, std::atomic<uint32_t> &count) {
+  if (leaves == 1) {
+    work(count);
+    return;
+  }
+  marl::WaitGroup wg(2);
+  for (int i = 0; i < 2; ++i) {
+    marl::schedule([wg, leaves, &count] {
+      scheduleTree(leaves / 2, count);
+      wg.done();
+    });
+  }
+  wg.wait();
+}
+
+} // anonymous namespace
+
+/// root -> 动态节点（递归派生num_tasks个叶子任务） -> sink
+BENCHMARK_DEFINE_F(Schedule, DAGSpawnRecursive)(benchmark::State &state) {
+  std::atomic<uint32_t> count{0};
+  run(state, [&](int num_leaves) {
+    VoidDAG::Builder builder;
+    builder.root()
+        .thenDynamic([&](VoidDAG::Spawner spawner) { spawnTree(spawner, num_leaves, count); })
+        .then([&] { benchmark::DoNotOptimize(count.load()); });
+    auto dag = builder.build();
+    for (auto _ : state) {
+      dag->run();
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * numTasks(state));
+}
+BENCHMARK_REGISTER_F(Schedule, DAGSpawnRecursive)->Apply([](auto b) {
+  Schedule::args(b, kNumSpawnLeaves);
+})->UseRealTime();
+
+/// 与DAGSpawnRecursive相同的图，但是节点内部以marl::schedule()和WaitGroup手动派生并等待
+BENCHMARK_DEFINE_F(Schedule, DAGSpawnManual)(benchmark::State &state) {
+  std::atomic<uint32_t> count{0};
+  run(state, [&](int num_leaves) {
+    VoidDAG::Builder builder;
+    builder.root()
+        .then([&] { scheduleTree(num_leaves, count); })
+        .then([&] { benchmark::DoNotOptimize(count.load()); });
+    auto dag = builder.build();
+    for (auto _ : state) {
+      dag->run();
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * numTasks(state));
+}
+BENCHMARK_REGISTER_F(Schedule, DAGSpawnManual)->Apply([](auto b) {
+  Schedule::args(b, kNumSpawnLeaves);
+})->UseRealTime();
+
+namespace {
+
+/// DAGTransform中每个并行块的元素数
+constexpr size_t kTransformGrain = 16384;
+
+/// 一个开销较大的逐元素变换
+inline void transform(std::vector<float> &data, size_t begin, size_t end) {
+  for (auto i = begin; i < end; ++i) {
+    data[i] = data[i] * 0.5f + 1.0f;
+  }
+}
+
+/// root -> 对num_elements个元素的变换 -> sink，parallel决定变换是普通节点还是并行节点
+void runTransform(Schedule &fixture, benchmark::State &state, bool parallel) {
+  fixture.run(state, [&](int num_elements) {
+    auto count = static_cast<size_t>(num_elements);
+    marl::DAG<std::vector<float> &>::Builder builder;
+    auto root = builder.root();
+    auto node = parallel
+        ? root.thenParallel(count, kTransformGrain, transform)
+        : root.then([count](std::vector<float> &data) { transform(data, 0, count); });
+    node.then([](std::vector<float> &data) { benchmark::DoNotOptimize(data[0]); });
+    auto dag = builder.build();
+    std::vector<float> data(count, 1.0f);
+    for (auto _ : state) {
+      dag->run(data);
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * Schedule::numTasks(state));
+}
+
+} // anonymous namespace
+
+/// 单个节点串行完成整个变换，其他Worker空闲
+BENCHMARK_DEFINE_F(Schedule, DAGTransformSerial)(benchmark::State &state) {
+  runTransform(*this, state, false);
+}
+BENCHMARK_REGISTER_F(Schedule, DAGTransformSerial)->Apply([](auto b) {
+  Schedule::args(b, 1 << 22);
+})->UseRealTime();
+
+/// 并行节点将变换按kTransformGrain分块，分配给所有的Worker
+BENCHMARK_DEFINE_F(Schedule, DAGTransformParallel)(benchmark::State &state) {
+  runTransform(*this, state, true);
+}
+BENCHMARK_REGISTER_F(Schedule, DAGTransformParallel)->Apply([](auto b) {
+  Schedule::args(b, 1 << 22);
+})->UseRealTime();
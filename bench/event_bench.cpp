@@ -0,0 +1,67 @@
+#include "marl_bench.hpp"
+
+#include "marl/event.hpp"
+#include "marl/wait_group.hpp"
+
+namespace {
+
+/// 不需要Scheduler的轮询测试，可以通过ThreadRange测试多个线程同时轮询同一个Event的开销
+marl::Event &pollingEvent(marl::Event::Mode mode) {
+  static marl::Event manual(marl::Event::Mode::Manual);
+  static marl::Event automatic(marl::Event::Mode::Auto);
+  return mode == marl::Event::Mode::Manual ? manual : automatic;
+}
+
+} // anonymous namespace
+
+static void Event_IsSignalled(benchmark::State &state) {
+  auto &event = pollingEvent(marl::Event::Mode::Manual);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(event.isSignalled());
+  }
+}
+BENCHMARK(Event_IsSignalled)->ThreadRange(1, 8);
+
+static void Event_TestAuto(benchmark::State &state) {
+  auto &event = pollingEvent(marl::Event::Mode::Auto);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(event.test());
+  }
+}
+BENCHMARK(Event_TestAuto)->ThreadRange(1, 8);
+
+static void Event_SignalNoWaiters(benchmark::State &state) {
+  marl::Event event(marl::Event::Mode::Auto);
+  for (auto _ : state) {
+    event.signal();
+    benchmark::DoNotOptimize(event.test());
+  }
+}
+BENCHMARK(Event_SignalNoWaiters);
+
+/// 两个任务通过一对Auto模式的Event交替唤醒对方，任务数为往返的次数
+BENCHMARK_DEFINE_F(Schedule, Event_PingPong)(benchmark::State &state) {
+  run(state, [&](int num_round_trips) {
+    for (auto _ : state) {
+      marl::Event ping(marl::Event::Mode::Auto);
+      marl::Event pong(marl::Event::Mode::Auto);
+      marl::WaitGroup wg(1);
+      marl::schedule([=] {
+        for (int i = 0; i < num_round_trips; ++i) {
+          ping.wait();
+          pong.signal();
+        }
+        wg.done();
+      });
+      for (int i = 0; i < num_round_trips; ++i) {
+        ping.signal();
+        pong.wait();
+      }
+      wg.wait();
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * Schedule::numTasks(state));
+}
+BENCHMARK_REGISTER_F(Schedule, Event_PingPong)->Apply([](auto b) {
+  Schedule::args(b, 10000);
+})->UseRealTime();
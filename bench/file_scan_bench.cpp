@@ -0,0 +1,114 @@
+#include "marl_bench.hpp"
+
+#include "marl/file_scan.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t kFileSize = 256 * 1024 * 1024;
+constexpr size_t kReadBufferSize = 1024 * 1024;
+
+/// 创建一个kFileSize大小的、由长度不等的日志行组成的临时文件，析构时删除
+class LogFile {
+ public:
+  LogFile() {
+    char path[] = "/tmp/marl_file_scan_bench_XXXXXX";
+    fd_ = mkstemp(path);
+    unlink(path);
+    std::string block;
+    for (size_t i = 0; block.size() < kReadBufferSize; ++i) {
+      block += "2024-01-01T00:00:00 INFO request " + std::to_string(i) + " " +
+          std::string(i % 97, 'x') + "\n";
+    }
+    for (size_t offset = 0; offset < kFileSize; offset += block.size()) {
+      if (pwrite(fd_, block.data(), block.size(), static_cast<off_t>(offset)) < 0) {
+        break;
+      }
+    }
+  }
+  ~LogFile() { close(fd_); }
+
+  [[nodiscard]] int fd() const { return fd_; }
+
+ private:
+  int fd_;
+};
+
+/// 逐行处理：统计行数以及包含'9'的行数，代表一个简单的过滤
+struct LineCounts {
+  size_t lines = 0;
+  size_t matches = 0;
+
+  void add(std::string_view line) {
+    ++lines;
+    if (line.find('9') != std::string_view::npos) {
+      ++matches;
+    }
+  }
+};
+
+LineCounts countLines(const char *data, size_t size) {
+  LineCounts counts;
+  marl::FileChunk chunk;
+  chunk.data = data;
+  chunk.size = size;
+  chunk.forEachRecord([&](std::string_view line) { counts.add(line); });
+  return counts;
+}
+
+} // anonymous namespace
+
+BENCHMARK_DEFINE_F(Schedule, FileScan)(benchmark::State &state) {
+  LogFile file;
+  marl::MappedFile mapped;
+  mapped.map(file.fd());
+  run(state, [&](int) {
+    for (auto _ : state) {
+      LineCounts total;
+      marl::scanFile(mapped, [](const marl::FileChunk &chunk) {
+        return countLines(chunk.data, chunk.size);
+      }, [&](LineCounts &&counts) {
+        total.lines += counts.lines;
+        total.matches += counts.matches;
+      });
+      benchmark::DoNotOptimize(total);
+    }
+  });
+  state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(mapped.size()));
+}
+BENCHMARK_REGISTER_F(Schedule, FileScan)->Apply([](auto b) {
+  Schedule::args(b, 0);
+})->UseRealTime();
+
+/// 对照组：在调用者的线程上用read()顺序读取，不完整的最后一行留到下一次读取
+static void FileScanSingleThreadRead(benchmark::State &state) {
+  LogFile file;
+  std::vector<char> buffer(kReadBufferSize);
+  for (auto _ : state) {
+    LineCounts total;
+    size_t carry = 0;
+    off_t offset = 0;
+    ssize_t n;
+    while ((n = pread(file.fd(), buffer.data() + carry, buffer.size() - carry, offset)) > 0) {
+      offset += n;
+      auto size = carry + static_cast<size_t>(n);
+      auto last = static_cast<const char *>(memrchr(buffer.data(), '\n', size));
+      auto complete = last != nullptr ? static_cast<size_t>(last - buffer.data()) + 1 : 0;
+      auto counts = countLines(buffer.data(), complete);
+      total.lines += counts.lines;
+      total.matches += counts.matches;
+      carry = size - complete;
+      memmove(buffer.data(), buffer.data() + complete, carry);
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(kFileSize));
+}
+BENCHMARK(FileScanSingleThreadRead)->UseRealTime();
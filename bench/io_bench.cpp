@@ -0,0 +1,124 @@
+#include "marl_bench.hpp"
+
+#include "marl/blocking_call.hpp"
+#include "marl/io.hpp"
+#include "marl/wait_group.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+constexpr int kNumReads = 4096;
+constexpr size_t kBlockSize = 4096;
+constexpr size_t kFileSize = 16 * 1024 * 1024;
+constexpr int kBatchSize = 32;
+
+/// 创建一个kFileSize大小的临时文件，析构时删除
+class BenchFile {
+ public:
+  BenchFile() {
+    char path[] = "/tmp/marl_io_bench_XXXXXX";
+    fd_ = mkstemp(path);
+    unlink(path);
+    std::vector<char> block(kBlockSize, 'x');
+    for (size_t offset = 0; offset < kFileSize; offset += kBlockSize) {
+      if (pwrite(fd_, block.data(), block.size(), static_cast<off_t>(offset)) < 0) {
+        break;
+      }
+    }
+  }
+  ~BenchFile() { close(fd_); }
+
+  [[nodiscard]] int fd() const { return fd_; }
+
+ private:
+  int fd_;
+};
+
+inline off_t blockOffset(int i) {
+  constexpr size_t kNumBlocks = kFileSize / kBlockSize;
+  return static_cast<off_t>(((static_cast<size_t>(i) * 7919) % kNumBlocks) * kBlockSize);
+}
+
+/// 每个任务读取一个4KB的块，read决定具体的读取方式
+template<typename Read>
+void randomReads(Schedule &fixture, benchmark::State &state, marl::Scheduler::Config cfg, Read &&read) {
+  BenchFile file;
+  fixture.run(state, cfg, [&](int num_tasks) {
+    for (auto _ : state) {
+      marl::WaitGroup wg(num_tasks);
+      for (int i = 0; i < num_tasks; ++i) {
+        marl::schedule([&, i, wg] {
+          char buf[kBlockSize];
+          read(file.fd(), buf, blockOffset(i));
+          wg.done();
+        });
+      }
+      wg.wait();
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * Schedule::numTasks(state));
+  state.SetBytesProcessed(state.iterations() * Schedule::numTasks(state) * kBlockSize);
+}
+
+} // anonymous namespace
+
+BENCHMARK_DEFINE_F(Schedule, IoRead)(benchmark::State &state) {
+  randomReads(*this, state, marl::Scheduler::Config(), [](int fd, char *buf, off_t offset) {
+    marl::io::read(fd, buf, kBlockSize, offset);
+  });
+}
+BENCHMARK_REGISTER_F(Schedule, IoRead)->Apply([](auto b) {
+  Schedule::args(b, kNumReads);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, IoReadFallback)(benchmark::State &state) {
+  randomReads(*this, state, marl::Scheduler::Config().setUseIoUring(false), [](int fd, char *buf, off_t offset) {
+    marl::io::read(fd, buf, kBlockSize, offset);
+  });
+}
+BENCHMARK_REGISTER_F(Schedule, IoReadFallback)->Apply([](auto b) {
+  Schedule::args(b, kNumReads);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, IoReadBlockingCall)(benchmark::State &state) {
+  randomReads(*this, state, marl::Scheduler::Config(), [](int fd, char *buf, off_t offset) {
+    marl::blocking_call([=] { return pread(fd, buf, kBlockSize, offset); });
+  });
+}
+BENCHMARK_REGISTER_F(Schedule, IoReadBlockingCall)->Apply([](auto b) {
+  Schedule::args(b, kNumReads);
+})->UseRealTime();
+
+/// 每个任务通过一次submit()读取kBatchSize个块
+BENCHMARK_DEFINE_F(Schedule, IoReadBatched)(benchmark::State &state) {
+  BenchFile file;
+  run(state, [&](int num_tasks) {
+    auto num_batches = num_tasks / kBatchSize;
+    for (auto _ : state) {
+      marl::WaitGroup wg(num_batches);
+      for (int b = 0; b < num_batches; ++b) {
+        marl::schedule([&, b, wg] {
+          std::vector<char> buf(kBatchSize * kBlockSize);
+          marl::io::Request requests[kBatchSize];
+          for (int i = 0; i < kBatchSize; ++i) {
+            requests[i] = marl::io::Request::read(file.fd(), buf.data() + i * kBlockSize,
+                                                  kBlockSize, blockOffset(b * kBatchSize + i));
+          }
+          marl::io::submit(requests, kBatchSize);
+          wg.done();
+        });
+      }
+      wg.wait();
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * numTasks(state));
+  state.SetBytesProcessed(state.iterations() * numTasks(state) * kBlockSize);
+}
+BENCHMARK_REGISTER_F(Schedule, IoReadBatched)->Apply([](auto b) {
+  Schedule::args(b, kNumReads);
+})->UseRealTime();
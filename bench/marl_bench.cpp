@@ -0,0 +1,29 @@
+#include "marl_bench.hpp"
+
+void Schedule::args(benchmark::internal::Benchmark *b, int num_tasks) {
+  b->ArgNames({"threads", "tasks"});
+  for (int threads = 1; threads <= 64; threads <<= 1) {
+    b->Args({threads, num_tasks});
+  }
+}
+
+void Schedule::args(benchmark::internal::Benchmark *b) {
+  b->ArgNames({"threads", "tasks"});
+  for (int threads = 1; threads <= 64; threads <<= 1) {
+    for (int tasks = 1; tasks <= 0x10000; tasks <<= 4) {
+      b->Args({threads, tasks});
+    }
+  }
+}
+
+uint32_t Schedule::doSomeWork(uint32_t x) {
+  uint32_t q = x;
+  for (uint32_t i = 0; i < 100000; ++i) {
+    x = (x << 4) | x;
+    x = x | 0x1020;
+    x = (x >> 2) & q;
+  }
+  return x;
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,51 @@
+#ifndef MINIMARL_BENCH_MARL_BENCH_HPP_
+#define MINIMARL_BENCH_MARL_BENCH_HPP_
+
+#include "benchmark/benchmark.h"
+
+#include "marl/scheduler.hpp"
+
+/// 所有需要绑定Scheduler的benchmark的基类
+/// benchmark的第0个参数为工作线程数，第1个参数为任务数
+class Schedule : public benchmark::Fixture {
+ public:
+  void SetUp(const benchmark::State &) override {}
+  void TearDown(const benchmark::State &) override {}
+
+  /// 以cfg创建一个Scheduler，工作线程数由benchmark参数决定，绑定Scheduler后以任务数为参数调用f
+  /// f结束后，解绑并销毁Scheduler
+  template<typename F>
+  void run(const benchmark::State &state,
+           marl::Scheduler::Config cfg,
+           F &&f) {
+    cfg.setWorkerThreadCount(numThreads(state));
+    marl::Scheduler scheduler(cfg);
+    scheduler.bind();
+    f(numTasks(state));
+    scheduler.unbind();
+  }
+
+  template<typename F>
+  void run(const benchmark::State &state, F &&f) {
+    run(state, marl::Scheduler::Config(), std::forward<F>(f));
+  }
+
+  /// 设置工作线程数为[1, 64]，任务数为numTasks
+  static void args(benchmark::internal::Benchmark *b, int num_tasks);
+
+  /// 设置工作线程数为[1, 64]，任务数为[1, 64K]
+  static void args(benchmark::internal::Benchmark *b);
+
+  static inline int numThreads(const benchmark::State &state) {
+    return static_cast<int>(state.range(0));
+  }
+
+  static inline int numTasks(const benchmark::State &state) {
+    return static_cast<int>(state.range(1));
+  }
+
+  /// 执行一段CPU密集的计算，用于模拟任务的工作量
+  static uint32_t doSomeWork(uint32_t x);
+};
+
+#endif //MINIMARL_BENCH_MARL_BENCH_HPP_
@@ -0,0 +1,117 @@
+#include "marl_bench.hpp"
+
+#include "marl/parallel_for.hpp"
+#include "marl/wait_group.hpp"
+
+#include <atomic>
+
+namespace {
+
+constexpr int kNumElements = 1 << 16;
+
+/// 每个元素的基本工作量（迭代次数），以及skewed负载中开销较大的元素的倍数和比例
+constexpr uint32_t kUnitWork = 64;
+constexpr uint32_t kSkewFactor = 32;
+constexpr int kSkewFraction = 16;
+
+/// 执行units个单位的工作量
+inline uint32_t spin(uint32_t x, uint32_t units) {
+  for (uint32_t i = 0; i < units * kUnitWork; ++i) {
+    x = x * 1664525u + 1013904223u;
+  }
+  return x;
+}
+
+/// uniform负载中每个元素的工作量相同
+inline uint32_t uniformCost(size_t) {
+  return 1;
+}
+
+/// skewed负载中前1/kSkewFraction的元素的工作量是其他元素的kSkewFactor倍
+inline uint32_t skewedCost(size_t i, size_t n) {
+  return i < n / kSkewFraction ? kSkewFactor : 1;
+}
+
+/// 静态分块：将范围平均分为工作线程数 + 1块，调用者执行其中一块
+template<typename F>
+void staticChunks(size_t n, int num_threads, F &&f) {
+  auto num_chunks = static_cast<size_t>(num_threads) + 1;
+  marl::WaitGroup wg(num_threads);
+  auto chunk = [&](size_t c) {
+    for (auto i = n * c / num_chunks, end = n * (c + 1) / num_chunks; i < end; ++i) {
+      f(i);
+    }
+  };
+  for (size_t c = 1; c < num_chunks; ++c) {
+    marl::schedule([&, c, wg] {
+      chunk(c);
+      wg.done();
+    });
+  }
+  chunk(0);
+  wg.wait();
+}
+
+template<typename Cost>
+void runParallelFor(Schedule &fixture, benchmark::State &state, Cost &&cost) {
+  fixture.run(state, [&](int num_elements) {
+    auto n = static_cast<size_t>(num_elements);
+    std::atomic<uint32_t> sink{0};
+    for (auto _ : state) {
+      marl::parallel_for(0, n, [&](size_t i) {
+        sink.fetch_add(spin(static_cast<uint32_t>(i), cost(i, n)), std::memory_order_relaxed);
+      });
+    }
+    benchmark::DoNotOptimize(sink.load());
+  });
+  state.SetItemsProcessed(state.iterations() * Schedule::numTasks(state));
+}
+
+template<typename Cost>
+void runStaticChunks(Schedule &fixture, benchmark::State &state, Cost &&cost) {
+  fixture.run(state, [&](int num_elements) {
+    auto n = static_cast<size_t>(num_elements);
+    std::atomic<uint32_t> sink{0};
+    for (auto _ : state) {
+      staticChunks(n, Schedule::numThreads(state), [&](size_t i) {
+        sink.fetch_add(spin(static_cast<uint32_t>(i), cost(i, n)), std::memory_order_relaxed);
+      });
+    }
+    benchmark::DoNotOptimize(sink.load());
+  });
+  state.SetItemsProcessed(state.iterations() * Schedule::numTasks(state));
+}
+
+auto uniform = [](size_t i, size_t) { return uniformCost(i); };
+auto skewed = [](size_t i, size_t n) { return skewedCost(i, n); };
+
+} // anonymous namespace
+
+BENCHMARK_DEFINE_F(Schedule, ParallelForUniform)(benchmark::State &state) {
+  runParallelFor(*this, state, uniform);
+}
+BENCHMARK_REGISTER_F(Schedule, ParallelForUniform)->Apply([](auto b) {
+  Schedule::args(b, kNumElements);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, StaticChunksUniform)(benchmark::State &state) {
+  runStaticChunks(*this, state, uniform);
+}
+BENCHMARK_REGISTER_F(Schedule, StaticChunksUniform)->Apply([](auto b) {
+  Schedule::args(b, kNumElements);
+})->UseRealTime();
+
+/// 前1/kSkewFraction的元素占了大部分的工作量，静态分块时第一块决定了总时间
+BENCHMARK_DEFINE_F(Schedule, ParallelForSkewed)(benchmark::State &state) {
+  runParallelFor(*this, state, skewed);
+}
+BENCHMARK_REGISTER_F(Schedule, ParallelForSkewed)->Apply([](auto b) {
+  Schedule::args(b, kNumElements);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, StaticChunksSkewed)(benchmark::State &state) {
+  runStaticChunks(*this, state, skewed);
+}
+BENCHMARK_REGISTER_F(Schedule, StaticChunksSkewed)->Apply([](auto b) {
+  Schedule::args(b, kNumElements);
+})->UseRealTime();
@@ -0,0 +1,121 @@
+#include "marl_bench.hpp"
+
+#include "marl/parallel_for.hpp"
+#include "marl/parallel_reduce.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+/// 求和的元素个数
+constexpr size_t kSumElements = 100 * 1000 * 1000;
+
+/// 直方图的元素个数和桶数
+constexpr size_t kHistogramElements = 1 << 24;
+constexpr size_t kHistogramBins = 256;
+
+using Histogram = std::array<uint64_t, kHistogramBins>;
+
+/// 元素的值由下标算出，避免100M元素的输入占用大量内存，使测试的是归约本身而不是内存带宽
+inline uint32_t value(size_t i) {
+  return static_cast<uint32_t>(i * 2654435761u) >> 7;
+}
+
+inline size_t bin(size_t i) {
+  return value(i) % kHistogramBins;
+}
+
+auto add = [](uint64_t a, uint64_t b) { return a + b; };
+
+Histogram mergeHistograms(const Histogram &a, const Histogram &b) {
+  Histogram res;
+  for (size_t i = 0; i < kHistogramBins; ++i) {
+    res[i] = a[i] + b[i];
+  }
+  return res;
+}
+
+} // anonymous namespace
+
+BENCHMARK_DEFINE_F(Schedule, ReduceSum)(benchmark::State &state) {
+  run(state, [&](int) {
+    for (auto _ : state) {
+      auto sum = marl::parallel_reduce(0, kSumElements, uint64_t(0), [](size_t i) {
+        return uint64_t(value(i));
+      }, add);
+      benchmark::DoNotOptimize(sum);
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * kSumElements);
+}
+BENCHMARK_REGISTER_F(Schedule, ReduceSum)->Apply([](auto b) {
+  Schedule::args(b, static_cast<int>(kSumElements));
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, ReduceSumDeterministic)(benchmark::State &state) {
+  run(state, [&](int) {
+    for (auto _ : state) {
+      auto sum = marl::parallel_reduce(0, kSumElements, uint64_t(0), [](size_t i) {
+        return uint64_t(value(i));
+      }, add, marl::ReduceMode::Deterministic);
+      benchmark::DoNotOptimize(sum);
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * kSumElements);
+}
+BENCHMARK_REGISTER_F(Schedule, ReduceSumDeterministic)->Apply([](auto b) {
+  Schedule::args(b, static_cast<int>(kSumElements));
+})->UseRealTime();
+
+/// 对照组：所有任务的每一块都累加到同一个原子变量中
+BENCHMARK_DEFINE_F(Schedule, ReduceSumAtomic)(benchmark::State &state) {
+  run(state, [&](int) {
+    for (auto _ : state) {
+      std::atomic<uint64_t> sum{0};
+      marl::parallel_for(0, kSumElements, [&](size_t i) {
+        sum.fetch_add(value(i), std::memory_order_relaxed);
+      });
+      benchmark::DoNotOptimize(sum.load());
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * kSumElements);
+}
+BENCHMARK_REGISTER_F(Schedule, ReduceSumAtomic)->Apply([](auto b) {
+  Schedule::args(b, static_cast<int>(kSumElements));
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, ReduceHistogram)(benchmark::State &state) {
+  run(state, [&](int) {
+    Histogram empty = {};
+    for (auto _ : state) {
+      auto histogram = marl::parallel_reduce(0, kHistogramElements, empty, [](Histogram &acc, size_t i) {
+        ++acc[bin(i)];
+      }, mergeHistograms);
+      benchmark::DoNotOptimize(histogram);
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * kHistogramElements);
+}
+BENCHMARK_REGISTER_F(Schedule, ReduceHistogram)->Apply([](auto b) {
+  Schedule::args(b, static_cast<int>(kHistogramElements));
+})->UseRealTime();
+
+/// 对照组：所有任务共享一组原子的桶
+BENCHMARK_DEFINE_F(Schedule, ReduceHistogramAtomic)(benchmark::State &state) {
+  run(state, [&](int) {
+    for (auto _ : state) {
+      std::array<std::atomic<uint64_t>, kHistogramBins> histogram = {};
+      marl::parallel_for(0, kHistogramElements, [&](size_t i) {
+        histogram[bin(i)].fetch_add(1, std::memory_order_relaxed);
+      });
+      benchmark::DoNotOptimize(histogram);
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * kHistogramElements);
+}
+BENCHMARK_REGISTER_F(Schedule, ReduceHistogramAtomic)->Apply([](auto b) {
+  Schedule::args(b, static_cast<int>(kHistogramElements));
+})->UseRealTime();
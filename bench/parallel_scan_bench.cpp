@@ -0,0 +1,50 @@
+#include "marl_bench.hpp"
+
+#include "marl/parallel_scan.hpp"
+
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+constexpr int kNumElements = 1 << 24;
+
+std::vector<uint32_t> makeInput(size_t n) {
+  std::vector<uint32_t> in(n);
+  for (size_t i = 0; i < n; ++i) {
+    in[i] = static_cast<uint32_t>(i * 2654435761u) >> 24;
+  }
+  return in;
+}
+
+auto add = [](uint32_t a, uint32_t b) { return a + b; };
+
+} // anonymous namespace
+
+BENCHMARK_DEFINE_F(Schedule, ParallelScan)(benchmark::State &state) {
+  run(state, [&](int num_elements) {
+    auto in = makeInput(static_cast<size_t>(num_elements));
+    std::vector<uint32_t> out(in.size());
+    for (auto _ : state) {
+      marl::parallel_scan(in.begin(), in.end(), out.begin(), uint32_t(0), add);
+      benchmark::DoNotOptimize(out.data());
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * Schedule::numTasks(state));
+}
+BENCHMARK_REGISTER_F(Schedule, ParallelScan)->Apply([](auto b) {
+  Schedule::args(b, kNumElements);
+})->UseRealTime();
+
+/// 对照组：在调用者的线程上顺序扫描
+static void SerialScan(benchmark::State &state) {
+  auto in = makeInput(static_cast<size_t>(state.range(0)));
+  std::vector<uint32_t> out(in.size());
+  for (auto _ : state) {
+    std::inclusive_scan(in.begin(), in.end(), out.begin(), add);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(SerialScan)->Arg(kNumElements)->UseRealTime();
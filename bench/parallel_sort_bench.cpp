@@ -0,0 +1,129 @@
+#include "marl_bench.hpp"
+
+#include "marl/parallel_sort.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int kNumKeys = 1 << 22;
+
+/// skewed输入中，大部分键集中在kSkewHotKeys个值上
+constexpr uint32_t kSkewHotKeys = 16;
+constexpr int kSkewHotFraction = 8;
+
+enum class Input { Random, Sorted, Skewed };
+
+std::vector<uint32_t> makeKeys(size_t n, Input input) {
+  std::mt19937 rng(42);
+  std::vector<uint32_t> keys(n);
+  for (size_t i = 0; i < n; ++i) {
+    switch (input) {
+      case Input::Random:
+        keys[i] = rng();
+        break;
+      case Input::Sorted:
+        keys[i] = static_cast<uint32_t>(i);
+        break;
+      case Input::Skewed:
+        // 每kSkewHotFraction个键中只有一个是随机的，其余来自少数几个热点值
+        keys[i] = rng() % kSkewHotFraction == 0 ? rng() : (rng() % kSkewHotKeys) * 1000003u;
+        break;
+    }
+  }
+  return keys;
+}
+
+/// 每次迭代之前恢复未排序的输入，恢复的时间不计入结果
+template<typename Sort>
+void runSort(benchmark::State &state, const std::vector<uint32_t> &input, Sort &&sort) {
+  auto keys = input;
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::copy(input.begin(), input.end(), keys.begin());
+    state.ResumeTiming();
+    sort(keys);
+    benchmark::DoNotOptimize(keys.data());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(input.size()));
+}
+
+/// 整数键走基数排序
+void parallelRadix(std::vector<uint32_t> &keys) {
+  marl::parallel_sort(keys.begin(), keys.end());
+}
+
+/// 指定比较函数时走归并排序
+void parallelMerge(std::vector<uint32_t> &keys) {
+  marl::parallel_sort(keys.begin(), keys.end(), std::less<>());
+}
+
+void stdSort(std::vector<uint32_t> &keys) {
+  std::sort(keys.begin(), keys.end());
+}
+
+template<typename Sort>
+void runParallelSort(Schedule &fixture, benchmark::State &state, Input input, Sort &&sort) {
+  fixture.run(state, [&](int num_keys) {
+    runSort(state, makeKeys(static_cast<size_t>(num_keys), input), sort);
+  });
+}
+
+} // anonymous namespace
+
+BENCHMARK_DEFINE_F(Schedule, ParallelRadixSortRandom)(benchmark::State &state) {
+  runParallelSort(*this, state, Input::Random, parallelRadix);
+}
+BENCHMARK_REGISTER_F(Schedule, ParallelRadixSortRandom)->Apply([](auto b) {
+  Schedule::args(b, kNumKeys);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, ParallelRadixSortSorted)(benchmark::State &state) {
+  runParallelSort(*this, state, Input::Sorted, parallelRadix);
+}
+BENCHMARK_REGISTER_F(Schedule, ParallelRadixSortSorted)->Apply([](auto b) {
+  Schedule::args(b, kNumKeys);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, ParallelRadixSortSkewed)(benchmark::State &state) {
+  runParallelSort(*this, state, Input::Skewed, parallelRadix);
+}
+BENCHMARK_REGISTER_F(Schedule, ParallelRadixSortSkewed)->Apply([](auto b) {
+  Schedule::args(b, kNumKeys);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, ParallelMergeSortRandom)(benchmark::State &state) {
+  runParallelSort(*this, state, Input::Random, parallelMerge);
+}
+BENCHMARK_REGISTER_F(Schedule, ParallelMergeSortRandom)->Apply([](auto b) {
+  Schedule::args(b, kNumKeys);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, ParallelMergeSortSorted)(benchmark::State &state) {
+  runParallelSort(*this, state, Input::Sorted, parallelMerge);
+}
+BENCHMARK_REGISTER_F(Schedule, ParallelMergeSortSorted)->Apply([](auto b) {
+  Schedule::args(b, kNumKeys);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, ParallelMergeSortSkewed)(benchmark::State &state) {
+  runParallelSort(*this, state, Input::Skewed, parallelMerge);
+}
+BENCHMARK_REGISTER_F(Schedule, ParallelMergeSortSkewed)->Apply([](auto b) {
+  Schedule::args(b, kNumKeys);
+})->UseRealTime();
+
+/// 对照组：在调用者的线程上使用std::sort()
+static void StdSort(benchmark::State &state) {
+  runSort(state, makeKeys(kNumKeys, static_cast<Input>(state.range(0))), stdSort);
+}
+BENCHMARK(StdSort)
+    ->ArgName("input")
+    ->Arg(static_cast<int>(Input::Random))
+    ->Arg(static_cast<int>(Input::Sorted))
+    ->Arg(static_cast<int>(Input::Skewed))
+    ->UseRealTime();
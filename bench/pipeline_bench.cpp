@@ -0,0 +1,76 @@
+#include "marl_bench.hpp"
+
+#include "marl/pipeline.hpp"
+
+#include <cstdint>
+#include <optional>
+
+namespace {
+
+constexpr int kNumItems = 1 << 14;
+constexpr uint32_t kMaxTokens = 64;
+
+/// 并行阶段中每个数据的工作量（迭代次数），串行阶段只做很少的工作
+constexpr uint32_t kTransformWork = 4096;
+
+inline uint32_t transform(uint32_t x) {
+  for (uint32_t i = 0; i < kTransformWork; ++i) {
+    x = x * 1664525u + 1013904223u;
+  }
+  return x;
+}
+
+/// 源阶段 -> 并行的变换阶段 -> 串行的聚合阶段，并行阶段占了大部分的工作量
+void runPipeline(Schedule &fixture, benchmark::State &state, marl::PipelineOrder order) {
+  fixture.run(state, [&](int num_items) {
+    uint64_t sum = 0;
+    marl::Pipeline pipeline(kMaxTokens, order);
+    int next = 0;
+    pipeline.source([&]() -> std::optional<uint32_t> {
+          if (next == num_items) {
+            return std::nullopt;
+          }
+          return static_cast<uint32_t>(next++);
+        })
+        .then(marl::StageMode::Parallel, [](uint32_t &&x) { return transform(x); })
+        .sink(marl::StageMode::Serial, [&](uint32_t &&x) { sum += x; });
+    for (auto _ : state) {
+      next = 0;
+      pipeline.run();
+    }
+    benchmark::DoNotOptimize(sum);
+    // 串行的聚合阶段的利用率，接近1时说明它成为了瓶颈
+    state.counters["sink_utilization"] = pipeline.stageStats(2).utilization;
+    state.counters["transform_utilization"] = pipeline.stageStats(1).utilization;
+  });
+  state.SetItemsProcessed(state.iterations() * Schedule::numTasks(state));
+}
+
+} // anonymous namespace
+
+BENCHMARK_DEFINE_F(Schedule, PipelineOrdered)(benchmark::State &state) {
+  runPipeline(*this, state, marl::PipelineOrder::Ordered);
+}
+BENCHMARK_REGISTER_F(Schedule, PipelineOrdered)->Apply([](auto b) {
+  Schedule::args(b, kNumItems);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, PipelineUnordered)(benchmark::State &state) {
+  runPipeline(*this, state, marl::PipelineOrder::Unordered);
+}
+BENCHMARK_REGISTER_F(Schedule, PipelineUnordered)->Apply([](auto b) {
+  Schedule::args(b, kNumItems);
+})->UseRealTime();
+
+/// 对照组：在调用者的线程上依次执行所有阶段
+static void PipelineSerialLoop(benchmark::State &state) {
+  uint64_t sum = 0;
+  for (auto _ : state) {
+    for (int n = 0; n < kNumItems; ++n) {
+      sum += transform(static_cast<uint32_t>(n));
+    }
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations() * kNumItems);
+}
+BENCHMARK(PipelineSerialLoop)->UseRealTime();
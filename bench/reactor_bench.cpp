@@ -0,0 +1,75 @@
+#include "marl_bench.hpp"
+
+#include "marl/blocking_call.hpp"
+#include "marl/reactor.hpp"
+#include "marl/wait_group.hpp"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <vector>
+
+namespace {
+
+constexpr int kNumRoundTrips = 64;
+/// 使用blocking_call()时每个等待中的读操作都会占用一个线程，因此不能超过线程池的大小
+constexpr int kNumPairs = 16;
+
+/// 每个任务持有一对socket，和另一个任务在上面来回传递一个字节kNumRoundTrips次\n
+/// nonblocking决定socket是否为非阻塞，read和write决定具体的读写方式
+template<typename Read, typename Write>
+void pingPong(Schedule &fixture, benchmark::State &state, bool nonblocking, Read &&read, Write &&write) {
+  fixture.run(state, [&](int num_pairs) {
+    std::vector<int> fds(2 * num_pairs);
+    auto type = SOCK_STREAM | SOCK_CLOEXEC | (nonblocking ? SOCK_NONBLOCK : 0);
+    for (int i = 0; i < num_pairs; ++i) {
+      socketpair(AF_UNIX, type, 0, &fds[2 * i]);
+    }
+    for (auto _ : state) {
+      marl::WaitGroup wg(2 * num_pairs);
+      for (int i = 0; i < num_pairs; ++i) {
+        marl::schedule([&, i, wg] {
+          char c = 0;
+          for (int n = 0; n < kNumRoundTrips; ++n) {
+            write(fds[2 * i], &c);
+            read(fds[2 * i], &c);
+          }
+          wg.done();
+        });
+        marl::schedule([&, i, wg] {
+          char c = 0;
+          for (int n = 0; n < kNumRoundTrips; ++n) {
+            read(fds[2 * i + 1], &c);
+            write(fds[2 * i + 1], &c);
+          }
+          wg.done();
+        });
+      }
+      wg.wait();
+    }
+    for (auto fd : fds) {
+      close(fd);
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * Schedule::numTasks(state) * kNumRoundTrips);
+}
+
+} // anonymous namespace
+
+BENCHMARK_DEFINE_F(Schedule, NetPingPong)(benchmark::State &state) {
+  pingPong(*this, state, true,
+           [](int fd, char *c) { marl::net::read(fd, c, 1); },
+           [](int fd, char *c) { marl::net::write(fd, c, 1); });
+}
+BENCHMARK_REGISTER_F(Schedule, NetPingPong)->Apply([](auto b) {
+  Schedule::args(b, kNumPairs);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, NetPingPongBlockingCall)(benchmark::State &state) {
+  pingPong(*this, state, false,
+           [](int fd, char *c) { marl::blocking_call([=] { return ::read(fd, c, 1); }); },
+           [](int fd, char *c) { marl::blocking_call([=] { return ::write(fd, c, 1); }); });
+}
+BENCHMARK_REGISTER_F(Schedule, NetPingPongBlockingCall)->Apply([](auto b) {
+  Schedule::args(b, kNumPairs);
+})->UseRealTime();
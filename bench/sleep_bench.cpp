@@ -0,0 +1,74 @@
+#include "marl_bench.hpp"
+
+#include "marl/sleep.hpp"
+#include "marl/wait_group.hpp"
+
+#include <chrono>
+
+namespace {
+
+constexpr int kNumSleepers = 100000;
+constexpr int kNumOtherTasks = 1000;
+constexpr auto kSleepDuration = std::chrono::seconds(2);
+
+/// 不使用保护页分配fiber的栈\n
+/// 每个带保护页的栈会占用多个内存映射，10万个fiber会超过vm.max_map_count的限制
+class NoGuardsAllocator : public marl::Allocator {
+ public:
+  marl::Allocation allocate(const marl::Allocation::Request &request) override {
+    auto unguarded = request;
+    unguarded.use_guards = false;
+    auto allocation = marl::Allocator::Default->allocate(unguarded);
+    allocation.request = request;
+    return allocation;
+  }
+
+  void free(const marl::Allocation &allocation) override {
+    auto unguarded = allocation;
+    unguarded.request.use_guards = false;
+    marl::Allocator::Default->free(unguarded);
+  }
+};
+
+} // anonymous namespace
+
+/// num_tasks个fiber同时休眠kSleepDuration，所有fiber都进入休眠之后再调度kNumOtherTasks个普通任务\n
+/// other_tasks_ms为普通任务全部完成所需的时间，远小于kSleepDuration说明工作线程没有被休眠的fiber占用
+BENCHMARK_DEFINE_F(Schedule, SleepFor)(benchmark::State &state) {
+  NoGuardsAllocator allocator;
+  auto cfg = marl::Scheduler::Config()
+      .setAllocator(&allocator)
+      .setFiberStackSize(32 * 1024);
+  double other_tasks_ms = 0;
+  run(state, cfg, [&](int num_tasks) {
+    for (auto _ : state) {
+      marl::WaitGroup asleep(num_tasks);
+      marl::WaitGroup sleepers(num_tasks);
+      for (int i = 0; i < num_tasks; ++i) {
+        marl::schedule([asleep, sleepers] {
+          asleep.done();
+          marl::sleep_for(kSleepDuration);
+          sleepers.done();
+        });
+      }
+      // 等到所有的fiber都开始休眠后再调度普通任务
+      asleep.wait();
+
+      auto start = std::chrono::steady_clock::now();
+      marl::WaitGroup others(kNumOtherTasks);
+      for (int i = 0; i < kNumOtherTasks; ++i) {
+        marl::schedule([others] { others.done(); });
+      }
+      others.wait();
+      other_tasks_ms += std::chrono::duration<double, std::milli>(
+          std::chrono::steady_clock::now() - start).count();
+
+      sleepers.wait();
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * numTasks(state));
+  state.counters["other_tasks_ms"] = other_tasks_ms / static_cast<double>(state.iterations());
+}
+BENCHMARK_REGISTER_F(Schedule, SleepFor)->Apply([](auto b) {
+  Schedule::args(b, kNumSleepers);
+})->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,160 @@
+#include "marl_bench.hpp"
+
+#include "marl/task_group.hpp"
+#include "marl/wait_group.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int kFibN = 35;
+
+/// 不超过该值的fib()直接递归计算，使每个子任务都有一定的工作量
+constexpr int kFibCutoff = 12;
+
+constexpr int kNumKeys = 1 << 22;
+
+/// 不超过该长度的子序列直接使用std::sort()
+constexpr ptrdiff_t kSortCutoff = 4096;
+
+uint64_t fibSerial(int n) {
+  return n < 2 ? static_cast<uint64_t>(n) : fibSerial(n - 1) + fibSerial(n - 2);
+}
+
+uint64_t fibTaskGroup(int n) {
+  if (n <= kFibCutoff) {
+    return fibSerial(n);
+  }
+  uint64_t x = 0;
+  marl::TaskGroup group;
+  group.spawn([&] { x = fibTaskGroup(n - 1); });
+  auto y = fibTaskGroup(n - 2);
+  group.sync();
+  return x + y;
+}
+
+/// 对照组：每一层都通过marl::schedule()和WaitGroup派生子任务
+uint64_t fibWaitGroup(int n) {
+  if (n <= kFibCutoff) {
+    return fibSerial(n);
+  }
+  uint64_t x = 0;
+  marl::WaitGroup wg(1);
+  marl::schedule([&x, n, wg] {
+    x = fibWaitGroup(n - 1);
+    wg.done();
+  });
+  auto y = fibWaitGroup(n - 2);
+  wg.wait();
+  return x + y;
+}
+
+/// 以中间元素为枢轴把[first, last)三路划分，返回等于枢轴的部分
+std::pair<uint32_t *, uint32_t *> partition(uint32_t *first, uint32_t *last) {
+  auto pivot = first[(last - first) / 2];
+  auto lt = std::partition(first, last, [pivot](uint32_t x) { return x < pivot; });
+  auto gt = std::partition(lt, last, [pivot](uint32_t x) { return !(pivot < x); });
+  return {lt, gt};
+}
+
+void quicksortTaskGroup(uint32_t *first, uint32_t *last) {
+  if (last - first <= kSortCutoff) {
+    std::sort(first, last);
+    return;
+  }
+  auto [lt, gt] = partition(first, last);
+  marl::TaskGroup group;
+  group.spawn([first, lt = lt] { quicksortTaskGroup(first, lt); });
+  quicksortTaskGroup(gt, last);
+}
+
+void quicksortWaitGroup(uint32_t *first, uint32_t *last) {
+  if (last - first <= kSortCutoff) {
+    std::sort(first, last);
+    return;
+  }
+  auto [lt, gt] = partition(first, last);
+  marl::WaitGroup wg(1);
+  marl::schedule([first, lt = lt, wg] {
+    quicksortWaitGroup(first, lt);
+    wg.done();
+  });
+  quicksortWaitGroup(gt, last);
+  wg.wait();
+}
+
+std::vector<uint32_t> randomKeys() {
+  std::mt19937 rng(42);
+  std::vector<uint32_t> keys(kNumKeys);
+  for (auto &key : keys) {
+    key = rng();
+  }
+  return keys;
+}
+
+template<typename Fib>
+void runFib(Schedule &fixture, benchmark::State &state, Fib &&fib) {
+  fixture.run(state, [&](int n) {
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(fib(n));
+    }
+  });
+}
+
+/// 每次迭代之前恢复未排序的输入，恢复的时间不计入结果
+template<typename Sort>
+void runQuicksort(Schedule &fixture, benchmark::State &state, Sort &&sort) {
+  fixture.run(state, [&](int) {
+    auto input = randomKeys();
+    auto keys = input;
+    for (auto _ : state) {
+      state.PauseTiming();
+      std::copy(input.begin(), input.end(), keys.begin());
+      state.ResumeTiming();
+      sort(keys.data(), keys.data() + keys.size());
+      benchmark::DoNotOptimize(keys.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(input.size()));
+  });
+}
+
+} // anonymous namespace
+
+BENCHMARK_DEFINE_F(Schedule, TaskGroupFib)(benchmark::State &state) {
+  runFib(*this, state, fibTaskGroup);
+}
+BENCHMARK_REGISTER_F(Schedule, TaskGroupFib)->Apply([](auto b) {
+  Schedule::args(b, kFibN);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, WaitGroupFib)(benchmark::State &state) {
+  runFib(*this, state, fibWaitGroup);
+}
+BENCHMARK_REGISTER_F(Schedule, WaitGroupFib)->Apply([](auto b) {
+  Schedule::args(b, kFibN);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, TaskGroupQuicksort)(benchmark::State &state) {
+  runQuicksort(*this, state, quicksortTaskGroup);
+}
+BENCHMARK_REGISTER_F(Schedule, TaskGroupQuicksort)->Apply([](auto b) {
+  Schedule::args(b, kNumKeys);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, WaitGroupQuicksort)(benchmark::State &state) {
+  runQuicksort(*this, state, quicksortWaitGroup);
+}
+BENCHMARK_REGISTER_F(Schedule, WaitGroupQuicksort)->Apply([](auto b) {
+  Schedule::args(b, kNumKeys);
+})->UseRealTime();
+
+/// 对照组：在调用者的线程上串行计算
+static void SerialFib(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(fibSerial(kFibN));
+  }
+}
+BENCHMARK(SerialFib)->UseRealTime();
@@ -0,0 +1,111 @@
+#include "marl_bench.hpp"
+
+#include "marl/wait_group.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+constexpr int kNumTimers = 1000000;
+/// 需要大于插入所有定时任务所需的时间，使定时任务在插入完成之后才开始触发
+constexpr auto kDelay = std::chrono::seconds(2);
+
+/// TimerLateness中测量延迟的定时任务数，以及它们触发时间的间隔
+constexpr int kNumProbes = 1000;
+constexpr auto kProbeInterval = std::chrono::microseconds(100);
+
+} // anonymous namespace
+
+/// 插入num_tasks个在kDelay之后同时到期的定时任务，并等待它们全部执行\n
+/// inserts_per_second为插入定时任务的速度，fires_per_second为从到期到全部执行完的速度
+BENCHMARK_DEFINE_F(Schedule, TimerFire)(benchmark::State &state) {
+  double insert_s = 0, fire_s = 0;
+  run(state, [&](int num_tasks) {
+    auto scheduler = marl::Scheduler::get();
+    for (auto _ : state) {
+      marl::WaitGroup wg(num_tasks);
+      auto start = std::chrono::system_clock::now();
+      auto deadline = start + kDelay;
+      for (int i = 0; i < num_tasks; ++i) {
+        scheduler->enqueueAt(deadline, marl::Task([wg] { wg.done(); }));
+      }
+      insert_s += std::chrono::duration<double>(std::chrono::system_clock::now() - start).count();
+      wg.wait();
+      fire_s += std::chrono::duration<double>(std::chrono::system_clock::now() - deadline).count();
+    }
+  });
+  auto items = static_cast<double>(state.iterations()) * numTasks(state);
+  state.SetItemsProcessed(state.iterations() * numTasks(state));
+  state.counters["inserts_per_second"] = items / insert_s;
+  state.counters["fires_per_second"] = items / fire_s;
+}
+BENCHMARK_REGISTER_F(Schedule, TimerFire)->Apply([](auto b) {
+  Schedule::args(b, kNumTimers);
+})->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/// 在已有num_tasks个一小时之后才触发的定时任务时，
+/// 插入kNumProbes个每隔kProbeInterval触发一次的定时任务，测量它们的实际执行时间晚于触发时间多少\n
+/// late_us_mean和late_us_max为延迟的平均值和最大值
+BENCHMARK_DEFINE_F(Schedule, TimerLateness)(benchmark::State &state) {
+  double late_us_mean = 0, late_us_max = 0;
+  run(state, [&](int num_tasks) {
+    auto scheduler = marl::Scheduler::get();
+    std::vector<marl::Scheduler::Timer> pending(num_tasks);
+    for (auto &timer : pending) {
+      timer = scheduler->enqueueAfter(std::chrono::hours(1), marl::Task([] {}));
+    }
+    std::vector<marl::Scheduler::TimePoint::duration> lateness(kNumProbes);
+    for (auto _ : state) {
+      marl::WaitGroup wg(kNumProbes);
+      auto start = std::chrono::system_clock::now() + std::chrono::milliseconds(10);
+      for (int i = 0; i < kNumProbes; ++i) {
+        auto deadline = start + kProbeInterval * i;
+        scheduler->enqueueAt(deadline, marl::Task([deadline, i, wg, &lateness] {
+          lateness[i] = std::chrono::system_clock::now() - deadline;
+          wg.done();
+        }));
+      }
+      wg.wait();
+
+      marl::Scheduler::TimePoint::duration sum{0};
+      for (auto &late : lateness) {
+        sum += late;
+      }
+      auto max = *std::max_element(lateness.begin(), lateness.end());
+      late_us_mean += std::chrono::duration<double, std::micro>(sum).count() / kNumProbes;
+      late_us_max = std::max(late_us_max, std::chrono::duration<double, std::micro>(max).count());
+    }
+    for (auto &timer : pending) {
+      timer.cancel();
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * kNumProbes);
+  state.counters["late_us_mean"] = late_us_mean / static_cast<double>(state.iterations());
+  state.counters["late_us_max"] = late_us_max;
+}
+BENCHMARK_REGISTER_F(Schedule, TimerLateness)->Apply([](auto b) {
+  Schedule::args(b, kNumTimers);
+})->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/// 插入num_tasks个一小时之后才触发的定时任务，然后全部取消\n
+/// 被取消的定时任务在Scheduler析构时释放
+BENCHMARK_DEFINE_F(Schedule, TimerCancel)(benchmark::State &state) {
+  run(state, [&](int num_tasks) {
+    std::vector<marl::Scheduler::Timer> timers(num_tasks);
+    auto scheduler = marl::Scheduler::get();
+    for (auto _ : state) {
+      for (auto &timer : timers) {
+        timer = scheduler->enqueueAfter(std::chrono::hours(1), marl::Task([] {}));
+      }
+      for (auto &timer : timers) {
+        timer.cancel();
+      }
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * numTasks(state));
+}
+BENCHMARK_REGISTER_F(Schedule, TimerCancel)->Apply([](auto b) {
+  Schedule::args(b, kNumTimers);
+})->UseRealTime()->Unit(benchmark::kMillisecond);
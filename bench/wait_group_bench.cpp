@@ -0,0 +1,39 @@
+#include "marl_bench.hpp"
+
+#include "marl/sharded_wait_group.hpp"
+#include "marl/wait_group.hpp"
+
+namespace {
+
+constexpr int kNumTasks = 100000;
+
+/// 每个任务只调用一次done()，以测试WaitGroup计数器在大量并发done()下的开销
+template<typename WaitGroupT>
+void fanIn(Schedule &fixture, benchmark::State &state) {
+  fixture.run(state, [&](int num_tasks) {
+    for (auto _ : state) {
+      WaitGroupT wg(num_tasks);
+      for (int i = 0; i < num_tasks; ++i) {
+        marl::schedule([wg] { wg.done(); });
+      }
+      wg.wait();
+    }
+  });
+  state.SetItemsProcessed(state.iterations() * Schedule::numTasks(state));
+}
+
+} // anonymous namespace
+
+BENCHMARK_DEFINE_F(Schedule, WaitGroup)(benchmark::State &state) {
+  fanIn<marl::WaitGroup>(*this, state);
+}
+BENCHMARK_REGISTER_F(Schedule, WaitGroup)->Apply([](auto b) {
+  Schedule::args(b, kNumTasks);
+})->UseRealTime();
+
+BENCHMARK_DEFINE_F(Schedule, ShardedWaitGroup)(benchmark::State &state) {
+  fanIn<marl::ShardedWaitGroup>(*this, state);
+}
+BENCHMARK_REGISTER_F(Schedule, ShardedWaitGroup)->Apply([](auto b) {
+  Schedule::args(b, kNumTasks);
+})->UseRealTime();
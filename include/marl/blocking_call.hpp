@@ -1,67 +1,61 @@
 #ifndef MINIMARL_INCLUDE_MARL_BLOCKING_CALL_HPP_
 #define MINIMARL_INCLUDE_MARL_BLOCKING_CALL_HPP_
 
+#include "blocking_call_pool.hpp"
 #include "export.hpp"
 #include "scheduler.hpp"
-#include "wait_group.hpp"
 
 namespace marl {
 namespace detail {
 
-template<typename ReturnType>
-class OnNewThread {
+/// 把一次阻塞调用包装为BlockingCallPool::Job，结果保存在job中
+template<typename ReturnType, typename F>
+class BlockingCallJob : public BlockingCallPool::Job {
  public:
-  template<typename F, typename ...Args>
-  MARL_NO_EXPORT inline static ReturnType call(F &&f, Args &&...args) {
-    ReturnType result;
-    WaitGroup wg(1);
-    auto scheduler = Scheduler::get();
-    auto thread = std::thread([&, wg](Args &&...args) {
-      if (scheduler != nullptr) {
-        scheduler->bind();
-      }
-      result = f(std::forward<Args>(args)...);
-      if (scheduler != nullptr) {
-        Scheduler::unbind();
-      }
-      wg.done();
-    }, std::forward<Args>(args)...);
-    wg.wait();
-    thread.join();
-    return result;
-  }
+  MARL_NO_EXPORT inline explicit BlockingCallJob(F &f) : f_(f) {}
+
+  MARL_NO_EXPORT inline ReturnType result() { return std::move(result_); }
+
+ protected:
+  MARL_NO_EXPORT inline void run() override { result_ = f_(); }
+
+ private:
+  F &f_;
+  ReturnType result_;
 };
 
-template<>
-class OnNewThread<void> {
+template<typename F>
+class BlockingCallJob<void, F> : public BlockingCallPool::Job {
  public:
-  template<typename F, typename ...Args>
-  MARL_NO_EXPORT inline static void call(F &&f, Args &&...args) {
-    WaitGroup wg(1);
-    auto scheduler = Scheduler::get();
-    auto thread = std::thread([&, wg](Args &&...args) {
-      if (scheduler != nullptr) {
-        scheduler->bind();
-      }
-      f(std::forward<Args>(args)...);
-      if (scheduler != nullptr) {
-        Scheduler::unbind();
-      }
-      wg.done();
-    }, std::forward<Args>(args)...);
-    wg.wait();
-    thread.join();
-  }
+  MARL_NO_EXPORT inline explicit BlockingCallJob(F &f) : f_(f) {}
+
+  MARL_NO_EXPORT inline void result() {}
+
+ protected:
+  MARL_NO_EXPORT inline void run() override { f_(); }
+
+ private:
+  F &f_;
 };
 
 } // namespace marl::detail
 
-/// blocking_call在一个新的线程上调用函数F，然后yield当前fiber去执行其他任务，直到F返回
+/// blocking_call把函数F交给当前Scheduler的BlockingCallPool执行，然后yield当前fiber去执行其他任务，直到F返回\n
+/// 如果当前线程没有绑定Scheduler，则直接在当前线程上调用F
 template<typename F, typename ...Args>
 MARL_NO_EXPORT auto inline blocking_call(F &&f, Args &&...args)
 -> decltype(f(args...)) {
-  return detail::OnNewThread<decltype(f(args...))>::call(
-      std::forward<F>(f), std::forward<Args>(args)...);
+  using ReturnType = decltype(f(args...));
+  auto scheduler = Scheduler::get();
+  if (scheduler == nullptr) {
+    return f(std::forward<Args>(args)...);
+  }
+  auto call = [&]() -> ReturnType {
+    return f(std::forward<Args>(args)...);
+  };
+  detail::BlockingCallJob<ReturnType, decltype(call)> job(call);
+  scheduler->blockingCallPool()->call(job);
+  return job.result();
 }
 
 } // namespace marl
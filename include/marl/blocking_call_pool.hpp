@@ -0,0 +1,114 @@
+#ifndef MINIMARL_INCLUDE_MARL_BLOCKING_CALL_POOL_HPP_
+#define MINIMARL_INCLUDE_MARL_BLOCKING_CALL_POOL_HPP_
+
+#include "condition_variable.hpp"
+#include "containers.hpp"
+#include "event.hpp"
+#include "export.hpp"
+#include "memory.hpp"
+#include "mutex.hpp"
+#include "scheduler.hpp"
+#include "tsa.hpp"
+
+#include <chrono>
+#include <thread>
+
+namespace marl {
+
+/// 执行阻塞调用的专用线程池，由Scheduler持有，marl::blocking_call()会把调用交给它执行\n
+/// 池中的线程在创建时绑定到Scheduler上，之后一直复用，直到空闲超过idle_timeout才会退出\n
+/// 线程数量在[0, max_threads]之间按需增长，所有线程都在忙时新的调用会进入队列，
+/// 队列中的调用达到max_queued时，提交调用的fiber会被挂起，直到队列中有空位
+/// @note 由于线程数有上限，相互等待的阻塞调用可能会导致死锁
+class BlockingCallPool {
+ public:
+  using Config = Scheduler::Config::BlockingCall;
+
+  /// 线程池的统计数据
+  struct Stats {
+    /// 已经执行完成的调用数
+    uint64_t num_calls = 0;
+    /// 累计创建的线程数
+    uint64_t num_threads_created = 0;
+    /// 当前的线程数
+    int num_threads = 0;
+    /// 当前空闲的线程数
+    int num_idle_threads = 0;
+    /// 当前等待执行的调用数
+    int num_queued = 0;
+    /// 调用从提交到开始执行的累计时间和最大时间
+    std::chrono::nanoseconds total_queue_wait{0};
+    std::chrono::nanoseconds max_queue_wait{0};
+    /// 调用的累计执行时间和最大执行时间
+    std::chrono::nanoseconds total_exec{0};
+    std::chrono::nanoseconds max_exec{0};
+  };
+
+  /// 一次阻塞调用，位于调用者的栈上，在call()返回前都必须有效
+  class Job {
+   public:
+    virtual ~Job() = default;
+
+   protected:
+    /// 在池中的线程上执行调用
+    virtual void run() = 0;
+
+   private:
+    friend class BlockingCallPool;
+
+    using Clock = std::chrono::steady_clock;
+
+    Job *next = nullptr;
+    Clock::time_point submitted;
+    InlineEvent done{Event::Mode::Manual};
+  };
+
+  MARL_EXPORT
+  BlockingCallPool(Scheduler *scheduler,
+                   const Config &config,
+                   Allocator *allocator = Allocator::Default);
+
+  /// 等待所有已经提交的调用执行完成，然后结束所有线程
+  MARL_EXPORT
+  ~BlockingCallPool();
+
+  /// 在池中的线程上执行job，阻塞当前fiber直到执行完成
+  MARL_EXPORT
+  void call(Job &job);
+
+  /// 返回线程池的统计数据
+  MARL_EXPORT
+  Stats stats();
+
+ private:
+  BlockingCallPool(const BlockingCallPool &) = delete;
+  BlockingCallPool &operator=(const BlockingCallPool &) = delete;
+
+  /// 池中每个线程执行的函数
+  void threadMain();
+
+  /// 创建一个新线程
+  void spawnLocked() REQUIRES(mutex_);
+
+  /// join所有已经退出的线程
+  void reapLocked() REQUIRES(mutex_);
+
+  Scheduler *const scheduler_;
+  const Config cfg_;
+
+  marl::mutex mutex_;
+  /// 有新的调用进入队列，或者需要结束时通知
+  ConditionVariable work_;
+  /// 队列中出现空位时通知
+  ConditionVariable space_;
+  GUARDED_BY(mutex_) Job *head_ = nullptr;
+  GUARDED_BY(mutex_) Job *tail_ = nullptr;
+  GUARDED_BY(mutex_) containers::list<std::thread> threads_;
+  GUARDED_BY(mutex_) containers::vector<std::thread::id, 4> exited_;
+  GUARDED_BY(mutex_) Stats stats_;
+  GUARDED_BY(mutex_) bool shutdown_ = false;
+};
+
+} // namespace marl
+
+#endif //MINIMARL_INCLUDE_MARL_BLOCKING_CALL_POOL_HPP_
@@ -0,0 +1,48 @@
+#ifndef MINIMARL_INCLUDE_MARL_COMPLETION_HPP_
+#define MINIMARL_INCLUDE_MARL_COMPLETION_HPP_
+
+#include "export.hpp"
+#include "scheduler.hpp"
+
+namespace marl {
+
+/// 用于把完成通知从外部线程（没有绑定Scheduler的线程，例如第三方库的回调线程或者信号处理函数）
+/// 传递给正在等待的fiber\n
+/// post()不会加锁：Completion会被无锁地放入等待者所属Worker的收件箱（多生产者单消费者的栈）中，
+/// 然后通过门铃（Worker休眠时为futex，轮询Reactor时为eventfd）唤醒Worker，
+/// 由Worker在调度循环中取出所有的Completion并恢复对应的fiber\n
+/// 相比之下，Fiber::notify()需要获取Worker的work_.mutex，Scheduler::enqueue()则需要在Worker之间循环tryLock
+/// @note 每次post()都必须对应一次wait()，在wait()返回之前不能再次调用post()
+/// @note 在post()之后，Completion必须在对应的wait()返回之后才能被销毁
+class Completion {
+ public:
+  /// 必须在fiber中创建，post()会唤醒创建Completion的fiber
+  MARL_EXPORT
+  Completion();
+
+  /// 挂起当前fiber，直到post()被调用，如果post()已经被调用过，则立即返回\n
+  /// 返回之后Completion可以再次被post()
+  MARL_EXPORT
+  void wait();
+
+  /// 唤醒在wait()中等待的fiber，可以在任意线程中调用\n
+  /// 只使用原子操作和一次系统调用，是无锁的，并且是异步信号安全的
+  MARL_EXPORT
+  void post();
+
+ private:
+  Completion(const Completion &) = delete;
+  Completion &operator=(const Completion &) = delete;
+
+  friend class Scheduler;
+
+  Scheduler::Fiber *const fiber_;
+  /// 收件箱中的下一个Completion
+  Completion *next_ = nullptr;
+  /// 已经被Worker取出，由Worker的work_.mutex保护
+  bool done_ = false;
+};
+
+} // namespace marl
+
+#endif //MINIMARL_INCLUDE_MARL_COMPLETION_HPP_
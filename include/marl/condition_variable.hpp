@@ -1,29 +1,38 @@
 #ifndef MINIMARL_INCLUDE_MARL_CONDITION_VARIABLE_HPP_
 #define MINIMARL_INCLUDE_MARL_CONDITION_VARIABLE_HPP_
 
-#include "containers.hpp"
 #include "debug.hpp"
 #include "memory.hpp"
 #include "mutex.hpp"
 #include "scheduler.hpp"
 #include "tsa.hpp"
 
+#include <type_traits>
+
 namespace marl {
 
 /// 条件变量是一种同步方式，用于阻塞一个或多个fiber或线程
-/// 直到另一个fiber或线程使得条件满足并且通知条件变量
+/// 直到另一个fiber或线程使得条件满足并且通知条件变量\n
+/// 等待中的fiber以位于其自身栈上的节点链入一个FIFO队列中，等待过程不会进行内存分配，
+/// notify_one()总是唤醒等待最久的fiber
 class ConditionVariable {
  public:
-  MARL_NO_EXPORT inline ConditionVariable(Allocator *allocator = Allocator::Default)
-      : waiting_(allocator) {}
+  /// @param allocator 仅为兼容保留，等待者节点位于等待者自身的栈上
+  MARL_NO_EXPORT inline ConditionVariable(Allocator *allocator = Allocator::Default) {
+    (void) allocator;
+  }
 
   /// 通知并且可能将一个正在等待的fiber或thread恢复过来
   MARL_NO_EXPORT inline void notify_one() {
     if (num_waiting_ == 0) return;
     {
       marl::lock lock(mutex_);
-      if (waiting_.size() > 0) {
-        (*waiting_.begin())->notify();
+      if (head_ != nullptr) {
+        auto waiter = head_;
+        unlink(waiter);
+        waiter->fiber->notify();
+        // 必须在notify()之后才能清除linked，之后waiter可能随时被销毁
+        waiter->linked.store(false, std::memory_order_release);
         return;
       }
     }
@@ -32,13 +41,29 @@ class ConditionVariable {
     }
   }
 
-  /// 通知并且可能将所有正在等待的fiber或thread恢复过来
+  /// 通知并且可能将所有正在等待的fiber或thread恢复过来\n
+  /// 属于同一个Worker的fiber会被批量放入该Worker的队列中
   MARL_NO_EXPORT inline void notify_all() {
     if (num_waiting_ == 0) return;
     {
       marl::lock lock(mutex_);
-      for (auto fiber : waiting_) {
-        fiber->notify();
+      Scheduler::Fiber *fibers[NotifyBatchSize];
+      while (head_ != nullptr) {
+        auto first = head_;
+        size_t count = 0;
+        for (auto waiter = head_; waiter != nullptr && count < NotifyBatchSize;
+             waiter = waiter->next) {
+          fibers[count++] = waiter->fiber;
+        }
+        for (size_t i = 0; i < count; ++i) {
+          unlink(head_);
+        }
+        Scheduler::Fiber::notify(fibers, count);
+        for (size_t i = 0; i < count; ++i) {
+          auto next = first->next;
+          first->linked.store(false, std::memory_order_release);
+          first = next;
+        }
       }
     }
     if (num_waiting_on_condition > 0) {
@@ -53,15 +78,10 @@ class ConditionVariable {
     ++num_waiting_;
     if (auto fiber = Scheduler::Fiber::current()) {
       // 在fiber执行环境中
-      mutex_.lock();
-      auto it = waiting_.emplace_front(fiber);
-      mutex_.unlock();
-
-      fiber->wait(lock, pred);
-
-      mutex_.lock();
-      waiting_.erase(it);
-      mutex_.unlock();
+      Waiter waiter(fiber);
+      WaitContext context{this, &waiter, &WaitContext::call<std::remove_reference_t<Predicate>>, &pred};
+      fiber->wait(lock, [&context] { return context(); });
+      remove(&waiter);
     } else {
       /// 运行在非fiber环境，直接委托给std::condition_variable
       ++num_waiting_on_condition;
@@ -93,15 +113,10 @@ class ConditionVariable {
     bool res;
     if (auto fiber = Scheduler::Fiber::current()) {
       // 在fiber执行环境中
-      mutex_.lock();
-      auto it = waiting_.emplace_front(fiber);
-      mutex_.unlock();
-
-      res = fiber->wait(lock, timeout, pred);
-
-      mutex_.lock();
-      waiting_.erase(it);
-      mutex_.unlock();
+      Waiter waiter(fiber);
+      WaitContext context{this, &waiter, &WaitContext::call<std::remove_reference_t<Predicate>>, &pred};
+      res = fiber->wait(lock, timeout, [&context] { return context(); });
+      remove(&waiter);
     } else {
       /// 运行在非fiber环境，直接委托给std::condition_variable
       ++num_waiting_on_condition;
@@ -118,8 +133,90 @@ class ConditionVariable {
   ConditionVariable &operator=(const ConditionVariable &) = delete;
   ConditionVariable &operator=(ConditionVariable &&) = delete;
 
+  /// notify_all()每次批量唤醒的fiber数量上限
+  static constexpr size_t NotifyBatchSize = 32;
+
+  /// 位于等待中的fiber栈上的队列节点
+  struct Waiter {
+    MARL_NO_EXPORT inline explicit Waiter(Scheduler::Fiber *fiber)
+        : fiber(fiber) {}
+
+    Scheduler::Fiber *const fiber;
+    Waiter *prev = nullptr;
+    Waiter *next = nullptr;
+    /// 是否位于等待队列中，只在持有mutex_时修改\n
+    /// 通知者会在对fiber调用notify()之后才将其置为false，因此等待者看到false时可以直接销毁节点
+    std::atomic<bool> linked{false};
+  };
+
+  /// 传给Fiber::wait()的predicate，只捕获一个指针，以避免std::function进行内存分配\n
+  /// 调用者的Predicate被擦除为函数指针和对象指针，使WaitContext不需要依赖Predicate的类型（以及它的可见性）
+  struct WaitContext {
+    /// 每次fiber被唤醒后，如果pred仍为假，并且节点已经被通知者移出了队列，则重新放入队尾
+    MARL_NO_EXPORT inline bool operator()() {
+      if (pred(arg)) {
+        return true;
+      }
+      marl::lock lock(cv->mutex_);
+      if (!waiter->linked.load(std::memory_order_relaxed)) {
+        cv->pushBack(waiter);
+      }
+      return false;
+    }
+
+    /// 以Predicate的类型调用arg指向的对象
+    template<typename Predicate>
+    MARL_NO_EXPORT static inline bool call(const void *arg) {
+      return (*const_cast<Predicate *>(static_cast<const Predicate *>(arg)))();
+    }
+
+    ConditionVariable *cv;
+    Waiter *waiter;
+    bool (*pred)(const void *arg);
+    const void *arg;
+  };
+
+  MARL_NO_EXPORT inline void pushBack(Waiter *waiter) REQUIRES(mutex_) {
+    waiter->prev = tail_;
+    waiter->next = nullptr;
+    if (tail_ != nullptr) {
+      tail_->next = waiter;
+    } else {
+      head_ = waiter;
+    }
+    tail_ = waiter;
+    waiter->linked.store(true, std::memory_order_relaxed);
+  }
+
+  /// 将waiter移出队列，linked由调用者负责清除
+  MARL_NO_EXPORT inline void unlink(Waiter *waiter) REQUIRES(mutex_) {
+    if (waiter->prev != nullptr) {
+      waiter->prev->next = waiter->next;
+    } else {
+      head_ = waiter->next;
+    }
+    if (waiter->next != nullptr) {
+      waiter->next->prev = waiter->prev;
+    } else {
+      tail_ = waiter->prev;
+    }
+  }
+
+  /// 等待结束后，确保waiter已经不在队列中，并且通知者不再访问它
+  MARL_NO_EXPORT inline void remove(Waiter *waiter) {
+    if (!waiter->linked.load(std::memory_order_acquire)) {
+      return;
+    }
+    marl::lock lock(mutex_);
+    if (waiter->linked.load(std::memory_order_relaxed)) {
+      unlink(waiter);
+      waiter->linked.store(false, std::memory_order_relaxed);
+    }
+  }
+
   marl::mutex mutex_;
-  containers::list<Scheduler::Fiber *> waiting_;
+  GUARDED_BY(mutex_) Waiter *head_ = nullptr;
+  GUARDED_BY(mutex_) Waiter *tail_ = nullptr;
   std::condition_variable condition_;
   std::atomic<int> num_waiting_{0};
   std::atomic<int> num_waiting_on_condition{0};
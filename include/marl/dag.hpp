@@ -1,36 +1,121 @@
 #ifndef MINIMARL_INCLUDE_MARL_DAG_HPP_
 #define MINIMARL_INCLUDE_MARL_DAG_HPP_
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <type_traits>
 #include <iostream>
+#include <ostream>
 
+#include "condition_variable.hpp"
 #include "containers.hpp"
+#include "event.hpp"
 #include "export.hpp"
 #include "memory.hpp"
+#include "mutex.hpp"
 #include "scheduler.hpp"
 #include "wait_group.hpp"
 
 namespace marl {
+
+template<typename T>
+class DAGBase;
+
+template<typename T>
+class DAGSpawner;
+
 namespace detail {
 using DAGCounter = std::atomic<uint32_t>;
+using DAGNodeIndex = uint32_t;
 
+// 开启profiling时，节点在一次运行中的执行记录，时间为steady_clock的纳秒数
+struct DAGNodeEvent {
+  // 记录所属的运行的序号，不属于最近一次运行的记录说明节点在该次运行中没有被执行
+  uint64_t run = 0;
+  // 节点的所有前置节点都执行完的时间，开始执行的时间，以及执行结束的时间
+  int64_t readyNs = 0;
+  int64_t startNs = 0;
+  int64_t endNs = 0;
+  // 执行节点的工作线程的id，不是工作线程时为-1
+  int32_t worker = -1;
+};
+
+MARL_NO_EXPORT inline int64_t dagNs(std::chrono::steady_clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+// DAG单次运行时的所有可变状态，DAG本身在运行时是只读的\n
+// RunContext在创建时分配好所有的内存，运行结束后回到DAG的池中，被之后的运行复用
 template<typename T>
-struct DAGRunContext {
-  T data;
+struct DAGRunContextBase {
+  MARL_NO_EXPORT inline DAGRunContextBase(const DAGBase<T> *dag, Allocator *allocator)
+      : dag(dag),
+        allocator(allocator),
+        counters(allocator->template make_unique_n<DAGCounter>(dag->initialCounters.size())),
+        ready(allocator->template make_unique_n<DAGNodeIndex>(dag->maxReady)),
+        readyCapacity(dag->maxReady),
+        joins(allocator->template make_unique_n<DAGCounter>(dag->dynamicWorks.size())),
+        done(Event::Mode::Manual, false, allocator) {}
+
+  const DAGBase<T> *const dag;
+  Allocator *const allocator;
+
+  // 有多个前置任务的节点各有一个计数器，前置任务完成时-1，为0时节点会被触发
   Allocator::unique_ptr<DAGCounter> counters;
 
-  template<typename F>
-  MARL_NO_EXPORT inline void invoke(F &&f) {
-    f(data);
+  // 被批量调度的就绪节点，大小为readyCapacity，不小于DAGBase::maxReady
+  Allocator::unique_ptr<DAGNodeIndex> ready;
+  size_t readyCapacity;
+  std::atomic<uint32_t> numReady{0};
+
+  // 增量运行的起始节点数，它们保存在ready[0, numStarts)中
+  // fromRoot为true时从root节点开始运行整个DAG，此时numStarts为0
+  bool fromRoot = true;
+  uint32_t numStarts = 0;
+
+  // 每个动态节点尚未完成的部分：节点自身的任务和它派生出的子任务、子DAG，变为0时通知后置节点
+  Allocator::unique_ptr<DAGCounter> joins;
+
+  // 尚未执行完的root节点、被批量调度的节点和动态节点派生出的子任务数，变为0时本次运行结束
+  std::atomic<uint32_t> pending{0};
+
+  // 作为子DAG运行时，本次运行结束后调用，用于通知父节点
+  std::function<void()> onDone;
+
+  // 开启profiling时记录每个节点的执行情况，大小为节点数，在第一次开启profiling的运行中分配
+  Allocator::unique_ptr<DAGNodeEvent> events;
+  bool profiling = false;
+  uint64_t runId = 0;
+
+  // 运行本身和DAGRunHandle各持有一个引用，都释放之后RunContext回到DAG的池中，由DAG的poolMutex保护
+  uint32_t refs = 0;
+
+  // 本次运行结束时发出信号
+  Event done;
+};
+
+template<typename T>
+struct DAGRunContext : DAGRunContextBase<T> {
+  using DAGRunContextBase<T>::DAGRunContextBase;
+
+  // 由调用者持有，在运行结束之前必须保持有效
+  std::remove_reference_t<T> *data = nullptr;
+
+  template<typename F, typename... Args>
+  MARL_NO_EXPORT inline void invoke(F &&f, Args &&... args) {
+    f(*data, std::forward<Args>(args)...);
   }
 };
 
 template<>
-struct DAGRunContext<void> {
-  Allocator::unique_ptr<DAGCounter> counters;
+struct DAGRunContext<void> : DAGRunContextBase<void> {
+  using DAGRunContextBase<void>::DAGRunContextBase;
 
-  template<typename F>
-  MARL_NO_EXPORT inline void invoke(F &&f) {
-    f();
+  template<typename F, typename... Args>
+  MARL_NO_EXPORT inline void invoke(F &&f, Args &&... args) {
+    f(std::forward<Args>(args)...);
   }
 };
 
@@ -43,6 +128,24 @@ struct DAGWork<void> {
   using type = std::function<void()>;
 };
 
+template<typename T>
+struct DAGRangeWork {
+  using type = std::function<void(T, size_t, size_t)>;
+};
+template<>
+struct DAGRangeWork<void> {
+  using type = std::function<void(size_t, size_t)>;
+};
+
+template<typename T>
+struct DAGDynamicWork {
+  using type = std::function<void(T, DAGSpawner<T>)>;
+};
+template<>
+struct DAGDynamicWork<void> {
+  using type = std::function<void(DAGSpawner<void>)>;
+};
+
 } // namespace detail
 
 template<typename T>
@@ -54,91 +157,883 @@ class DAGBuilder;
 template<typename T>
 class DAGNodeBuilder;
 
+// DAG::nodeStats()返回的单个节点在开启profiling之后的所有运行中的统计数据\n
+// 分位数由对数分布的直方图估算，相对误差不超过25%
+struct DAGNodeStats {
+  struct Percentiles {
+    std::chrono::nanoseconds p50{0};
+    std::chrono::nanoseconds p90{0};
+    std::chrono::nanoseconds p99{0};
+    std::chrono::nanoseconds max{0};
+  };
+
+  // 被记录的执行次数
+  uint64_t count = 0;
+  // 节点任务的执行时间
+  Percentiles duration;
+  // 节点从就绪（所有前置节点都执行完）到开始执行之间的排队时间
+  Percentiles queueDelay;
+};
+
+// DAG::runAsync()返回的句柄，用于等待本次运行结束\n
+// 句柄析构时不会等待运行结束，运行会在后台继续进行，句柄必须在DAG析构之前析构
+template<typename T>
+class DAGRunHandle {
+ public:
+  MARL_NO_EXPORT inline DAGRunHandle() = default;
+  MARL_NO_EXPORT inline DAGRunHandle(DAGRunHandle &&other) noexcept : ctx_(other.ctx_) {
+    other.ctx_ = nullptr;
+  }
+  MARL_NO_EXPORT inline DAGRunHandle &operator=(DAGRunHandle &&other) noexcept {
+    std::swap(ctx_, other.ctx_);
+    return *this;
+  }
+  MARL_NO_EXPORT inline ~DAGRunHandle() {
+    if (ctx_ != nullptr) {
+      ctx_->dag->release(ctx_);
+    }
+  }
+
+  // 阻塞，直到本次运行的所有节点都执行完
+  MARL_NO_EXPORT inline void wait() const {
+    ctx_->done.wait();
+  }
+
+  // 如果本次运行的所有节点都已经执行完，则返回true
+  [[nodiscard]] MARL_NO_EXPORT inline bool finished() const {
+    return ctx_->done.isSignalled();
+  }
+
+  // 句柄是否关联了一次运行
+  MARL_NO_EXPORT inline explicit operator bool() const { return ctx_ != nullptr; }
+
+ private:
+  friend DAGBase<T>;
+
+  DAGRunHandle(const DAGRunHandle &) = delete;
+  DAGRunHandle &operator=(const DAGRunHandle &) = delete;
+
+  MARL_NO_EXPORT inline explicit DAGRunHandle(detail::DAGRunContext<T> *ctx) : ctx_(ctx) {}
+
+  detail::DAGRunContext<T> *ctx_ = nullptr;
+};
+
+// 动态节点的任务在执行时得到的句柄，用于派生子任务或者子DAG\n
+// 动态节点的后置节点只有在节点自身的任务以及它派生出的所有子任务、子DAG都完成之后才会被通知，
+// 派生不会阻塞当前的fiber，最后一个完成的子任务会在它所在的线程上继续执行后置节点\n
+// DAGSpawner可以被复制，子任务可以通过捕获它继续递归地派生子任务，
+// 但是只能在动态节点的任务或者它派生出的子任务中使用
+template<typename T>
+class DAGSpawner {
+ public:
+  // 调度一个子任务，f的签名为void()
+  template<typename F>
+  MARL_NO_EXPORT inline void spawn(F &&f) const {
+    add();
+    schedule(Task([spawner = *this, f = std::forward<F>(f)]() mutable {
+      f();
+      spawner.done();
+    }));
+  }
+
+  // 调度count个并行的子任务f(0), f(1), ..., f(count - 1)，子任务以二分的方式被拆分给其他Worker
+  template<typename F>
+  MARL_NO_EXPORT inline void spawn(size_t count, F &&f) const {
+    if (count > 0) {
+      spawnRange(0, count, std::forward<F>(f));
+    }
+  }
+
+  // 以动态节点所在的运行的数据运行子DAG，子DAG在节点的后置节点被通知之前运行完\n
+  // 子DAG必须在本次运行结束之前保持有效，如果子DAG设置了setMaxInFlight()，可能会阻塞等待
+  MARL_NO_EXPORT inline void run(DAG<T> &dag) const {
+    add();
+    auto child = dag.acquire(ctx_->allocator);
+    if constexpr (!std::is_void_v<T>) {
+      child->data = ctx_->data;
+    }
+    child->onDone = [spawner = *this] { spawner.done(); };
+    dag.start(child);
+  }
+
+ private:
+  friend DAGBase<T>;
+  friend DAGBuilder<T>;
+  using NodeIndex = detail::DAGNodeIndex;
+  using RangeWork = typename detail::DAGRangeWork<T>::type;
+
+  MARL_NO_EXPORT inline DAGSpawner(detail::DAGRunContext<T> *ctx,
+                                   NodeIndex nodeIdx,
+                                   uint32_t joinIdx)
+      : ctx_(ctx), nodeIdx_(nodeIdx), joinIdx_(joinIdx) {}
+
+  // 派生一个子任务之前调用，子任务使节点和本次运行都保持未完成的状态
+  MARL_NO_EXPORT inline void add() const {
+    ctx_->joins.get()[joinIdx_].fetch_add(1, std::memory_order_relaxed);
+    ctx_->pending.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // 子任务完成时调用，最后一个完成的子任务负责通知节点的后置节点
+  MARL_NO_EXPORT inline void done() const {
+    auto ctx = ctx_;
+    if (ctx->joins.get()[joinIdx_].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      ctx->dag->invoke(ctx, nodeIdx_, true);
+    }
+    ctx->dag->finish(ctx);
+  }
+
+  template<typename F>
+  MARL_NO_EXPORT inline void spawnRange(size_t begin, size_t end, F f) const {
+    add();
+    schedule(Task([spawner = *this, begin, end, f = std::move(f)]() mutable {
+      while (end - begin > 1) {
+        auto mid = begin + (end - begin) / 2;
+        spawner.spawnRange(mid, end, f);
+        end = mid;
+      }
+      f(begin);
+      spawner.done();
+    }));
+  }
+
+  // 并行节点的执行方式：[0, count)被分为每grain个一块，块[first, last)以二分的方式拆分给其他Worker，
+  // 当前线程执行第一个块
+  MARL_NO_EXPORT inline void runChunks(const RangeWork *work,
+                                       size_t count,
+                                       size_t grain,
+                                       size_t first,
+                                       size_t last) const {
+    while (last - first > 1) {
+      auto mid = first + (last - first) / 2;
+      add();
+      schedule(Task([spawner = *this, work, count, grain, mid, last] {
+        spawner.runChunks(work, count, grain, mid, last);
+        spawner.done();
+      }));
+      last = mid;
+    }
+    auto begin = first * grain;
+    ctx_->invoke(*work, begin, std::min(begin + grain, count));
+  }
+
+  detail::DAGRunContext<T> *ctx_;
+  NodeIndex nodeIdx_;
+  uint32_t joinIdx_;
+};
+
+// DAG以CSR（压缩稀疏行）的形式保存：节点i的后置节点为outs[outOffsets[i], outOffsets[i + 1])，
+// 所有节点的任务、后置节点和计数器初始值都保存在连续的数组中
 template<typename T>
 class DAGBase {
+ public:
+  // 限制同时进行的运行数，超出时run()和runAsync()会阻塞直到有运行结束，0表示不限制
+  MARL_NO_EXPORT inline void setMaxInFlight(size_t count) {
+    marl::lock lock(poolMutex);
+    maxInFlight = count;
+    poolCv.notify_all();
+  }
+
+  // 开启后，每次运行都会测量并累计每个节点的执行时间，供updatePriorities()使用\n
+  // 测得的执行时间也用来判断同时就绪的多个节点能否在同一个线程上连续执行，没有测量数据时它们总是被拆分给其他Worker
+  MARL_NO_EXPORT inline void setMeasureCosts(bool enabled) {
+    measuringCosts.store(enabled, std::memory_order_relaxed);
+  }
+
+  // 开启增量模式后，run()和runAsync()只执行被markDirty()标记过的节点及其所有（直接或间接的）后置节点，
+  // 计数器也只为这部分子图初始化，因此运行的开销与改动的大小成正比，而与DAG的大小无关\n
+  // 开启后的第一次运行总是执行整个DAG
+  MARL_NO_EXPORT inline void setIncremental(bool enabled) {
+    marl::lock lock(poolMutex);
+    incremental = enabled;
+    allDirty = true;
+    dirty.resize(0);
+    if (enabled && marks.size() != works.size()) {
+      marks.resize(works.size());
+    }
+  }
+
+  // 标记节点需要在下一次增量运行中重新执行，标记root节点相当于标记整个DAG\n
+  // 标记在下一次run()或runAsync()开始时被清空，未开启增量模式时被忽略
+  MARL_NO_EXPORT inline void markDirty(DAGNodeBuilder<T> node) {
+    marl::lock lock(poolMutex);
+    if (!incremental) {
+      return;
+    }
+    if (node.index_ == RootIndex) {
+      allDirty = true;
+    } else if (!allDirty) {
+      dirty.push_back(node.index_);
+    }
+  }
+
+  // 开启后，每次运行都会记录每个节点的开始、结束时间，执行它的工作线程，以及就绪之后的排队时间，
+  // 运行结束时，执行时间和排队时间被汇总到每个节点的直方图中，可以通过nodeStats()查询，
+  // 最近一次完成的运行可以通过writeTrace()导出\n
+  // 关闭时不会产生任何额外的开销，开启之后每个节点在运行中的额外开销只有两次读取时钟，
+  // 汇总在运行结束时顺序地遍历所有节点，不会在节点之间引入额外的缓存缺失
+  MARL_NO_EXPORT inline void setProfiling(bool enabled) {
+    marl::lock lock(poolMutex);
+    if (enabled && !profiles) {
+      profiles = allocator->template make_unique_n<NodeProfile>(works.size());
+    }
+    profiling = enabled;
+  }
+
+  // 返回节点在开启profiling之后的所有运行中的统计数据
+  [[nodiscard]] MARL_NO_EXPORT inline DAGNodeStats nodeStats(DAGNodeBuilder<T> node) const {
+    marl::lock lock(poolMutex);
+    DAGNodeStats stats;
+    if (profiles) {
+      auto &profile = profiles.get()[node.index_];
+      stats.duration = percentiles(profile.duration, &stats.count);
+      stats.queueDelay = percentiles(profile.queueDelay);
+    }
+    return stats;
+  }
+
+  // 将开启profiling之后最近一次完成的运行以Chrome trace event的JSON格式写入out，
+  // 可以用chrome://tracing或者Perfetto打开\n
+  // 每个被执行的节点是其所在工作线程上的一个事件（tid为工作线程的id + 1，0表示非工作线程），
+  // 排队时间记录在事件的参数中
+  MARL_NO_EXPORT inline void writeTrace(std::ostream &out) const {
+    marl::lock lock(poolMutex);
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&]() -> std::ostream & {
+      if (!first) {
+        out << ",";
+      }
+      first = false;
+      return out << "\n";
+    };
+    auto events = traceEvents.get();
+    int64_t origin = 0;
+    int32_t maxWorker = -1;
+    for (size_t i = 0, n = events != nullptr ? works.size() : 0; i < n; ++i) {
+      if (events[i].run == traceRun) {
+        auto ready = events[i].readyNs != 0 ? events[i].readyNs : events[i].startNs;
+        origin = origin == 0 ? ready : std::min(origin, ready);
+        maxWorker = std::max(maxWorker, events[i].worker);
+      }
+    }
+    for (int32_t tid = 0; tid <= maxWorker + 1; ++tid) {
+      separator() << R"({"name":"thread_name","ph":"M","pid":0,"tid":)" << tid
+                  << R"(,"args":{"name":")";
+      if (tid == 0) {
+        out << "Caller";
+      } else {
+        out << "Worker " << tid - 1;
+      }
+      out << "\"}}";
+    }
+    auto us = [](int64_t ns) { return static_cast<double>(ns) / 1000.0; };
+    for (size_t i = 0, n = events != nullptr ? works.size() : 0; i < n; ++i) {
+      auto &event = events[i];
+      if (event.run != traceRun) {
+        continue;
+      }
+      auto delay = event.readyNs != 0 ? event.startNs - event.readyNs : 0;
+      separator() << R"({"name":"node )" << i << R"(","cat":"dag","ph":"X","pid":0,"tid":)"
+                  << event.worker + 1 << R"(,"ts":)" << us(event.startNs - origin)
+                  << R"(,"dur":)" << us(event.endNs - event.startNs)
+                  << R"(,"args":{"node":)" << i << R"(,"queue_delay_us":)" << us(delay) << "}}";
+    }
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+  }
+
+  // 以测得的平均执行时间作为节点的权重重新计算优先级，没有测量数据的节点使用所有节点的平均值\n
+  // 必须在没有正在进行的运行时调用
+  MARL_NO_EXPORT inline void updatePriorities() {
+    marl::lock lock(poolMutex);
+    MARL_ASSERT(numInFlight == 0, "DAG::updatePriorities() called while the DAG is running");
+    uint64_t totalNs = 0;
+    uint64_t numMeasured = 0;
+    auto numNodes = works.size();
+    for (size_t i = 0; i < numNodes; ++i) {
+      if (auto mean = costs.get()[i].mean()) {
+        totalNs += mean;
+        ++numMeasured;
+      }
+    }
+    auto fallback = numMeasured > 0 ? std::max<uint64_t>(totalNs / numMeasured, 1) : 1;
+    computePriorities([&](NodeIndex idx) {
+      auto mean = costs.get()[idx].mean();
+      return mean > 0 ? mean : fallback;
+    });
+  }
+
  protected:
   friend DAGBuilder<T>;
   friend DAGNodeBuilder<T>;
+  friend DAGRunHandle<T>;
+  friend detail::DAGRunContextBase<T>;
+  friend DAGSpawner<T>;
+
+  MARL_NO_EXPORT inline DAGBase() = default;
+
+  // 节点的执行时间统计
+  struct NodeCost {
+    std::atomic<uint64_t> totalNs{0};
+    std::atomic<uint64_t> count{0};
+
+    MARL_NO_EXPORT inline void add(std::chrono::steady_clock::duration elapsed) {
+      auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+      totalNs.fetch_add(static_cast<uint64_t>(ns), std::memory_order_relaxed);
+      count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 平均执行时间（纳秒），没有测量数据时返回0
+    [[nodiscard]] MARL_NO_EXPORT inline uint64_t mean() const {
+      auto n = count.load(std::memory_order_relaxed);
+      return n > 0 ? totalNs.load(std::memory_order_relaxed) / n : 0;
+    }
+  };
+
+  // 直方图的桶数，每个2的幂被分为两个桶，最大的桶包含所有超过约4秒的值
+  static constexpr size_t NumProfileBuckets = 64;
+
+  // 节点的执行时间和排队时间的直方图，执行次数为直方图中的计数之和
+  struct NodeProfile {
+    uint32_t duration[NumProfileBuckets] = {};
+    uint32_t queueDelay[NumProfileBuckets] = {};
+  };
+
+  // 值v（纳秒）所在的桶，v < 4时为v本身，否则由最高位的位置和次高位决定
+  MARL_NO_EXPORT inline static size_t profileBucket(int64_t v) {
+    if (v < 4) {
+      return v < 0 ? 0 : static_cast<size_t>(v);
+    }
+    auto value = static_cast<uint64_t>(v);
+    size_t msb = 63 - static_cast<size_t>(__builtin_clzll(value));
+    auto bucket = 2 * msb + ((value >> (msb - 1)) & 1);
+    return std::min(bucket, NumProfileBuckets - 1);
+  }
+
+  // 桶所代表的值，即桶的范围的中点
+  MARL_NO_EXPORT inline static uint64_t profileBucketValue(size_t bucket) {
+    if (bucket < 4) {
+      return bucket;
+    }
+    auto msb = bucket / 2;
+    return ((5 + 2 * (bucket & 1)) << (msb - 1)) / 2;
+  }
+
+  // 由直方图估算分位数，count不为空时输出直方图中的计数之和
+  MARL_NO_EXPORT inline static DAGNodeStats::Percentiles percentiles(
+      const uint32_t (&histogram)[NumProfileBuckets], uint64_t *count = nullptr) {
+    uint64_t counts[NumProfileBuckets];
+    uint64_t total = 0;
+    for (size_t i = 0; i < NumProfileBuckets; ++i) {
+      counts[i] = histogram[i];
+      total += counts[i];
+    }
+    if (count != nullptr) {
+      *count = total;
+    }
+    DAGNodeStats::Percentiles result;
+    if (total == 0) {
+      return result;
+    }
+    auto at = [&](double fraction) {
+      auto rank = std::max<uint64_t>(static_cast<uint64_t>(fraction * static_cast<double>(total)), 1);
+      uint64_t seen = 0;
+      for (size_t i = 0; i < NumProfileBuckets; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+          return std::chrono::nanoseconds(profileBucketValue(i));
+        }
+      }
+      return std::chrono::nanoseconds(profileBucketValue(NumProfileBuckets - 1));
+    };
+    result.p50 = at(0.5);
+    result.p90 = at(0.9);
+    result.p99 = at(0.99);
+    result.max = at(1.0);
+    return result;
+  }
+
+  // 按拓扑排序的逆序计算每个节点的优先级，weight(i)为节点i自身的权重
+  template<typename F>
+  MARL_NO_EXPORT inline void computePriorities(F &&weight) {
+    for (size_t i = topoOrder.size(); i > 0; --i) {
+      auto idx = topoOrder[i - 1];
+      uint64_t longest = 0;
+      for (auto o = outOffsets[idx], end = outOffsets[idx + 1]; o < end; ++o) {
+        longest = std::max(longest, priorities[outs[o]]);
+      }
+      priorities[idx] = longest + weight(idx);
+    }
+  }
+
+  // 等待所有的运行结束，然后释放池中的RunContext
+  MARL_NO_EXPORT inline ~DAGBase() {
+    marl::lock lock(poolMutex);
+    poolCv.wait(lock, [this]() REQUIRES(poolMutex) { return numInFlight == 0; });
+    MARL_ASSERT(freeContexts.size() == numContexts, "DAG destroyed with RunHandles still alive");
+    for (auto ctx : freeContexts) {
+      ctx->allocator->destroy(ctx);
+    }
+  }
 
   using RunContext = detail::DAGRunContext<T>;
   using Counter = detail::DAGCounter;
-  using NodeIndex = size_t;
+  using NodeIndex = detail::DAGNodeIndex;
   using Work = typename detail::DAGWork<T>::type;
+  using DynamicWork = typename detail::DAGDynamicWork<T>::type;
   static constexpr size_t NumReservedNodes = 32;
-  static constexpr size_t NumReservedNumOuts = 4;
-  static constexpr size_t InvalidCounterIndex = ~static_cast<size_t>(0);
   static constexpr NodeIndex RootIndex = 0;
   static constexpr NodeIndex InvalidNodeIndex = ~static_cast<NodeIndex>(0);
+  static constexpr uint32_t InvalidCounterIndex = ~static_cast<uint32_t>(0);
 
-  // DAG work node
-  struct Node {
-    MARL_NO_EXPORT inline Node() = default;
-    MARL_NO_EXPORT inline Node(Work &&work) : work(std::move(work)) {}
+  // 每个线程最多暂存MaxBatchSize个就绪的节点，超出时作为一批调度
+  static constexpr size_t MaxBatchSize = 64;
 
-    // 当前节点要运行的任务
-    Work work;
+  // 执行时间超过该值的节点被认为足够重，值得拆分给其他Worker
+  static constexpr auto SplitThreshold = std::chrono::microseconds(4);
 
-    // RunContext中的counter的index,当前置任务完成时，counter会-1，当counter为0时，节点会被触发
-    size_t counterIndex = InvalidCounterIndex;
+  // 从池中取出一个RunContext并为新的运行重置它，池为空时使用allocator创建一个新的RunContext
+  MARL_NO_EXPORT inline RunContext *acquire(Allocator *allocator) const {
+    RunContext *ctx = nullptr;
+    {
+      marl::lock lock(poolMutex);
+      poolCv.wait(lock, [this]() REQUIRES(poolMutex) {
+        return maxInFlight == 0 || numInFlight < maxInFlight;
+      });
+      ++numInFlight;
+      if (freeContexts.size() > 0) {
+        ctx = freeContexts.back();
+        freeContexts.pop_back();
+      } else {
+        ++numContexts;
+      }
+    }
+    if (ctx == nullptr) {
+      ctx = allocator->create<RunContext>(this, allocator);
+    }
+    // 此时RunContext不在池中，只有当前线程可以访问它
+    ctx->refs = 2;
+    ctx->fromRoot = true;
+    ctx->numStarts = 0;
+    {
+      marl::lock lock(poolMutex);
+      if (incremental && !allDirty) {
+        collectDirty(ctx);
+      }
+      allDirty = false;
+      dirty.resize(0);
+      ctx->profiling = profiling;
+      ctx->runId = ++numRuns;
+    }
+    if (ctx->profiling && !ctx->events) {
+      ctx->events = ctx->allocator->template make_unique_n<detail::DAGNodeEvent>(works.size());
+    }
+    if (ctx->fromRoot) {
+      for (size_t i = 0, n = initialCounters.size(); i < n; ++i) {
+        ctx->counters.get()[i].store(initialCounters[i], std::memory_order_relaxed);
+      }
+    }
+    ctx->numReady.store(ctx->numStarts, std::memory_order_relaxed);
+    ctx->pending.store(1, std::memory_order_relaxed);
+    ctx->done.clear();
+    return ctx;
+  }
 
-    // 后置任务的nodeIndex
-    containers::vector<NodeIndex, NumReservedNumOuts> outs;
-  };
+  // 从被标记的节点出发遍历所有受影响的节点，只为它们初始化计数器（值为受影响的前置节点数），
+  // 并将不依赖于其他受影响节点的被标记节点作为起始节点放入ctx->ready中
+  MARL_NO_EXPORT inline void collectDirty(RunContext *ctx) const REQUIRES(poolMutex) {
+    ctx->fromRoot = false;
+    if (dirty.size() == 0) {
+      return;
+    }
+    // marks[i] == epoch表示节点i被标记但还没有被其他受影响的节点到达，epoch + 1表示已被到达
+    epoch += 2;
+    if (epoch == 0) {
+      std::fill(marks.begin(), marks.end(), 0);
+      epoch = 2;
+    }
+    auto reset = [&](NodeIndex idx) {
+      auto counterIdx = counterIndices[idx];
+      if (counterIdx != InvalidCounterIndex) {
+        ctx->counters.get()[counterIdx].store(0, std::memory_order_relaxed);
+      }
+    };
+    auto &stack = worklist;
+    stack.resize(0);
+    for (auto idx : dirty) {
+      if (marks[idx] != epoch) {
+        marks[idx] = epoch;
+        reset(idx);
+        stack.push_back(idx);
+      }
+    }
+    auto numSeeds = stack.size();
+    // stack[0, numSeeds)保留被标记的节点，其余部分作为深度优先遍历的栈
+    for (size_t i = 0; i < stack.size();) {
+      NodeIndex idx;
+      if (i < numSeeds) {
+        idx = stack[i++];
+      } else {
+        idx = stack.back();
+        stack.pop_back();
+      }
+      for (auto o = outOffsets[idx], end = outOffsets[idx + 1]; o < end; ++o) {
+        auto out = outs[o];
+        if (marks[out] != epoch + 1) {
+          if (marks[out] != epoch) {
+            reset(out);
+            stack.push_back(out);
+          }
+          marks[out] = epoch + 1;
+        }
+        auto counterIdx = counterIndices[out];
+        if (counterIdx != InvalidCounterIndex) {
+          ctx->counters.get()[counterIdx].fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    }
+
+    auto numNodes = works.size();
+    if (ctx->readyCapacity < numNodes) {
+      ctx->ready = ctx->allocator->template make_unique_n<NodeIndex>(numNodes);
+      ctx->readyCapacity = numNodes;
+    }
+    for (size_t i = 0; i < numSeeds; ++i) {
+      if (marks[stack[i]] == epoch) {
+        ctx->ready.get()[ctx->numStarts++] = stack[i];
+      }
+    }
+  }
 
-  MARL_NO_EXPORT inline void initCounters(RunContext *ctx,
-                                          Allocator *allocator) {
-    auto numCounters = initialCounters.size();
-    ctx->counters = allocator->template make_unique_n<Counter>(numCounters);
-    for (size_t i = 0; i < numCounters; ++i) {
-      ctx->counters.get()[i] = {initialCounters[i]};
+  // 释放句柄持有的引用
+  MARL_NO_EXPORT inline void release(RunContext *ctx) const {
+    marl::lock lock(poolMutex);
+    releaseLocked(ctx);
+  }
+
+  // 释放RunContext的一个引用，最后一个引用释放时将它放回池中
+  MARL_NO_EXPORT inline void releaseLocked(RunContext *ctx) const REQUIRES(poolMutex) {
+    if (--ctx->refs == 0) {
+      freeContexts.push_back(ctx);
+    }
+  }
+
+  // root节点或者一个被批量调度的节点执行完时调用，全部执行完时结束本次运行\n
+  // 在持有poolMutex时发出信号并释放引用，使得wait()返回之后RunContext可以立即被复用，
+  // 并且DAG析构时不会有Worker仍在访问RunContext
+  MARL_NO_EXPORT inline void finish(RunContext *ctx) const {
+    if (ctx->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      auto onDone = std::move(ctx->onDone);
+      ctx->onDone = nullptr;
+      {
+        marl::lock lock(poolMutex);
+        // 保留最近一次完成的运行的记录，交换之后RunContext复用之前的记录的内存
+        if (ctx->profiling) {
+          aggregateProfile(ctx);
+          if (ctx->runId > traceRun) {
+            std::swap(ctx->events, traceEvents);
+            traceRun = ctx->runId;
+          }
+        }
+        ctx->done.signal();
+        --numInFlight;
+        poolCv.notify_all();
+        releaseLocked(ctx);
+      }
+      if (onDone) {
+        onDone();
+      }
+    }
+  }
+
+  // 在后台运行DAG，root节点作为一个任务被调度
+  MARL_NO_EXPORT inline DAGRunHandle<T> start(RunContext *ctx) const {
+    schedule(Task([ctx] {
+      ctx->dag->runRoot(ctx);
+      ctx->dag->finish(ctx);
+    }));
+    return DAGRunHandle<T>(ctx);
+  }
+
+  // 在当前线程上执行root节点，然后等待所有的节点都执行完
+  MARL_NO_EXPORT inline void run(RunContext *ctx) const {
+    runRoot(ctx);
+    finish(ctx);
+    DAGRunHandle<T>(ctx).wait();
+  }
+
+  // 执行root节点，增量运行时则改为执行所有的起始节点
+  MARL_NO_EXPORT inline void runRoot(RunContext *ctx) const {
+    if (ctx->fromRoot) {
+      invoke(ctx, RootIndex);
+    } else if (ctx->numStarts > 0) {
+      ctx->pending.fetch_add(ctx->numStarts, std::memory_order_relaxed);
+      runBatch(ctx, 0, ctx->numStarts);
     }
   }
 
   // index代表节点的前置任务完成时，将会调用该方法
   // 如果节点的所有前置任务都已经完成，则会返回true，调用者接下来应该调用invoke方法
-  MARL_NO_EXPORT inline bool notify(RunContext *ctx, NodeIndex nodeIdx) {
-    Node *node = &nodes[nodeIdx];
-    if (node->counterIndex == InvalidCounterIndex) {
+  MARL_NO_EXPORT inline bool notify(RunContext *ctx, NodeIndex nodeIdx) const {
+    // 只有一个前置任务的节点没有计数器
+    auto counterIdx = counterIndices[nodeIdx];
+    if (counterIdx == InvalidCounterIndex) {
       return true;
     }
-    auto counters = ctx->counters.get();
-    auto couter = --counters[node->counterIndex];
-    return couter == 0;
-  }
-
-  // 调用index对应节点上的任务, 接着调用notify，将会启动后置任务
-  MARL_NO_EXPORT inline void invoke(RunContext *ctx, NodeIndex nodeIdx, WaitGroup *wg) {
-    Node *node = &nodes[nodeIdx];
-    if (node->work) {
-      ctx->invoke(node->work);
-    }
-
-    // 缓存要notify的node，直接调用最后一个invoke，可以避免调度的开销
-    NodeIndex toInvoke = InvalidNodeIndex;
-    for (NodeIndex idx : node->outs) {
-      if (notify(ctx, idx)) {
-        if (toInvoke != InvalidNodeIndex) {
-          wg->add(1);
-          schedule(
-              [=](WaitGroup w) {
-                invoke(ctx, toInvoke, &w);
-                w.done();
-              },
-              *wg);
+    auto counter = --ctx->counters.get()[counterIdx];
+    return counter == 0;
+  }
+
+  // 调用index对应节点上的任务, 接着调用notify，将会启动后置任务\n
+  // skipWork为true时不执行第一个节点的任务，直接通知它的后置节点，用于动态节点的子任务全部完成时
+  // 就绪的后置任务先暂存在当前线程的栈上，逐个执行以避免调度的开销，
+  // 同一个节点的就绪后置任务按优先级入栈，使优先级最高的最先执行，
+  // 只有当栈中的任务都已知开销很小时才留在栈上，否则（包括开销未知时）或者暂存的任务过多时，
+  // 将栈顶以外的暂存任务按出栈的顺序以批为单位调度
+  MARL_NO_EXPORT inline void invoke(RunContext *ctx,
+                                    NodeIndex nodeIdx,
+                                    bool skipWork = false) const {
+    NodeIndex pending[MaxBatchSize];
+    size_t numPending = 0;
+    bool measureCosts = measuringCosts.load(std::memory_order_relaxed);
+    auto events = ctx->profiling ? ctx->events.get() : nullptr;
+    while (true) {
+      auto begin = outOffsets[nodeIdx];
+      auto end = outOffsets[nodeIdx + 1];
+      bool measure = measureCosts || events != nullptr;
+      // 后置节点就绪的时间，只在profiling时使用
+      int64_t readyNs = 0;
+      // root节点没有任务，它的后置任务总是被立即调度
+      bool split = nodeIdx == RootIndex;
+      bool finished = true;
+      auto &work = works[nodeIdx];
+      if (skipWork) {
+        skipWork = false;
+      } else if (work || nodeIdx != RootIndex) {
+        std::chrono::steady_clock::time_point start;
+        if (measure) {
+          start = std::chrono::steady_clock::now();
+        }
+        if (work) {
+          ctx->invoke(work);
+        } else {
+          finished = invokeDynamic(ctx, nodeIdx);
+        }
+        if (measure) {
+          auto now = std::chrono::steady_clock::now();
+          if (measureCosts) {
+            costs.get()[nodeIdx].add(now - start);
+          }
+          if (events != nullptr) {
+            readyNs = detail::dagNs(now);
+            profileNode(ctx, nodeIdx, detail::dagNs(start), readyNs);
+          }
+        }
+      }
+      if (events != nullptr && readyNs == 0) {
+        readyNs = detail::dagNs(std::chrono::steady_clock::now());
+      }
+      // 动态节点派生的子任务还没有全部完成，由最后完成的子任务通知后置节点
+      if (!finished) {
+        begin = end;
+      }
+
+      auto first = numPending;
+      for (auto i = begin; i < end; ++i) {
+        auto out = outs[i];
+        if (!notify(ctx, out)) {
+          continue;
+        }
+        if (events != nullptr) {
+          events[out].run = ctx->runId;
+          events[out].readyNs = readyNs;
         }
-        toInvoke = idx;
+        if (numPending == MaxBatchSize) {
+          numPending = scheduleAllButTop(ctx, pending, numPending);
+          first = std::min(first, numPending);
+        }
+        // 栈中原有的节点都已知开销很小，只需要检查新就绪的节点
+        split = split || !isCheap(out);
+        // 插入排序，栈顶为优先级最高的节点
+        auto pos = numPending++;
+        for (; pos > first && priorities[pending[pos - 1]] > priorities[out]; --pos) {
+          pending[pos] = pending[pos - 1];
+        }
+        pending[pos] = out;
+      }
+      if (numPending == 0) {
+        return;
       }
+      if (split && numPending > 1) {
+        numPending = scheduleAllButTop(ctx, pending, numPending);
+      }
+      nodeIdx = pending[--numPending];
     }
-    if (toInvoke != InvalidNodeIndex) {
-      invoke(ctx, toInvoke, wg);
+  }
+
+  // 节点测得的平均执行时间是否不超过SplitThreshold，没有测量数据时开销未知，返回false，
+  // 不能由前置节点的执行时间推测，开销很小的节点的后置节点可能开销很大
+  MARL_NO_EXPORT inline bool isCheap(NodeIndex nodeIdx) const {
+    auto mean = costs.get()[nodeIdx].mean();
+    return mean > 0 && std::chrono::nanoseconds(mean) <= SplitThreshold;
+  }
+
+  // 记录一次节点的执行
+  MARL_NO_EXPORT inline void profileNode(RunContext *ctx,
+                                         NodeIndex nodeIdx,
+                                         int64_t startNs,
+                                         int64_t endNs) const {
+    auto &event = ctx->events.get()[nodeIdx];
+    // 没有在本次运行中被通知过的节点（root的后置节点和增量运行的起始节点）在开始执行时就绪
+    if (event.run != ctx->runId) {
+      event.run = ctx->runId;
+      event.readyNs = startNs;
     }
+    event.startNs = startNs;
+    event.endNs = endNs;
+    event.worker = Scheduler::currentWorkerId();
   }
 
-  // 包含DAG中所有的节点，node[0]永远是root节点，没有任何前置依赖
-  containers::vector<Node, NumReservedNodes> nodes;
+  // 将一次运行中被执行的节点的记录汇总到直方图中
+  MARL_NO_EXPORT inline void aggregateProfile(const RunContext *ctx) const REQUIRES(poolMutex) {
+    // 每个节点的直方图较大，被访问的桶分散在不同的缓存行中，提前预取之后的节点的桶以隐藏缓存缺失
+    constexpr size_t PrefetchDistance = 16;
+    auto events = ctx->events.get();
+    auto profile = profiles.get();
+    auto n = works.size();
+    for (size_t i = 0; i < n; ++i) {
+      if (i + PrefetchDistance < n) {
+        auto &next = events[i + PrefetchDistance];
+        if (next.run == ctx->runId) {
+          auto &nextProfile = profile[i + PrefetchDistance];
+          __builtin_prefetch(&nextProfile.duration[profileBucket(next.endNs - next.startNs)], 1);
+          __builtin_prefetch(&nextProfile.queueDelay[profileBucket(next.startNs - next.readyNs)], 1);
+        }
+      }
+      auto &event = events[i];
+      if (event.run == ctx->runId) {
+        ++profile[i].duration[profileBucket(event.endNs - event.startNs)];
+        ++profile[i].queueDelay[profileBucket(event.startNs - event.readyNs)];
+      }
+    }
+  }
+
+  // 执行动态节点的任务，如果它派生出的子任务都已经完成，则返回true，调用者接下来应该通知后置节点
+  MARL_NO_EXPORT inline bool invokeDynamic(RunContext *ctx, NodeIndex nodeIdx) const {
+    if (dynamicIndices.size() == 0) {
+      return true;
+    }
+    auto joinIdx = dynamicIndices[nodeIdx];
+    if (joinIdx == InvalidCounterIndex) {
+      return true;
+    }
+    // 节点自身的任务也算作一个未完成的部分，防止子任务在任务返回之前就通知后置节点
+    auto &join = ctx->joins.get()[joinIdx];
+    join.store(1, std::memory_order_relaxed);
+    ctx->invoke(dynamicWorks[joinIdx], DAGSpawner<T>(ctx, nodeIdx, joinIdx));
+    return join.fetch_sub(1, std::memory_order_acq_rel) == 1;
+  }
+
+  // 调度栈中除了栈顶以外的所有节点，靠近栈顶（优先级高）的节点排在批的前面，返回留下的节点数
+  MARL_NO_EXPORT inline size_t scheduleAllButTop(RunContext *ctx,
+                                                 NodeIndex *stack,
+                                                 size_t count) const {
+    std::reverse(stack, stack + count - 1);
+    scheduleBatch(ctx, stack, count - 1);
+    stack[0] = stack[count - 1];
+    return 1;
+  }
+
+  // 将一批就绪的节点放入ctx->ready中，只调度一个任务，由它以二分的方式拆分\n
+  // 拆分时前一半留在当前任务中，因此排在前面（优先级高）的节点会先执行
+  MARL_NO_EXPORT inline void scheduleBatch(RunContext *ctx,
+                                           const NodeIndex *nodes,
+                                           size_t count) const {
+    auto begin = ctx->numReady.fetch_add(static_cast<uint32_t>(count), std::memory_order_relaxed);
+    std::copy(nodes, nodes + count, ctx->ready.get() + begin);
+    ctx->pending.fetch_add(static_cast<uint32_t>(count), std::memory_order_relaxed);
+    spawn(ctx, begin, begin + static_cast<uint32_t>(count));
+  }
+
+  // 调度一个执行ctx->ready[begin, end)的任务，捕获的状态足够小，不会导致std::function分配内存
+  MARL_NO_EXPORT inline static void spawn(RunContext *ctx, uint32_t begin, uint32_t end) {
+    schedule(Task([ctx, begin, end] { ctx->dag->runBatch(ctx, begin, end); }));
+  }
+
+  // 依次执行ctx->ready[begin, end)中的节点，需要拆分时将剩余节点的后一半交给其他Worker\n
+  // 节点的开销未知时先拆分一次，之后只有节点的执行时间超过SplitThreshold时才继续拆分，
+  // 执行很快的节点在同一个任务中连续执行，避免调度的开销超过节点本身的工作量
+  MARL_NO_EXPORT inline void runBatch(RunContext *ctx, uint32_t begin, uint32_t end) const {
+    bool split = true;
+    while (begin < end) {
+      if (split && end - begin > 1) {
+        auto mid = begin + (end - begin) / 2;
+        spawn(ctx, mid, end);
+        end = mid;
+      }
+      auto start = std::chrono::steady_clock::now();
+      invoke(ctx, ctx->ready.get()[begin++]);
+      finish(ctx);
+      split = std::chrono::steady_clock::now() - start > SplitThreshold;
+    }
+  }
+
+  // 每个节点要运行的任务，works[0]永远是root节点，没有任何前置依赖
+  containers::vector<Work, NumReservedNodes> works;
+
+  // 节点i的后置节点为outs[outOffsets[i], outOffsets[i + 1])
+  containers::vector<uint32_t, NumReservedNodes> outOffsets;
+  containers::vector<NodeIndex, NumReservedNodes> outs;
+
+  // 每个节点在RunContext::counters中的计数器的index，只有一个前置任务的节点为InvalidCounterIndex
+  containers::vector<uint32_t, NumReservedNodes> counterIndices;
 
   // 计数器的初始值列表，将会被复制到RunContext::counters
   containers::vector<uint32_t, NumReservedNodes> initialCounters;
+
+  // 动态节点的任务，以及每个节点在dynamicWorks和RunContext::joins中的index，
+  // 不是动态节点的节点为InvalidCounterIndex，DAG中没有动态节点时dynamicIndices为空
+  containers::vector<DynamicWork, NumReservedNodes> dynamicWorks;
+  containers::vector<uint32_t, NumReservedNodes> dynamicIndices;
+
+  // 一次运行中被批量调度的节点数的上限，每个节点至多被批量调度一次，没有节点的出度大于1时为0
+  size_t maxReady = 0;
+
+  // 所有节点的拓扑排序
+  containers::vector<NodeIndex, NumReservedNodes> topoOrder;
+
+  // 节点的优先级，即从该节点到任意一个终点的最长路径的长度（包括节点自身），关键路径上的节点优先执行\n
+  // 路径长度默认以节点数计算，调用updatePriorities()之后以测得的执行时间（纳秒）计算
+  containers::vector<uint64_t, NumReservedNodes> priorities;
+
+  // 每个节点的执行时间统计，只在setMeasureCosts(true)之后更新
+  Allocator::unique_ptr<NodeCost> costs;
+  std::atomic<bool> measuringCosts{false};
+
+  // 创建DAG的allocator
+  Allocator *allocator = Allocator::Default;
+
+  // profiling的状态：每个节点的直方图，最近一次完成的运行的记录及其序号，以及运行的总数
+  mutable GUARDED_BY(poolMutex) Allocator::unique_ptr<NodeProfile> profiles;
+  GUARDED_BY(poolMutex) bool profiling = false;
+  mutable GUARDED_BY(poolMutex) Allocator::unique_ptr<detail::DAGNodeEvent> traceEvents;
+  mutable GUARDED_BY(poolMutex) uint64_t traceRun = 0;
+  mutable GUARDED_BY(poolMutex) uint64_t numRuns = 0;
+
+  // 增量模式的状态：被标记的节点，以及遍历受影响的节点时使用的标记和栈
+  GUARDED_BY(poolMutex) bool incremental = false;
+  mutable GUARDED_BY(poolMutex) bool allDirty = true;
+  mutable GUARDED_BY(poolMutex) containers::vector<NodeIndex, NumReservedNodes> dirty;
+  mutable GUARDED_BY(poolMutex) containers::vector<uint32_t, NumReservedNodes> marks;
+  mutable GUARDED_BY(poolMutex) containers::vector<NodeIndex, NumReservedNodes> worklist;
+  mutable GUARDED_BY(poolMutex) uint32_t epoch = 0;
+
+  // 空闲的RunContext，创建过的RunContext数，以及正在进行的运行数
+  mutable marl::mutex poolMutex;
+  mutable ConditionVariable poolCv;
+  mutable GUARDED_BY(poolMutex) containers::vector<RunContext *, 4> freeContexts;
+  mutable GUARDED_BY(poolMutex) size_t numContexts = 0;
+  mutable GUARDED_BY(poolMutex) size_t numInFlight = 0;
+  GUARDED_BY(poolMutex) size_t maxInFlight = 0;
 };
 
 template<typename T>
@@ -152,7 +1047,22 @@ class DAGNodeBuilder {
     return node;
   }
 
+  template<typename F>
+  MARL_NO_EXPORT inline DAGNodeBuilder thenDynamic(F &&work) {
+    auto node = builder_->dynamicNode(std::move(work));
+    builder_->addDependency(*this, node);
+    return node;
+  }
+
+  template<typename F>
+  MARL_NO_EXPORT inline DAGNodeBuilder thenParallel(size_t count, size_t grain, F &&work) {
+    auto node = builder_->parallelNode(count, grain, std::move(work));
+    builder_->addDependency(*this, node);
+    return node;
+  }
+
  private:
+  friend DAGBase<T>;
   friend DAGBuilder<T>;
 
   MARL_NO_EXPORT inline DAGNodeBuilder(DAGBuilder<T> *builder, NodeIndex index)
@@ -166,9 +1076,13 @@ template<typename T>
 class DAGBuilder {
  public:
   MARL_NO_EXPORT inline DAGBuilder(Allocator *allocator = Allocator::Default)
-      : dag(allocator->template make_unique<DAG<T>>()), numIns(allocator) {
+      : allocator(allocator),
+        dag(allocator->template make_unique<DAG<T>>()),
+        numIns(allocator),
+        edges(allocator),
+        dynamicNodes(allocator) {
     // 添加root节点
-    dag->nodes.push_back(Node{});
+    dag->works.push_back(Work{});
     numIns.push_back(0);
   }
 
@@ -184,11 +1098,11 @@ class DAGBuilder {
   template<typename F>
   MARL_NO_EXPORT inline DAGNodeBuilder<T> node(F &&work,
                                                std::initializer_list<DAGNodeBuilder<T>> after) {
-    MARL_ASSERT(numIns.size() == dag->nodes.size(),
+    MARL_ASSERT(numIns.size() == dag->works.size(),
                 "NodeBuilder vectors out of sync");
-    auto index = dag->nodes.size();
+    auto index = static_cast<NodeIndex>(dag->works.size());
     numIns.push_back(0);
-    dag->nodes.push_back(Node{std::move(work)});
+    dag->works.push_back(Work{std::forward<F>(work)});
     auto node = DAGNodeBuilder<T>{this, index};
     for (auto in : after) {
       addDependency(in, node);
@@ -196,22 +1110,116 @@ class DAGBuilder {
     return node;
   }
 
+  // 添加一个动态节点，work额外接收一个DAGSpawner，可以在运行时派生子任务或者子DAG，
+  // 所有的子任务都完成之后才会通知后置节点
+  template<typename F>
+  MARL_NO_EXPORT inline DAGNodeBuilder<T> dynamicNode(F &&work) {
+    return dynamicNode(std::forward<F>(work), {});
+  }
+
+  template<typename F>
+  MARL_NO_EXPORT inline DAGNodeBuilder<T> dynamicNode(
+      F &&work, std::initializer_list<DAGNodeBuilder<T>> after) {
+    auto node = this->node(Work{}, after);
+    dynamicNodes.push_back(node.index_);
+    dag->dynamicWorks.push_back(DynamicWork{std::forward<F>(work)});
+    return node;
+  }
+
+  // 添加一个并行节点，[0, count)被分为每grain个元素一块，各块在不同的Worker上并行执行
+  // work(data, begin, end)，所有的块都执行完之后才会通知后置节点
+  template<typename F>
+  MARL_NO_EXPORT inline DAGNodeBuilder<T> parallelNode(size_t count, size_t grain, F &&work) {
+    return parallelNode(count, grain, std::forward<F>(work), {});
+  }
+
+  template<typename F>
+  MARL_NO_EXPORT inline DAGNodeBuilder<T> parallelNode(
+      size_t count, size_t grain, F &&work, std::initializer_list<DAGNodeBuilder<T>> after) {
+    MARL_ASSERT(grain > 0, "DAG parallel node grain must be greater than 0");
+    auto numChunks = (count + grain - 1) / grain;
+    auto run = [work = RangeWork{std::forward<F>(work)}, count, grain, numChunks](
+        DAGSpawner<T> spawner) {
+      if (numChunks > 0) {
+        spawner.runChunks(&work, count, grain, 0, numChunks);
+      }
+    };
+    if constexpr (std::is_void_v<T>) {
+      return dynamicNode(std::move(run), after);
+    } else {
+      return dynamicNode([run = std::move(run)](T, DAGSpawner<T> spawner) { run(spawner); },
+                         after);
+    }
+  }
+
   MARL_NO_EXPORT inline void addDependency(DAGNodeBuilder<T> parent,
                                            DAGNodeBuilder<T> child) {
     ++numIns[child.index_];
-    dag->nodes[parent.index_].outs.push_back(child.index_);
+    edges.push_back(Edge{parent.index_, child.index_});
   }
 
   // 构造并返回DAG
   MARL_NO_EXPORT inline Allocator::unique_ptr<DAG<T>> build() {
-    auto numNodes = dag->nodes.size();
-    MARL_ASSERT(numIns.size() == dag->nodes.size(),
+    auto numNodes = dag->works.size();
+    MARL_ASSERT(numIns.size() == dag->works.size(),
                 "NodeBuilder vectors out of sync");
+
+    // 以计数排序的方式将边按前置节点分组，同一个节点的后置节点保持添加时的顺序
+    auto &offsets = dag->outOffsets;
+    offsets.resize(numNodes + 1);
+    for (auto &edge : edges) {
+      ++offsets[edge.from + 1];
+    }
+    for (size_t i = 0; i < numNodes; ++i) {
+      offsets[i + 1] += offsets[i];
+    }
+    containers::vector<uint32_t, NumReservedNumIns> cursors(offsets);
+    dag->outs.resize(edges.size());
+    for (auto &edge : edges) {
+      dag->outs[cursors[edge.from]++] = edge.to;
+    }
+
+    // 通过Kahn算法求出拓扑排序
+    containers::vector<uint32_t, NumReservedNumIns> remaining(numIns, allocator);
+    auto &order = dag->topoOrder;
     for (size_t i = 0; i < numNodes; ++i) {
+      if (remaining[i] == 0) {
+        order.push_back(static_cast<NodeIndex>(i));
+      }
+    }
+    for (size_t head = 0; head < order.size(); ++head) {
+      auto idx = order[head];
+      for (auto o = offsets[idx], end = offsets[idx + 1]; o < end; ++o) {
+        if (--remaining[dag->outs[o]] == 0) {
+          order.push_back(dag->outs[o]);
+        }
+      }
+    }
+    MARL_ASSERT(order.size() == numNodes, "DAG contains a cycle");
+    dag->priorities.resize(numNodes);
+    dag->computePriorities([](NodeIndex) { return 1; });
+    dag->costs = allocator->template make_unique_n<typename DAGBase<T>::NodeCost>(numNodes);
+    dag->allocator = allocator;
+
+    if (dynamicNodes.size() > 0) {
+      dag->dynamicIndices.resize(numNodes);
+      std::fill(dag->dynamicIndices.begin(), dag->dynamicIndices.end(),
+                DAGBase<T>::InvalidCounterIndex);
+      for (size_t i = 0; i < dynamicNodes.size(); ++i) {
+        dag->dynamicIndices[dynamicNodes[i]] = static_cast<uint32_t>(i);
+      }
+    }
+
+    dag->counterIndices.resize(numNodes);
+    for (size_t i = 0; i < numNodes; ++i) {
+      if (offsets[i + 1] - offsets[i] > 1) {
+        dag->maxReady = numNodes;
+      }
       if (numIns[i] > 1) {
-        auto &node = dag->nodes[i];
-        node.counterIndex = dag->initialCounters.size();
+        dag->counterIndices[i] = static_cast<uint32_t>(dag->initialCounters.size());
         dag->initialCounters.push_back(numIns[i]);
+      } else {
+        dag->counterIndices[i] = DAGBase<T>::InvalidCounterIndex;
       }
     }
     return std::move(dag);
@@ -219,10 +1227,21 @@ class DAGBuilder {
 
  private:
   static constexpr size_t NumReservedNumIns = 4;
-  using Node = typename DAG<T>::Node;
+  using NodeIndex = typename DAGBase<T>::NodeIndex;
+  using Work = typename DAGBase<T>::Work;
+  using DynamicWork = typename DAGBase<T>::DynamicWork;
+  using RangeWork = typename detail::DAGRangeWork<T>::type;
+
+  struct Edge {
+    NodeIndex from;
+    NodeIndex to;
+  };
 
+  Allocator *const allocator;
   Allocator::unique_ptr<DAG<T>> dag;
   containers::vector<uint32_t, NumReservedNumIns> numIns;
+  containers::vector<Edge, NumReservedNumIns> edges;
+  containers::vector<NodeIndex, NumReservedNumIns> dynamicNodes;
 };
 
 template<typename T = void>
@@ -230,14 +1249,25 @@ class DAG : public DAGBase<T> {
  public:
   using Builder = DAGBuilder<T>;
   using NodeBuilder = DAGNodeBuilder<T>;
+  using RunHandle = DAGRunHandle<T>;
+  using Spawner = DAGSpawner<T>;
 
+  // 运行DAG，直到所有的节点都执行完\n
+  // allocator只在池中没有空闲的RunContext时用于创建新的RunContext
   MARL_NO_EXPORT inline void run(T &data,
                                  Allocator *allocator = Allocator::Default) {
-    typename DAGBase<T>::RunContext ctx{data};
-    this->initCounters(&ctx, allocator);
-    WaitGroup wg;
-    this->invoke(&ctx, this->RootIndex, &wg);
-    wg.wait();
+    auto ctx = this->acquire(allocator);
+    ctx->data = &data;
+    DAGBase<T>::run(ctx);
+  }
+
+  // 在后台运行DAG并立即返回，同一个DAG的多次运行可以同时进行\n
+  // data在运行结束之前必须保持有效
+  MARL_NO_EXPORT inline RunHandle runAsync(T &data,
+                                           Allocator *allocator = Allocator::Default) {
+    auto ctx = this->acquire(allocator);
+    ctx->data = &data;
+    return this->start(ctx);
   }
 };
 
@@ -246,13 +1276,15 @@ class DAG<void> : public DAGBase<void> {
  public:
   using Builder = DAGBuilder<void>;
   using NodeBuilder = DAGNodeBuilder<void>;
+  using RunHandle = DAGRunHandle<void>;
+  using Spawner = DAGSpawner<void>;
 
   MARL_NO_EXPORT inline void run(Allocator *allocator = Allocator::Default) {
-    typename DAGBase<void>::RunContext ctx{};
-    this->initCounters(&ctx, allocator);
-    WaitGroup wg;
-    this->invoke(&ctx, this->RootIndex, &wg);
-    wg.wait();
+    DAGBase<void>::run(acquire(allocator));
+  }
+
+  MARL_NO_EXPORT inline RunHandle runAsync(Allocator *allocator = Allocator::Default) {
+    return start(acquire(allocator));
   }
 };
 
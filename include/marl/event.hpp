@@ -8,6 +8,8 @@
 
 namespace marl {
 
+class InlineEvent;
+
 /// Event是一种同步原语，用于阻塞直到产生信号
 class Event {
  public:
@@ -29,8 +31,7 @@ class Event {
 
   /// 清除信号状态
   MARL_NO_EXPORT inline void clear() const {
-     marl::lock lock(shared_->mutex);
-     shared_->signalled = false;
+    shared_->clear();
   }
 
   /// 阻塞，直到发出信号
@@ -53,36 +54,61 @@ class Event {
   /// 如果信号已经发出，则返回true，否则返回false
   /// 如果是Auto模式，并且信号已经发出，则信号的发出状态会重置
   [[nodiscard]] MARL_NO_EXPORT inline bool test() const {
-    marl::lock lock(shared_->mutex);
-    if (!shared_->signalled) {
-      return false;
-    }
-    if (shared_->mode == Mode::Auto) {
-      shared_->signalled = false;
-    }
-    return true;
+    return shared_->test();
   }
 
   /// 如果信号已经发出，则返回true，否则返回false
   /// 与test不同，Auto模式时不会自动重置
   [[nodiscard]] MARL_NO_EXPORT inline bool isSignalled() const {
-    marl::lock lock(shared_->mutex);
-    return shared_->signalled;
+    return shared_->isSignalled();
+  }
+
+  /// 阻塞，直到events中的任意一个发出信号，返回该event在参数列表中的下标\n
+  /// 等待期间会在每个event上注册一个位于当前栈上的临时等待者，返回前全部注销，不会像any()那样在event上留下残留\n
+  /// 被选中的event如果是Auto模式，则其信号会被重置，其他event的信号状态不受影响\n
+  /// events可以是Event或者InlineEvent
+  template<typename... Events>
+  MARL_NO_EXPORT inline static int wait_any(Events &&...events) {
+    static_assert(sizeof...(Events) > 0, "marl::Event::wait_any() requires at least one event");
+    Shared *shared[] = {sharedOf(events)...};
+    SelectNode nodes[sizeof...(Events)];
+    return select(shared, nodes, sizeof...(Events), nullptr);
+  }
+
+  /// 阻塞，直到events中的任意一个发出信号或者已经超时
+  /// @return 发出信号的event在参数列表中的下标，如果超时则返回-1
+  template<typename Rep, typename Period, typename... Events>
+  MARL_NO_EXPORT inline static int wait_any_for(
+      const std::chrono::duration<Rep, Period> &duration,
+      Events &&...events) {
+    return wait_any_until(std::chrono::system_clock::now() + duration,
+                          std::forward<Events>(events)...);
+  }
+
+  /// 阻塞，直到events中的任意一个发出信号或者已经超时
+  /// @return 发出信号的event在参数列表中的下标，如果超时则返回-1
+  template<typename Clock, typename Duration, typename... Events>
+  MARL_NO_EXPORT inline static int wait_any_until(
+      const std::chrono::time_point<Clock, Duration> &timeout,
+      Events &&...events) {
+    static_assert(sizeof...(Events) > 0, "marl::Event::wait_any_until() requires at least one event");
+    Shared *shared[] = {sharedOf(events)...};
+    SelectNode nodes[sizeof...(Events)];
+    auto tp = std::chrono::time_point_cast<std::chrono::system_clock::duration,
+                                           std::chrono::system_clock>(timeout);
+    return select(shared, nodes, sizeof...(Events), &tp);
   }
 
   /// 返回一个event，当列表中的任意一个event发出信号时该event会自动发出信号
+  /// @note 返回的event会被注册到列表中的每个event上，直到它被销毁后，才会在列表中的event下一次发出信号或者调用any()时被清理，
+  /// 如果只是需要等待任意一个event，应该使用wait_any()
   template<typename Iterator>
   MARL_NO_EXPORT inline static Event any(Mode mode,
                                          const Iterator &begin,
                                          const Iterator &end) {
     Event any(mode, false);
     for (auto it = begin; it != end; ++it) {
-      auto s = it->shared_;
-      marl::lock lock(s->mutex);
-      if (s->signalled) {
-        any.signal();
-      }
-      s->deps.push_back(any.shared_);
+      it->shared_->addDep(any.shared_);
     }
     return any;
   }
@@ -96,68 +122,333 @@ class Event {
   }
 
  private:
+  friend class InlineEvent;
+
+  struct Selector;
+
+  /// wait_any()在每个event上注册的临时等待者，位于调用wait_any()的栈上
+  struct SelectNode {
+    Selector *selector = nullptr;
+    SelectNode *prev = nullptr;
+    SelectNode *next = nullptr;
+  };
+
+  /// Event的状态保存在一个原子变量中：
+  /// - bit 0: 是否已经发出信号
+  /// - bit 1: 是否存在依赖当前Event的其他Event（通过any()注册），依赖全部被销毁后在下一次signal()时清除
+  /// - 其余位: 正在等待的fiber或线程的数量，包括wait_any()注册的等待者
+  /// 没有等待者和依赖时，signal()/test()/isSignalled()/clear()都只需要一次原子操作，
+  /// 只有存在等待者时才会加锁并通过ConditionVariable唤醒
   struct Shared {
+    static constexpr uint32_t Signalled = 1u << 0;
+    static constexpr uint32_t HasDeps = 1u << 1;
+    static constexpr uint32_t OneWaiter = 1u << 2;
+
     MARL_NO_EXPORT inline Shared(Allocator *allocator,
                                  Mode mode,
                                  bool initial_state)
         : cv(allocator),
           mode(mode),
-          signalled(initial_state) {}
+          state(initial_state ? Signalled : 0) {}
+
     MARL_NO_EXPORT inline void signal() {
+      auto s = state.load();
+      while (true) {
+        if (s & Signalled) {
+          return;
+        }
+        if (s != 0) {
+          break;  // 存在等待者或者依赖，需要走加锁的路径
+        }
+        if (state.compare_exchange_weak(s, Signalled)) {
+          return;
+        }
+      }
       marl::lock lock(mutex);
-      if (signalled) return;
-      signalled = true;
+      if (state.fetch_or(Signalled) & Signalled) {
+        return;
+      }
       if (mode == Mode::Auto) {
         cv.notify_one();
       } else {
         cv.notify_all();
       }
-      for (const auto &dep : deps) {
-        dep->signal();
+      for (auto node = selectors; node != nullptr; node = node->next) {
+        node->selector->trigger();
+      }
+      size_t alive = 0;
+      for (size_t i = 0; i < deps.size(); ++i) {
+        if (auto dep = deps[i].lock()) {
+          dep->signal();
+          deps[alive++] = std::move(deps[i]);
+        }
+      }
+      deps.resize(alive);
+      if (alive == 0) {
+        // 依赖已经全部被销毁，之后的signal()可以重新走无锁的路径
+        state.fetch_and(~HasDeps);
       }
     }
+
     MARL_NO_EXPORT inline void wait() {
-      marl::lock lock(mutex);
-      cv.wait(lock, [&] { return signalled; });
-      if (mode == Mode::Auto) {
-        signalled = false;
+      if (tryConsume()) {
+        return;
       }
+      marl::lock lock(mutex);
+      state += OneWaiter;
+      cv.wait(lock, [&] { return tryConsume(); });
+      state -= OneWaiter;
     }
 
     template<typename Rep, typename Period>
     MARL_NO_EXPORT inline bool wait_for(const std::chrono::duration<Rep, Period> &duration) {
-      marl::lock lock(mutex);
-      if (!cv.wait_for(lock, duration, [&] { return signalled; })) {
-        return false;
+      if (tryConsume()) {
+        return true;
       }
-      if (mode == Mode::Auto) {
-        signalled = false;
-      }
-      return true;
+      marl::lock lock(mutex);
+      state += OneWaiter;
+      auto res = cv.wait_for(lock, duration, [&] { return tryConsume(); });
+      state -= OneWaiter;
+      return res;
     }
 
     template<typename Clock, typename Duration>
     MARL_NO_EXPORT inline bool wait_until(const std::chrono::time_point<Clock, Duration> &timeout) {
+      if (tryConsume()) {
+        return true;
+      }
       marl::lock lock(mutex);
-      if (!cv.wait_until(lock, timeout, [&] { return signalled; })) {
-        return false;
+      state += OneWaiter;
+      auto res = cv.wait_until(lock, timeout, [&] { return tryConsume(); });
+      state -= OneWaiter;
+      return res;
+    }
+
+    MARL_NO_EXPORT inline void clear() {
+      state &= ~Signalled;
+    }
+
+    MARL_NO_EXPORT inline bool test() {
+      return tryConsume();
+    }
+
+    MARL_NO_EXPORT inline bool isSignalled() const {
+      return (state.load() & Signalled) != 0;
+    }
+
+    /// 如果信号已经发出则返回true，Auto模式下会同时重置信号
+    MARL_NO_EXPORT inline bool tryConsume() {
+      if (mode == Mode::Manual) {
+        return isSignalled();
       }
-      if (mode == Mode::Auto) {
-        signalled = false;
+      auto s = state.load();
+      while (s & Signalled) {
+        if (state.compare_exchange_weak(s, s & ~Signalled)) {
+          return true;
+        }
       }
-      return true;
+      return false;
+    }
+
+    /// 注册一个依赖当前Event的Event，当前Event发出信号时，dep也会发出信号
+    /// 已经被销毁的dep会在这里被清理
+    MARL_NO_EXPORT inline void addDep(const std::shared_ptr<Shared> &dep) {
+      marl::lock lock(mutex);
+      size_t alive = 0;
+      for (size_t i = 0; i < deps.size(); ++i) {
+        if (!deps[i].expired()) {
+          deps[alive++] = std::move(deps[i]);
+        }
+      }
+      deps.resize(alive);
+      // 先设置HasDeps，使得之后的signal()都进入加锁的路径
+      if (state.fetch_or(HasDeps) & Signalled) {
+        dep->signal();
+      }
+      deps.push_back(dep);
+    }
+
+    /// 注册wait_any()的临时等待者，注册期间signal()总是会进入加锁的路径
+    MARL_NO_EXPORT inline void addSelector(SelectNode *node) {
+      marl::lock lock(mutex);
+      state += OneWaiter;
+      node->prev = nullptr;
+      node->next = selectors;
+      if (selectors != nullptr) {
+        selectors->prev = node;
+      }
+      selectors = node;
+    }
+
+    MARL_NO_EXPORT inline void removeSelector(SelectNode *node) {
+      marl::lock lock(mutex);
+      if (node->prev != nullptr) {
+        node->prev->next = node->next;
+      } else {
+        selectors = node->next;
+      }
+      if (node->next != nullptr) {
+        node->next->prev = node->prev;
+      }
+      state -= OneWaiter;
     }
 
     marl::mutex mutex;
     ConditionVariable cv;
-    containers::vector<std::shared_ptr<Shared>, 1> deps;
+    containers::vector<std::weak_ptr<Shared>, 1> deps;
+    GUARDED_BY(mutex) SelectNode *selectors = nullptr;
     const Mode mode;
-    bool signalled;
+    std::atomic<uint32_t> state;
   };
 
+  /// wait_any()的等待状态，任意一个event发出信号时都会唤醒它
+  struct Selector {
+    MARL_NO_EXPORT inline void trigger() {
+      marl::lock lock(mutex);
+      triggered = true;
+      cv.notify_one();
+    }
+
+    marl::mutex mutex;
+    ConditionVariable cv;
+    GUARDED_BY(mutex) bool triggered = false;
+  };
+
+  MARL_NO_EXPORT static inline Shared *sharedOf(const Event &event) {
+    return event.shared_.get();
+  }
+
+  MARL_NO_EXPORT static inline Shared *sharedOf(InlineEvent &event);
+
+  /// wait_any()的实现，nodes是调用者栈上的count个临时等待者
+  MARL_NO_EXPORT static inline int select(Shared *const *shared,
+                                          SelectNode *nodes,
+                                          size_t count,
+                                          const std::chrono::system_clock::time_point *timeout) {
+    for (size_t i = 0; i < count; ++i) {
+      if (shared[i]->tryConsume()) {
+        return static_cast<int>(i);
+      }
+    }
+    Selector selector;
+    for (size_t i = 0; i < count; ++i) {
+      nodes[i].selector = &selector;
+      shared[i]->addSelector(&nodes[i]);
+    }
+    int result = -1;
+    while (true) {
+      for (size_t i = 0; i < count && result < 0; ++i) {
+        if (shared[i]->tryConsume()) {
+          result = static_cast<int>(i);
+        }
+      }
+      if (result >= 0) {
+        break;
+      }
+      marl::lock lock(selector.mutex);
+      auto triggered = [&]() REQUIRES(selector.mutex) { return selector.triggered; };
+      if (timeout != nullptr) {
+        if (!selector.cv.wait_until(lock, *timeout, triggered)) {
+          break;
+        }
+      } else {
+        selector.cv.wait(lock, triggered);
+      }
+      selector.triggered = false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      shared[i]->removeSelector(&nodes[i]);
+    }
+    return result;
+  }
+
   const std::shared_ptr<Shared> shared_;
 };
 
+/// InlineEvent提供和Event相同的功能，但是不进行任何堆内存分配，可以直接放在fiber栈上或者其他对象中\n
+/// InlineEvent不可复制，需要通过ref()获取一个轻量的Ref传递给其他任务，复制Ref不涉及任何原子操作\n
+/// 调用者需要保证InlineEvent的生命周期长于所有的Ref
+/// @note InlineEvent不能用于Event::any()
+class InlineEvent {
+ public:
+  using Mode = Event::Mode;
+
+  /// 指向InlineEvent的引用，提供和Event相同的接口
+  class Ref {
+   public:
+    MARL_NO_EXPORT inline void signal() const { shared_->signal(); }
+    MARL_NO_EXPORT inline void clear() const { shared_->clear(); }
+    MARL_NO_EXPORT inline void wait() const { shared_->wait(); }
+
+    template<typename Rep, typename Period>
+    MARL_NO_EXPORT inline bool wait_for(const std::chrono::duration<Rep, Period> &duration) const {
+      return shared_->wait_for(duration);
+    }
+
+    template<typename Clock, typename Duration>
+    MARL_NO_EXPORT inline bool wait_until(const std::chrono::time_point<Clock, Duration> &timeout) const {
+      return shared_->wait_until(timeout);
+    }
+
+    [[nodiscard]] MARL_NO_EXPORT inline bool test() const { return shared_->test(); }
+    [[nodiscard]] MARL_NO_EXPORT inline bool isSignalled() const { return shared_->isSignalled(); }
+
+   private:
+    friend class InlineEvent;
+    MARL_NO_EXPORT inline Ref(Event::Shared *shared) : shared_(shared) {}
+    Event::Shared *shared_;
+  };
+
+  /// @param allocator 仅用于ConditionVariable的内部分配
+  MARL_NO_EXPORT inline InlineEvent(Mode mode = Mode::Auto,
+                                    bool initial_state = false,
+                                    Allocator *allocator = Allocator::Default)
+      : shared_(allocator, mode, initial_state) {}
+
+  /// 返回指向当前InlineEvent的引用
+  MARL_NO_EXPORT inline Ref ref() { return Ref(&shared_); }
+
+  /// 发出信号，可能会解除一个wait
+  MARL_NO_EXPORT inline void signal() { shared_.signal(); }
+
+  /// 清除信号状态
+  MARL_NO_EXPORT inline void clear() { shared_.clear(); }
+
+  /// 阻塞，直到发出信号
+  MARL_NO_EXPORT inline void wait() { shared_.wait(); }
+
+  /// 阻塞，直到发出信号或者已经超时
+  /// @return 如果是超时导致返回，则返回false，否则返回true
+  template<typename Rep, typename Period>
+  MARL_NO_EXPORT inline bool wait_for(const std::chrono::duration<Rep, Period> &duration) {
+    return shared_.wait_for(duration);
+  }
+
+  template<typename Clock, typename Duration>
+  MARL_NO_EXPORT inline bool wait_until(const std::chrono::time_point<Clock, Duration> &timeout) {
+    return shared_.wait_until(timeout);
+  }
+
+  /// 如果信号已经发出，则返回true，否则返回false
+  /// 如果是Auto模式，并且信号已经发出，则信号的发出状态会重置
+  [[nodiscard]] MARL_NO_EXPORT inline bool test() { return shared_.test(); }
+
+  /// 如果信号已经发出，则返回true，否则返回false
+  [[nodiscard]] MARL_NO_EXPORT inline bool isSignalled() { return shared_.isSignalled(); }
+
+ private:
+  InlineEvent(const InlineEvent &) = delete;
+  InlineEvent &operator=(const InlineEvent &) = delete;
+
+  friend class Event;
+
+  Event::Shared shared_;
+};
+
+Event::Shared *Event::sharedOf(InlineEvent &event) {
+  return &event.shared_;
+}
+
 } // namespace marl
 
 #endif //MINIMARL_INCLUDE_MARL_EVENT_HPP_
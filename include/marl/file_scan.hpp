@@ -0,0 +1,157 @@
+#ifndef MINIMARL_INCLUDE_MARL_FILE_SCAN_HPP_
+#define MINIMARL_INCLUDE_MARL_FILE_SCAN_HPP_
+
+#include "debug.hpp"
+#include "export.hpp"
+#include "memory.hpp"
+#include "pipeline.hpp"
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace marl {
+
+/// 以只读方式映射到内存中的文件，析构时解除映射
+class MappedFile {
+ public:
+  MappedFile() = default;
+
+  MARL_EXPORT
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  /// 映射整个fd，映射之后fd可以被关闭，并通过madvise(MADV_SEQUENTIAL)提示内核会顺序访问
+  /// @return 成功时返回0，失败时返回-errno，空文件不会被映射，data()为nullptr
+  MARL_EXPORT
+  int map(int fd);
+
+  /// 打开并映射path
+  /// @return 成功时返回0，失败时返回-errno
+  MARL_EXPORT
+  int open(const char *path);
+
+  /// 提示内核即将访问[offset, offset + len)，使内核提前异步地读入这部分页面（MADV_WILLNEED）
+  MARL_EXPORT
+  void prefetch(size_t offset, size_t len) const;
+
+  [[nodiscard]] MARL_NO_EXPORT inline const char *data() const { return data_; }
+  [[nodiscard]] MARL_NO_EXPORT inline size_t size() const { return size_; }
+
+ private:
+  void unmap();
+
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+/// scanFile()传给处理函数的一块数据，除了文件的最后一块，每一块都以分隔符结尾，因此不会把一条记录拆开
+struct FileChunk {
+  /// 第几块，从0开始
+  size_t index = 0;
+  /// 在文件中的偏移
+  size_t offset = 0;
+  const char *data = nullptr;
+  size_t size = 0;
+  char delimiter = '\n';
+
+  /// 对块中的每一条记录（不包含分隔符）调用f(std::string_view)
+  template<typename F>
+  MARL_NO_EXPORT inline void forEachRecord(F &&f) const {
+    auto p = data;
+    auto end = data + size;
+    while (p < end) {
+      auto next = static_cast<const char *>(memchr(p, delimiter, static_cast<size_t>(end - p)));
+      auto record_end = next != nullptr ? next : end;
+      f(std::string_view(p, static_cast<size_t>(record_end - p)));
+      p = record_end + 1;
+    }
+  }
+};
+
+/// scanFile()的选项
+struct FileScanOptions {
+  /// 每一块的目标大小，实际的块会延伸到下一个分隔符
+  size_t chunk_size = 4 * 1024 * 1024;
+  /// 记录之间的分隔符
+  char delimiter = '\n';
+  /// Ordered时consume按照块在文件中的顺序被调用，Unordered时按照处理完成的顺序被调用
+  PipelineOrder order = PipelineOrder::Ordered;
+  /// 同时在处理中的块数，为0时为工作线程数的2倍加1，被预读的数据不会超过max_chunks个块
+  size_t max_chunks = 0;
+};
+
+/// 映射file并将其划分为以分隔符对齐的块，在当前绑定的Scheduler上并行地调用process(const FileChunk &)处理每一块，
+/// 然后串行地把结果传给consume(R &&)\n
+/// 基于Pipeline实现：串行的源阶段负责切分（只需要在目标边界附近查找分隔符），并对切出的块发出MADV_WILLNEED预读，
+/// 因此内核读入后面的块的同时，工作线程在处理前面的块，在处理中的块数不超过max_chunks
+/// @note 必须在绑定了Scheduler的线程上调用
+template<typename Process, typename Consume>
+MARL_NO_EXPORT inline void scanFile(const MappedFile &file, Process &&process, Consume &&consume,
+                                   const FileScanOptions &options = FileScanOptions()) {
+  using Result = std::decay_t<std::invoke_result_t<Process &, const FileChunk &>>;
+  MARL_ASSERT(options.chunk_size > 0, "marl::scanFile() chunk_size must be positive");
+  if (file.size() == 0) {
+    return;
+  }
+  auto scheduler = Scheduler::get();
+  MARL_ASSERT(scheduler != nullptr, "marl::scanFile() called without a bound scheduler");
+  auto max_chunks = options.max_chunks;
+  if (max_chunks == 0) {
+    max_chunks = static_cast<size_t>(scheduler->config().worker_thread.count) * 2 + 1;
+  }
+
+  size_t offset = 0;
+  size_t index = 0;
+  Pipeline pipeline(max_chunks, options.order, scheduler->config().allocator);
+  pipeline.source([&]() -> std::optional<FileChunk> {
+        if (offset == file.size()) {
+          return std::nullopt;
+        }
+        auto end = std::min(offset + options.chunk_size, file.size());
+        if (end < file.size()) {
+          // 块延伸到目标边界之后（含边界前的最后一个字节）的第一个分隔符
+          auto from = file.data() + end - 1;
+          auto delimiter = static_cast<const char *>(
+              memchr(from, options.delimiter, file.size() - (end - 1)));
+          end = delimiter != nullptr ? static_cast<size_t>(delimiter - file.data()) + 1 : file.size();
+        }
+        FileChunk chunk;
+        chunk.index = index++;
+        chunk.offset = offset;
+        chunk.data = file.data() + offset;
+        chunk.size = end - offset;
+        chunk.delimiter = options.delimiter;
+        file.prefetch(chunk.offset, chunk.size);
+        offset = end;
+        return chunk;
+      })
+      .then(StageMode::Parallel, [&](FileChunk &&chunk) -> Result { return process(chunk); })
+      .sink(StageMode::Serial, [&](Result &&result) { consume(std::move(result)); });
+  pipeline.run();
+}
+
+/// 打开并映射path，然后和scanFile(const MappedFile &, ...)相同
+/// @return 成功时返回0，打开或者映射文件失败时返回-errno
+template<typename Process, typename Consume>
+MARL_NO_EXPORT inline int scanFile(const char *path, Process &&process, Consume &&consume,
+                                   const FileScanOptions &options = FileScanOptions()) {
+  MappedFile file;
+  auto res = file.open(path);
+  if (res != 0) {
+    return res;
+  }
+  scanFile(file, std::forward<Process>(process), std::forward<Consume>(consume), options);
+  return 0;
+}
+
+} // namespace marl
+
+#endif // MINIMARL_INCLUDE_MARL_FILE_SCAN_HPP_
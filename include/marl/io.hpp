@@ -0,0 +1,222 @@
+#ifndef MINIMARL_INCLUDE_MARL_IO_HPP_
+#define MINIMARL_INCLUDE_MARL_IO_HPP_
+
+#include "condition_variable.hpp"
+#include "export.hpp"
+#include "memory.hpp"
+#include "mutex.hpp"
+#include "tsa.hpp"
+#include "wait_group.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace marl {
+namespace io {
+
+/// 一次文件I/O请求，可以通过submit()批量提交\n
+/// 所有的偏移量都是显式指定的，不会修改fd的文件偏移
+struct Request {
+  enum class Op : uint8_t {
+    Read,        ///< pread
+    Write,       ///< pwrite
+    ReadV,       ///< preadv
+    WriteV,      ///< pwritev
+    ReadFixed,   ///< 读取到通过Ring::registerBuffers()注册的缓冲区中
+    WriteFixed,  ///< 写入通过Ring::registerBuffers()注册的缓冲区中的数据
+    Fsync,       ///< fsync
+    Fdatasync,   ///< fdatasync
+  };
+
+  MARL_NO_EXPORT static inline Request read(int fd, void *buf, size_t len, off_t offset) {
+    return make(Op::Read, fd, buf, len, offset);
+  }
+  MARL_NO_EXPORT static inline Request write(int fd, const void *buf, size_t len, off_t offset) {
+    return make(Op::Write, fd, const_cast<void *>(buf), len, offset);
+  }
+  MARL_NO_EXPORT static inline Request readv(int fd, const iovec *iov, int iovcnt, off_t offset) {
+    return make(Op::ReadV, fd, const_cast<iovec *>(iov), static_cast<size_t>(iovcnt), offset);
+  }
+  MARL_NO_EXPORT static inline Request writev(int fd, const iovec *iov, int iovcnt, off_t offset) {
+    return make(Op::WriteV, fd, const_cast<iovec *>(iov), static_cast<size_t>(iovcnt), offset);
+  }
+  /// buf必须位于第buf_index个注册的缓冲区内
+  MARL_NO_EXPORT static inline Request readFixed(int fd, void *buf, size_t len, off_t offset,
+                                                 int buf_index) {
+    auto req = make(Op::ReadFixed, fd, buf, len, offset);
+    req.buf_index = buf_index;
+    return req;
+  }
+  /// buf必须位于第buf_index个注册的缓冲区内
+  MARL_NO_EXPORT static inline Request writeFixed(int fd, const void *buf, size_t len, off_t offset,
+                                                  int buf_index) {
+    auto req = make(Op::WriteFixed, fd, const_cast<void *>(buf), len, offset);
+    req.buf_index = buf_index;
+    return req;
+  }
+  MARL_NO_EXPORT static inline Request fsync(int fd) {
+    return make(Op::Fsync, fd, nullptr, 0, 0);
+  }
+  MARL_NO_EXPORT static inline Request fdatasync(int fd) {
+    return make(Op::Fdatasync, fd, nullptr, 0, 0);
+  }
+
+  Op op = Op::Read;
+  int fd = -1;
+  /// Read/Write时指向数据，ReadV/WriteV时指向iovec数组
+  void *buf = nullptr;
+  /// Read/Write时为字节数，ReadV/WriteV时为iovec的个数\n
+  /// io_uring的SQE中长度只有32位，超过UINT32_MAX的请求不会被执行，result为-EINVAL，
+  /// 更大的读写需要由调用者拆分为多个请求
+  size_t len = 0;
+  off_t offset = 0;
+  int buf_index = 0;
+  /// 请求完成后的结果，成功时为传输的字节数（Fsync/Fdatasync为0），失败时为-errno
+  ssize_t result = 0;
+
+ private:
+  friend class Ring;
+
+  MARL_NO_EXPORT static inline Request make(Op op, int fd, void *buf, size_t len, off_t offset) {
+    Request req;
+    req.op = op;
+    req.fd = fd;
+    req.buf = buf;
+    req.len = len;
+    req.offset = offset;
+    return req;
+  }
+
+  /// 所属的批次，请求完成时调用done()
+  InlineWaitGroup *group_ = nullptr;
+};
+
+/// 每个Scheduler持有一个Ring，可以通过Scheduler::ioRing()获取\n
+/// 请求会被提交到io_uring中，提交请求的fiber会被挂起，由一个专用的完成线程在CQE到达时唤醒它，
+/// 因此I/O期间工作线程可以继续执行其他任务\n
+/// 如果内核不支持io_uring，或者在配置中禁用了io_uring，则请求会通过marl::blocking_call()同步执行
+class Ring {
+ public:
+  /// @param entries 提交队列的大小，同时在途的请求数最多为其2倍
+  /// @param use_io_uring 为false时总是使用blocking_call()执行请求
+  MARL_EXPORT
+  Ring(unsigned int entries, bool use_io_uring, Allocator *allocator = Allocator::Default);
+
+  /// 结束完成线程，调用前所有请求都必须已经完成
+  MARL_EXPORT
+  ~Ring();
+
+  /// 是否正在使用io_uring
+  [[nodiscard]] MARL_NO_EXPORT inline bool usingIoUring() const { return ring_fd_ >= 0; }
+
+  /// 提交count个请求，阻塞当前fiber直到所有请求都完成，结果保存在每个请求的result中\n
+  /// 所有请求通过一次系统调用提交（超过队列大小时会分多次），请求之间没有顺序保证
+  MARL_EXPORT
+  void submit(Request *requests, size_t count);
+
+  /// 注册固定缓冲区，供ReadFixed/WriteFixed使用，同一时间只能注册一组
+  /// @return 成功时返回0，失败时返回-errno，使用blocking_call()执行时总是成功
+  MARL_EXPORT
+  int registerBuffers(const iovec *iovs, unsigned int count);
+
+  /// 注销通过registerBuffers()注册的缓冲区
+  MARL_EXPORT
+  int unregisterBuffers();
+
+ private:
+  Ring(const Ring &) = delete;
+  Ring &operator=(const Ring &) = delete;
+
+  struct SubmissionQueue {
+    unsigned int *head = nullptr;
+    unsigned int *tail = nullptr;
+    unsigned int *mask = nullptr;
+    unsigned int *array = nullptr;
+    io_uring_sqe *sqes = nullptr;
+    unsigned int entries = 0;
+  };
+
+  struct CompletionQueue {
+    unsigned int *head = nullptr;
+    unsigned int *tail = nullptr;
+    unsigned int *mask = nullptr;
+    io_uring_cqe *cqes = nullptr;
+    unsigned int entries = 0;
+  };
+
+  /// 初始化io_uring，失败时返回false
+  bool setup(unsigned int entries);
+
+  /// 将请求放入提交队列，调用者需要在之后调用enter()
+  /// @return 请求的长度无法放入SQE时返回false，请求不会被放入提交队列
+  bool prepare(Request &request) REQUIRES(mutex_);
+
+  /// 提交队列中的请求
+  void enter(unsigned int count) REQUIRES(mutex_);
+
+  /// 完成线程的执行函数
+  void reap();
+
+  /// 处理完成队列中所有的CQE，如果遇到了完成线程的退出请求，则返回true
+  bool complete() REQUIRES(cq_mutex_);
+
+  int ring_fd_ = -1;
+  void *sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void *cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  void *sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+  SubmissionQueue sq_;
+  CompletionQueue cq_;
+
+  /// 提交请求时持有
+  marl::mutex mutex_;
+  /// 处理CQE时持有，完成线程和提交者都可能处理CQE
+  std::mutex cq_mutex_;
+  /// 在途的请求数减少时通知
+  ConditionVariable slots_;
+  GUARDED_BY(mutex_) unsigned int in_flight_ = 0;
+  std::atomic<bool> stopping_{false};
+  std::thread reaper_;
+};
+
+/// 以下函数使用当前线程绑定的Scheduler的Ring执行请求，并且阻塞当前fiber直到完成\n
+/// 如果当前线程没有绑定Scheduler，则直接在当前线程上执行对应的系统调用\n
+/// 返回值和Request::result相同：成功时为传输的字节数，失败时为-errno
+
+MARL_EXPORT
+ssize_t read(int fd, void *buf, size_t len, off_t offset);
+
+MARL_EXPORT
+ssize_t write(int fd, const void *buf, size_t len, off_t offset);
+
+MARL_EXPORT
+ssize_t readv(int fd, const iovec *iov, int iovcnt, off_t offset);
+
+MARL_EXPORT
+ssize_t writev(int fd, const iovec *iov, int iovcnt, off_t offset);
+
+MARL_EXPORT
+int fsync(int fd);
+
+MARL_EXPORT
+int fdatasync(int fd);
+
+/// 批量提交count个请求，阻塞当前fiber直到所有请求都完成
+MARL_EXPORT
+void submit(Request *requests, size_t count);
+
+} // namespace marl::io
+} // namespace marl
+
+#endif //MINIMARL_INCLUDE_MARL_IO_HPP_
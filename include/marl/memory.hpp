@@ -4,6 +4,7 @@
 #include "debug.hpp"
 #include "export.hpp"
 
+#include <array>
 #include <cstdlib>
 #include <cstdint>
 #include <memory>
@@ -18,6 +19,9 @@ struct StlAllocator;
 MARL_EXPORT
 size_t pageSize();
 
+/// CPU缓存行的大小，用于避免多个线程频繁修改的数据之间发生伪共享
+static constexpr size_t CacheLineSize = 64;
+
 /// 将val向上对齐到alignment
 template<typename T>
 MARL_NO_EXPORT inline T alignUp(T val, T alignment) {
@@ -114,11 +118,14 @@ class Allocator {
 
 template<typename T>
 void Allocator::Deleter::operator()(T *object) {
-  object->~T();
+  for (size_t i = 0; i < count; ++i) {
+    object[i].~T();
+  }
 
   Allocation allocation;
   allocation.ptr = object;
   allocation.request.size = sizeof(T) * count;
+  allocation.request.alignment = alignof(T);
   allocation.request.usage = Allocation::Usage::Create;
   allocator->free(allocation);
 }
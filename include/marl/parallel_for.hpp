@@ -0,0 +1,107 @@
+#ifndef MINIMARL_INCLUDE_MARL_PARALLEL_FOR_HPP_
+#define MINIMARL_INCLUDE_MARL_PARALLEL_FOR_HPP_
+
+#include "debug.hpp"
+#include "export.hpp"
+#include "scheduler.hpp"
+#include "wait_group.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace marl {
+
+namespace detail {
+
+/// 没有指定粒度时，每个工作线程（以及调用者）平均分到的块数
+constexpr size_t ParallelForChunksPerThread = 64;
+
+/// parallel_for()和parallel_reduce()的共享状态，位于调用者的栈上\n
+/// F以f(begin, end)的形式被调用，每次处理至多grain个连续的元素
+template<typename F>
+class ParallelFor {
+ public:
+  MARL_NO_EXPORT inline ParallelFor(F &f, size_t grain, const Scheduler *scheduler)
+      : f_(f), grain_(grain), scheduler_(scheduler) {}
+
+  /// 执行[begin, end)，每执行完grain个元素检查一次是否有空闲的工作线程，
+  /// 有则将剩余元素的后一半交给它们（lazy binary splitting），否则继续在当前线程上执行
+  MARL_NO_EXPORT inline void run(size_t begin, size_t end) {
+    while (begin < end) {
+      if (end - begin > grain_ && shouldSplit()) {
+        auto mid = begin + (end - begin) / 2;
+        spawn(mid, end);
+        end = mid;
+        continue;
+      }
+      auto chunk_end = begin + std::min(grain_, end - begin);
+      f_(begin, chunk_end);
+      begin = chunk_end;
+    }
+  }
+
+  /// 等待所有被拆分出去的部分执行完
+  MARL_NO_EXPORT inline void wait() { wg_.wait(); }
+
+ private:
+  /// 只有空闲的工作线程多于尚未开始执行的部分时才拆分，避免拆分出的部分堆积在忙碌的工作线程上
+  MARL_NO_EXPORT inline bool shouldSplit() const {
+    return unstarted_.load(std::memory_order_relaxed) < scheduler_->idleWorkerCount();
+  }
+
+  MARL_NO_EXPORT inline void spawn(size_t begin, size_t end) {
+    wg_.add();
+    unstarted_.fetch_add(1, std::memory_order_relaxed);
+    schedule(Task([this, begin, end] {
+      unstarted_.fetch_sub(1, std::memory_order_relaxed);
+      run(begin, end);
+      wg_.done();
+    }));
+  }
+
+  F &f_;
+  const size_t grain_;
+  const Scheduler *const scheduler_;
+  std::atomic<int> unstarted_{0};
+  InlineWaitGroup wg_;
+};
+
+/// 没有指定粒度时，根据元素个数n和工作线程数选择粒度
+MARL_NO_EXPORT inline size_t defaultGrain(size_t n, const Scheduler *scheduler) {
+  auto num_threads = static_cast<size_t>(scheduler->config().worker_thread.count) + 1;
+  return std::max<size_t>(n / (num_threads * ParallelForChunksPerThread), 1);
+}
+
+} // namespace detail
+
+/// 对[begin, end)中的每一个i调用f(i)，返回时所有的调用都已完成\n
+/// 调用者所在的fiber会参与执行：它从整个范围开始，每执行完grain个元素就检查一次是否有空闲的工作线程，
+/// 只有存在空闲的工作线程时，才将剩余部分的后一半调度出去，被调度出去的部分以同样的方式继续拆分，
+/// 因此工作线程都忙碌时几乎没有调度的开销，开销不均匀的循环也能被空闲的工作线程分担\n
+/// grain为0时自动选择，使每个线程平均检查ParallelForChunksPerThread次
+/// @note 必须在绑定了Scheduler的线程上调用，f会被多个线程并发地调用
+template<typename F>
+MARL_NO_EXPORT inline void parallel_for(size_t begin, size_t end, F &&f, size_t grain = 0) {
+  if (begin >= end) {
+    return;
+  }
+  auto scheduler = Scheduler::get();
+  MARL_ASSERT(scheduler != nullptr, "marl::parallel_for() called without a bound scheduler");
+  if (grain == 0) {
+    grain = detail::defaultGrain(end - begin, scheduler);
+  }
+  auto body = [&f](size_t chunk_begin, size_t chunk_end) {
+    for (auto i = chunk_begin; i < chunk_end; ++i) {
+      f(i);
+    }
+  };
+  detail::ParallelFor<decltype(body)> state(body, grain, scheduler);
+  state.run(begin, end);
+  state.wait();
+}
+
+} // namespace marl
+
+#endif // MINIMARL_INCLUDE_MARL_PARALLEL_FOR_HPP_
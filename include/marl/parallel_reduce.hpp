@@ -0,0 +1,148 @@
+#ifndef MINIMARL_INCLUDE_MARL_PARALLEL_REDUCE_HPP_
+#define MINIMARL_INCLUDE_MARL_PARALLEL_REDUCE_HPP_
+
+#include "debug.hpp"
+#include "export.hpp"
+#include "memory.hpp"
+#include "parallel_for.hpp"
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace marl {
+
+/// parallel_reduce()合并部分结果的方式
+enum class ReduceMode {
+  /// combine满足结合律和交换律，每个工作线程把自己执行的部分累积到独占的部分结果中，
+  /// 部分结果的合并顺序取决于调度，浮点数求和等不严格满足结合律的运算每次的结果可能不同
+  Commutative,
+  /// combine只需要满足结合律，范围被划分为与线程数无关的固定的块，每块有一个部分结果，
+  /// 部分结果按照下标顺序两两合并，对于同样的输入每次都得到相同的结果
+  Deterministic,
+};
+
+namespace detail {
+
+/// Deterministic模式下没有指定粒度时，范围被划分的块数
+constexpr size_t ReduceDeterministicBlocks = 1024;
+
+/// 树形合并时，每一层中两两合并的对数超过该值才会被拆分给其他工作线程
+constexpr size_t ReduceCombineGrain = 64;
+
+/// 独占一个缓存行的部分结果，避免不同线程更新相邻的部分结果时产生伪共享
+template<typename T>
+struct alignas(CacheLineSize) ReducePartial {
+  MARL_NO_EXPORT inline explicit ReducePartial(const T &value) : value(value) {}
+
+  T value;
+};
+
+/// 将[begin, end)中的元素依次累积到acc中\n
+/// map可以是T map(i)，此时acc = combine(acc, map(i))，
+/// 也可以是void map(T &acc, i)，由map直接更新acc（例如直方图只需要增加一个桶的计数）
+template<typename T, typename Map, typename Combine>
+MARL_NO_EXPORT inline void accumulate(T &acc, size_t begin, size_t end, Map &map, Combine &combine) {
+  if constexpr (std::is_invocable_v<Map &, T &, size_t>) {
+    for (auto i = begin; i < end; ++i) {
+      map(acc, i);
+    }
+  } else {
+    for (auto i = begin; i < end; ++i) {
+      acc = combine(acc, map(i));
+    }
+  }
+}
+
+/// 按照下标顺序两两合并partials中的count个部分结果，结果保存在partials[0]中\n
+/// 同一层中的合并互不相关，合并的对数较多时这一层会像parallel_for()一样被拆分给空闲的工作线程
+template<typename T, typename Combine>
+MARL_NO_EXPORT inline void treeCombine(ReducePartial<T> *partials, size_t count,
+                                       Combine &combine, const Scheduler *scheduler) {
+  for (size_t stride = 1; stride < count; stride *= 2) {
+    auto num_pairs = (count - stride + 2 * stride - 1) / (2 * stride);
+    auto level = [&](size_t pair_begin, size_t pair_end) {
+      for (auto pair = pair_begin; pair < pair_end; ++pair) {
+        auto &left = partials[pair * 2 * stride].value;
+        left = combine(left, partials[pair * 2 * stride + stride].value);
+      }
+    };
+    if (num_pairs <= ReduceCombineGrain) {
+      level(0, num_pairs);
+      continue;
+    }
+    ParallelFor<decltype(level)> state(level, ReduceCombineGrain, scheduler);
+    state.run(0, num_pairs);
+    state.wait();
+  }
+}
+
+} // namespace detail
+
+/// 将[begin, end)中的每一个元素映射后用combine合并，返回合并的结果，identity是combine的单位元\n
+/// map可以是T map(size_t i)，也可以是void map(T &acc, size_t i)，后者直接把元素i累积到acc中\n
+/// 范围的拆分方式和parallel_for()相同，每一块先从identity开始累积到局部变量中：
+/// - Commutative模式下，局部结果被合并到当前工作线程独占的、按缓存行对齐的部分结果中，
+///   所有工作线程执行完之后再将这些部分结果两两合并，整个过程没有原子操作和锁
+/// - Deterministic模式下，范围被划分为固定大小的块（grain为块的大小，为0时划分为ReduceDeterministicBlocks块），
+///   每块的结果按照下标顺序两两合并，合并的顺序与线程数和调度无关，combine可以不满足交换律
+/// @note 必须在绑定了Scheduler的线程上调用，map和combine会被多个线程并发地调用，
+///       Commutative模式下combine在合并到部分结果时不能阻塞
+template<typename T, typename Map, typename Combine>
+MARL_NO_EXPORT inline T parallel_reduce(size_t begin, size_t end, T identity, Map &&map, Combine &&combine,
+                                        ReduceMode mode = ReduceMode::Commutative, size_t grain = 0) {
+  if (begin >= end) {
+    return identity;
+  }
+  auto scheduler = Scheduler::get();
+  MARL_ASSERT(scheduler != nullptr, "marl::parallel_reduce() called without a bound scheduler");
+  auto allocator = scheduler->config().allocator;
+  auto n = end - begin;
+
+  if (mode == ReduceMode::Deterministic) {
+    if (grain == 0) {
+      grain = std::max<size_t>((n + detail::ReduceDeterministicBlocks - 1) / detail::ReduceDeterministicBlocks, 1);
+    }
+    auto num_blocks = (n + grain - 1) / grain;
+    auto partials = allocator->make_unique_n<detail::ReducePartial<T>>(num_blocks, identity);
+    auto blocks = [&](size_t block_begin, size_t block_end) {
+      for (auto block = block_begin; block < block_end; ++block) {
+        auto first = begin + block * grain;
+        auto last = std::min(first + grain, end);
+        detail::accumulate(partials.get()[block].value, first, last, map, combine);
+      }
+    };
+    detail::ParallelFor<decltype(blocks)> state(blocks, 1, scheduler);
+    state.run(0, num_blocks);
+    state.wait();
+    detail::treeCombine(partials.get(), num_blocks, combine, scheduler);
+    return std::move(partials.get()[0].value);
+  }
+
+  // 第0个部分结果由调用者所在的线程（非工作线程）使用
+  auto num_partials = static_cast<size_t>(scheduler->config().worker_thread.count) + 1;
+  auto partials = allocator->make_unique_n<detail::ReducePartial<T>>(num_partials, identity);
+  if (grain == 0) {
+    grain = detail::defaultGrain(n, scheduler);
+  }
+  auto chunk = [&](size_t chunk_begin, size_t chunk_end) {
+    T acc = identity;
+    detail::accumulate(acc, chunk_begin, chunk_end, map, combine);
+    // 同一个工作线程上的fiber是协作式调度的，读取和写回部分结果之间不会切换到其他fiber
+    auto id = Scheduler::currentWorkerId();
+    auto idx = id < 0 || num_partials == 1 ? 0 : 1 + static_cast<size_t>(id) % (num_partials - 1);
+    auto &partial = partials.get()[idx].value;
+    partial = combine(partial, acc);
+  };
+  detail::ParallelFor<decltype(chunk)> state(chunk, grain, scheduler);
+  state.run(begin, end);
+  state.wait();
+  detail::treeCombine(partials.get(), num_partials, combine, scheduler);
+  return std::move(partials.get()[0].value);
+}
+
+} // namespace marl
+
+#endif // MINIMARL_INCLUDE_MARL_PARALLEL_REDUCE_HPP_
@@ -0,0 +1,115 @@
+#ifndef MINIMARL_INCLUDE_MARL_PARALLEL_SCAN_HPP_
+#define MINIMARL_INCLUDE_MARL_PARALLEL_SCAN_HPP_
+
+#include "debug.hpp"
+#include "export.hpp"
+#include "memory.hpp"
+#include "parallel_for.hpp"
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+namespace marl {
+
+/// parallel_scan()输出的前缀
+enum class ScanMode {
+  /// out[i] = in[0] op in[1] op ... op in[i]
+  Inclusive,
+  /// out[0] = identity，out[i] = in[0] op ... op in[i - 1]
+  Exclusive,
+};
+
+namespace detail {
+
+/// 没有指定块大小时，每块输入占用的字节数，使一块能够放在L2缓存中
+constexpr size_t ScanBlockBytes = 64 * 1024;
+
+/// 从carry开始对[first, first + n)做顺序的前缀扫描，结果写入out，返回整块的累积结果\n
+/// 先读取in[i]再写入out[i]，因此out可以和first相同
+template<typename RandomIt, typename OutputIt, typename T, typename Op>
+MARL_NO_EXPORT inline T scanBlock(RandomIt first, size_t n, OutputIt out, T carry, Op &op, ScanMode mode) {
+  if (mode == ScanMode::Inclusive) {
+    for (size_t i = 0; i < n; ++i) {
+      carry = op(carry, first[i]);
+      out[i] = carry;
+    }
+  } else {
+    for (size_t i = 0; i < n; ++i) {
+      T value = first[i];
+      out[i] = carry;
+      carry = op(carry, value);
+    }
+  }
+  return carry;
+}
+
+} // namespace detail
+
+/// 对[first, last)做前缀扫描，结果写入从out开始的位置，op需要满足结合律，identity是op的单位元\n
+/// 使用分块的两遍算法：输入被划分为大小为block的块（为0时每块为ScanBlockBytes字节），
+/// 第一遍并行地求出每块的累积结果，然后按顺序对这些块的结果做扫描得到每块的前缀，
+/// 第二遍并行地以各自的前缀为初值扫描每一块，每个元素只被读取两次、写入一次\n
+/// op的合并顺序总是和下标顺序相同，因此op可以不满足交换律；输入只有一块时退化为顺序扫描
+/// @note 必须在绑定了Scheduler的线程上调用，first和out都需要是随机访问迭代器，out可以和first相同，但不能和[first, last)部分重叠
+template<typename RandomIt, typename OutputIt, typename T, typename Op>
+MARL_NO_EXPORT inline void parallel_scan(RandomIt first, RandomIt last, OutputIt out, T identity, Op &&op,
+                                         ScanMode mode = ScanMode::Inclusive, size_t block = 0) {
+  auto n = static_cast<size_t>(std::distance(first, last));
+  if (n == 0) {
+    return;
+  }
+  auto scheduler = Scheduler::get();
+  MARL_ASSERT(scheduler != nullptr, "marl::parallel_scan() called without a bound scheduler");
+  if (block == 0) {
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+    block = std::max<size_t>(detail::ScanBlockBytes / sizeof(Value), 1);
+  }
+  auto num_blocks = (n + block - 1) / block;
+  if (num_blocks == 1 || scheduler->config().worker_thread.count == 0) {
+    detail::scanBlock(first, n, out, std::move(identity), op, mode);
+    return;
+  }
+
+  // 第一遍：求出除了最后一块之外每一块的累积结果，最后一块的结果不会被用到
+  auto sums = scheduler->config().allocator->make_unique_n<T>(num_blocks, identity);
+  auto reduce = [&](size_t block_begin, size_t block_end) {
+    for (auto b = block_begin; b < block_end; ++b) {
+      auto begin = first + static_cast<std::ptrdiff_t>(b * block);
+      T acc = identity;
+      for (size_t i = 0; i < block; ++i) {
+        acc = op(acc, begin[static_cast<std::ptrdiff_t>(i)]);
+      }
+      sums.get()[b] = std::move(acc);
+    }
+  };
+  detail::ParallelFor<decltype(reduce)> reduce_state(reduce, 1, scheduler);
+  reduce_state.run(0, num_blocks - 1);
+  reduce_state.wait();
+
+  // 块数只有元素数的1/block，顺序地把每块的结果替换为该块之前所有元素的累积结果
+  T carry = identity;
+  for (size_t b = 0; b < num_blocks; ++b) {
+    T sum = std::move(sums.get()[b]);
+    sums.get()[b] = carry;
+    carry = op(carry, sum);
+  }
+
+  // 第二遍：以每块的前缀为初值扫描每一块
+  auto scan = [&](size_t block_begin, size_t block_end) {
+    for (auto b = block_begin; b < block_end; ++b) {
+      auto offset = static_cast<std::ptrdiff_t>(b * block);
+      detail::scanBlock(first + offset, std::min(block, n - b * block), out + offset,
+                        sums.get()[b], op, mode);
+    }
+  };
+  detail::ParallelFor<decltype(scan)> scan_state(scan, 1, scheduler);
+  scan_state.run(0, num_blocks);
+  scan_state.wait();
+}
+
+} // namespace marl
+
+#endif // MINIMARL_INCLUDE_MARL_PARALLEL_SCAN_HPP_
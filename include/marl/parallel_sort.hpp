@@ -0,0 +1,271 @@
+#ifndef MINIMARL_INCLUDE_MARL_PARALLEL_SORT_HPP_
+#define MINIMARL_INCLUDE_MARL_PARALLEL_SORT_HPP_
+
+#include "debug.hpp"
+#include "export.hpp"
+#include "memory.hpp"
+#include "parallel_for.hpp"
+#include "scheduler.hpp"
+#include "wait_group.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+namespace marl {
+
+namespace detail {
+
+/// 不超过该长度的子序列直接使用std::sort()
+constexpr size_t SortSerialCutoff = 16 * 1024;
+
+/// 两个有序序列的总长度不超过该值时直接使用std::merge()
+constexpr size_t SortMergeCutoff = 16 * 1024;
+
+/// 基数排序每一趟处理的位数
+constexpr unsigned RadixBits = 8;
+constexpr size_t RadixBuckets = size_t(1) << RadixBits;
+
+/// 基数排序中每块至少包含的元素个数，以及每个线程平均分到的块数
+constexpr size_t RadixMinBlock = 64 * 1024;
+constexpr size_t RadixBlocksPerThread = 4;
+
+/// 排序使用的临时缓冲区，从Allocator中分配\n
+/// 平凡的类型不做初始化，否则默认构造每个元素，使得元素可以被移动赋值到缓冲区中
+template<typename T>
+class SortBuffer {
+ public:
+  MARL_NO_EXPORT inline SortBuffer(Allocator *allocator, size_t n) : allocator_(allocator), n_(n) {
+    Allocation::Request request;
+    request.size = sizeof(T) * n;
+    request.alignment = std::max(alignof(T), CacheLineSize);
+    request.usage = Allocation::Usage::Create;
+    allocation_ = allocator_->allocate(request);
+    if constexpr (!std::is_trivially_default_constructible_v<T>) {
+      for (size_t i = 0; i < n_; ++i) {
+        new(data() + i) T();
+      }
+    }
+  }
+
+  MARL_NO_EXPORT inline ~SortBuffer() {
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      for (size_t i = 0; i < n_; ++i) {
+        data()[i].~T();
+      }
+    }
+    allocator_->free(allocation_);
+  }
+
+  SortBuffer(const SortBuffer &) = delete;
+  SortBuffer &operator=(const SortBuffer &) = delete;
+
+  MARL_NO_EXPORT inline T *data() const { return reinterpret_cast<T *>(allocation_.ptr); }
+
+ private:
+  Allocator *const allocator_;
+  const size_t n_;
+  Allocation allocation_;
+};
+
+/// 执行left()和right()，有空闲的工作线程时right()被调度到其他线程上执行，否则依次在当前线程上执行
+template<typename L, typename R>
+MARL_NO_EXPORT inline void forkJoin(const Scheduler *scheduler, L &&left, R &&right) {
+  if (scheduler->idleWorkerCount() == 0) {
+    left();
+    right();
+    return;
+  }
+  InlineWaitGroup wg(1);
+  schedule(Task([&] {
+    right();
+    wg.done();
+  }));
+  left();
+  wg.wait();
+}
+
+/// 将有序的[x, x + nx)和[y, y + ny)移动合并到out中，x中的元素排在相等的y中的元素之前\n
+/// 序列较长时，取较长序列的中点，在另一个序列中二分查找对应的位置，将合并拆分为两个独立的部分
+template<typename Src, typename Dst, typename Compare>
+MARL_NO_EXPORT inline void parallelMerge(Src x, size_t nx, Src y, size_t ny, Dst out,
+                                         Compare &comp, const Scheduler *scheduler) {
+  if (nx + ny <= SortMergeCutoff) {
+    std::merge(std::make_move_iterator(x), std::make_move_iterator(x + nx),
+               std::make_move_iterator(y), std::make_move_iterator(y + ny), out, comp);
+    return;
+  }
+  size_t mx, my;
+  if (nx >= ny) {
+    mx = nx / 2;
+    my = static_cast<size_t>(std::lower_bound(y, y + ny, x[mx], comp) - y);
+  } else {
+    my = ny / 2;
+    mx = static_cast<size_t>(std::upper_bound(x, x + nx, y[my], comp) - x);
+  }
+  forkJoin(scheduler, [&] {
+    parallelMerge(x, mx, y, my, out, comp, scheduler);
+  }, [&] {
+    parallelMerge(x + mx, nx - mx, y + my, ny - my, out + (mx + my), comp, scheduler);
+  });
+}
+
+/// 对[a, a + n)排序，to_b为true时结果被移动到b中，否则留在a中，b是同样长度的缓冲区\n
+/// 两半以相反的to_b递归排序，使它们的结果恰好位于合并的源中，每一层只移动一次元素
+template<typename A, typename B, typename Compare>
+MARL_NO_EXPORT inline void mergeSort(A a, B b, size_t n, bool to_b, Compare &comp, const Scheduler *scheduler) {
+  if (n <= SortSerialCutoff) {
+    std::sort(a, a + n, comp);
+    if (to_b) {
+      std::move(a, a + n, b);
+    }
+    return;
+  }
+  auto half = n / 2;
+  forkJoin(scheduler, [&] {
+    mergeSort(a, b, half, !to_b, comp, scheduler);
+  }, [&] {
+    mergeSort(a + half, b + half, n - half, !to_b, comp, scheduler);
+  });
+  if (to_b) {
+    parallelMerge(a, half, a + half, n - half, b, comp, scheduler);
+  } else {
+    parallelMerge(b, half, b + half, n - half, a, comp, scheduler);
+  }
+}
+
+/// 整数键按照RadixBits位分组的第shift位开始的一组，有符号数的符号位被翻转，使负数排在前面
+template<typename T>
+MARL_NO_EXPORT inline size_t radixDigit(T key, unsigned shift) {
+  using U = std::make_unsigned_t<T>;
+  constexpr U flip = std::is_signed_v<T> ? U(U(1) << (std::numeric_limits<U>::digits - 1)) : U(0);
+  return static_cast<size_t>((static_cast<U>(key) ^ flip) >> shift) & (RadixBuckets - 1);
+}
+
+/// 基数排序的一趟：把[src, src + n)按照第shift位开始的一组稳定地分配到dst中\n
+/// 输入被划分为num_blocks块，先并行地统计每块中每个桶的元素个数，
+/// 再按照桶优先、块其次的顺序求出每块每个桶的起始位置，最后并行地分配每一块\n
+/// counts的长度为num_blocks * RadixBuckets
+/// @return 所有元素都落在同一个桶时不需要分配，返回false
+template<typename Src, typename Dst>
+MARL_NO_EXPORT inline bool radixPass(Src src, Dst dst, size_t n, unsigned shift, size_t *counts,
+                                     size_t num_blocks, const Scheduler *scheduler) {
+  auto block_begin = [&](size_t block) { return n * block / num_blocks; };
+  auto count = [&](size_t first_block, size_t last_block) {
+    for (auto block = first_block; block < last_block; ++block) {
+      auto block_counts = counts + block * RadixBuckets;
+      std::fill(block_counts, block_counts + RadixBuckets, 0);
+      for (auto i = block_begin(block), end = block_begin(block + 1); i < end; ++i) {
+        ++block_counts[radixDigit(src[i], shift)];
+      }
+    }
+  };
+  ParallelFor<decltype(count)> count_state(count, 1, scheduler);
+  count_state.run(0, num_blocks);
+  count_state.wait();
+
+  size_t offset = 0;
+  for (size_t digit = 0; digit < RadixBuckets; ++digit) {
+    auto digit_begin = offset;
+    for (size_t block = 0; block < num_blocks; ++block) {
+      auto &c = counts[block * RadixBuckets + digit];
+      auto block_count = c;
+      c = offset;
+      offset += block_count;
+    }
+    if (offset - digit_begin == n) {
+      return false;
+    }
+  }
+
+  auto scatter = [&](size_t first_block, size_t last_block) {
+    for (auto block = first_block; block < last_block; ++block) {
+      auto block_offsets = counts + block * RadixBuckets;
+      for (auto i = block_begin(block), end = block_begin(block + 1); i < end; ++i) {
+        dst[block_offsets[radixDigit(src[i], shift)]++] = src[i];
+      }
+    }
+  };
+  ParallelFor<decltype(scatter)> scatter_state(scatter, 1, scheduler);
+  scatter_state.run(0, num_blocks);
+  scatter_state.wait();
+  return true;
+}
+
+/// 对整数键做LSD基数排序，每一趟处理RadixBits位，所有键在某一组上都相同时跳过这一趟
+template<typename RandomIt>
+MARL_NO_EXPORT inline void radixSort(RandomIt first, size_t n, const Scheduler *scheduler) {
+  using T = typename std::iterator_traits<RandomIt>::value_type;
+  auto allocator = scheduler->config().allocator;
+  auto num_threads = static_cast<size_t>(scheduler->config().worker_thread.count) + 1;
+  auto num_blocks = std::clamp<size_t>(n / RadixMinBlock, 1, num_threads * RadixBlocksPerThread);
+  auto counts = allocator->make_unique_n<size_t>(num_blocks * RadixBuckets);
+  SortBuffer<T> buffer(allocator, n);
+  bool in_buffer = false;
+  for (unsigned shift = 0; shift < std::numeric_limits<std::make_unsigned_t<T>>::digits; shift += RadixBits) {
+    auto moved = in_buffer
+                 ? radixPass(buffer.data(), first, n, shift, counts.get(), num_blocks, scheduler)
+                 : radixPass(first, buffer.data(), n, shift, counts.get(), num_blocks, scheduler);
+    if (moved) {
+      in_buffer = !in_buffer;
+    }
+  }
+  if (in_buffer) {
+    auto copy = [&](size_t begin, size_t end) {
+      std::copy(buffer.data() + begin, buffer.data() + end, first + begin);
+    };
+    ParallelFor<decltype(copy)> copy_state(copy, std::max<size_t>(n / num_blocks, 1), scheduler);
+    copy_state.run(0, n);
+    copy_state.wait();
+  }
+}
+
+} // namespace detail
+
+/// 使用comp对[first, last)排序，和std::sort()一样不保证相等元素的相对顺序\n
+/// 使用并行归并排序：序列被递归地分为两半，较短的子序列直接使用std::sort()，
+/// 有序的两半通过在较长一半的中点二分查找拆分为独立的部分并行地合并，
+/// 只有存在空闲的工作线程时才会把一半调度出去\n
+/// 合并使用的与输入等长的临时缓冲区从Scheduler的Allocator中分配
+/// @note 必须在绑定了Scheduler的线程上调用，元素需要可以默认构造和移动
+template<typename RandomIt, typename Compare>
+MARL_NO_EXPORT inline void parallel_sort(RandomIt first, RandomIt last, Compare comp) {
+  auto n = static_cast<size_t>(std::distance(first, last));
+  auto scheduler = Scheduler::get();
+  MARL_ASSERT(scheduler != nullptr, "marl::parallel_sort() called without a bound scheduler");
+  if (n <= detail::SortSerialCutoff || scheduler->config().worker_thread.count == 0) {
+    std::sort(first, last, comp);
+    return;
+  }
+  using T = typename std::iterator_traits<RandomIt>::value_type;
+  detail::SortBuffer<T> buffer(scheduler->config().allocator, n);
+  detail::mergeSort(first, buffer.data(), n, false, comp, scheduler);
+}
+
+/// 将[first, last)按照升序排序\n
+/// 整数键（bool除外）使用并行的LSD基数排序，其他类型和parallel_sort(first, last, std::less<>())相同
+/// @note 必须在绑定了Scheduler的线程上调用
+template<typename RandomIt>
+MARL_NO_EXPORT inline void parallel_sort(RandomIt first, RandomIt last) {
+  using T = typename std::iterator_traits<RandomIt>::value_type;
+  if constexpr (std::is_integral_v<T> && !std::is_same_v<T, bool>) {
+    auto n = static_cast<size_t>(std::distance(first, last));
+    auto scheduler = Scheduler::get();
+    MARL_ASSERT(scheduler != nullptr, "marl::parallel_sort() called without a bound scheduler");
+    if (n <= detail::SortSerialCutoff) {
+      std::sort(first, last);
+      return;
+    }
+    detail::radixSort(first, n, scheduler);
+  } else {
+    parallel_sort(first, last, std::less<>());
+  }
+}
+
+} // namespace marl
+
+#endif // MINIMARL_INCLUDE_MARL_PARALLEL_SORT_HPP_
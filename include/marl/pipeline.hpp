@@ -0,0 +1,314 @@
+#ifndef MINIMARL_INCLUDE_MARL_PIPELINE_HPP_
+#define MINIMARL_INCLUDE_MARL_PIPELINE_HPP_
+
+#include "containers.hpp"
+#include "debug.hpp"
+#include "export.hpp"
+#include "memory.hpp"
+#include "mutex.hpp"
+#include "wait_group.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace marl {
+
+class Pipeline;
+
+template<typename T>
+class PipelineStream;
+
+/// 流水线阶段的执行方式
+enum class StageMode {
+  /// 同一时刻只处理一个token，例如写文件或者更新不加锁的聚合结果
+  Serial,
+  /// 多个token可以在不同的工作线程上同时被处理
+  Parallel,
+};
+
+/// 串行阶段处理token的顺序
+enum class PipelineOrder {
+  /// 串行阶段按照源阶段产生token的顺序处理，输出的顺序和输入相同
+  Ordered,
+  /// 串行阶段按照token到达的顺序处理，不需要等待前面的token，输出的顺序不确定
+  Unordered,
+};
+
+/// Pipeline::stageStats()返回的单个阶段在最近一次run()中的统计数据
+struct PipelineStageStats {
+  /// 处理的token数
+  uint64_t items = 0;
+  /// 处理token花费的时间，并行阶段为所有线程的时间之和
+  std::chrono::nanoseconds busy{0};
+  /// 串行阶段中token因为阶段正忙或者还没有轮到它而被挂起的次数
+  uint64_t stalls = 0;
+  /// 按照run()的总时间计算的每秒处理的token数
+  double throughput = 0;
+  /// busy占run()的总时间的比例，串行阶段接近1时说明该阶段是整个流水线的瓶颈，
+  /// 并行阶段可以大于1，表示平均同时处理该阶段的线程数
+  double utilization = 0;
+};
+
+namespace detail {
+
+/// 流水线中一个阶段的类型无关的部分，包括串行阶段的调度状态和统计数据\n
+/// 阶段之间的数据保存在每个阶段自己的、按照token所在的槽位索引的输出数组中
+class PipelineStage {
+ public:
+  MARL_NO_EXPORT inline PipelineStage(StageMode mode, Allocator *allocator, size_t max_tokens)
+      : mode(mode),
+        waiting(allocator->make_unique_n<size_t>(max_tokens)) {}
+
+  virtual ~PipelineStage() = default;
+
+  /// 通过allocator销毁并释放当前阶段，各个子类以自己的实际类型调用Allocator::destroy()
+  virtual void destroy(Allocator *allocator) = 0;
+
+  /// 处理位于slot的token：从上一个阶段的输出中取出数据，将结果写入自己的输出
+  /// @return 源阶段没有更多数据时返回false，其他阶段总是返回true
+  virtual bool process(size_t slot) = 0;
+
+  const StageMode mode;
+
+  // 以下为串行阶段的调度状态，由mutex保护
+  marl::mutex mutex;
+  /// 是否有token正在被处理
+  bool busy = false;
+  /// Ordered模式下下一个要处理的token的序号
+  uint64_t next_seq = 0;
+  /// 被挂起的token的槽位加1，为0表示空\n
+  /// Ordered模式下按照序号对max_tokens取模索引，同时存在的token的序号之差小于max_tokens，因此不会冲突；
+  /// 源阶段和Unordered模式下是一个先进先出的环形队列
+  const Allocator::unique_ptr<size_t> waiting;
+  size_t head = 0;
+  size_t count = 0;
+
+  // 统计数据，并行阶段会被多个线程同时更新，因此独占缓存行
+  alignas(CacheLineSize) std::atomic<uint64_t> items{0};
+  std::atomic<uint64_t> busy_ns{0};
+  std::atomic<uint64_t> stalls{0};
+};
+
+/// 源阶段：F的签名为std::optional<Out>()，返回std::nullopt表示没有更多数据
+template<typename Out, typename F>
+class PipelineSource : public PipelineStage {
+ public:
+  MARL_NO_EXPORT inline PipelineSource(F &&f, Allocator *allocator, size_t max_tokens)
+      : PipelineStage(StageMode::Serial, allocator, max_tokens),
+        f_(std::forward<F>(f)),
+        output(allocator->make_unique_n<std::optional<Out>>(max_tokens)) {}
+
+  MARL_NO_EXPORT inline void destroy(Allocator *allocator) override { allocator->destroy(this); }
+
+  MARL_NO_EXPORT inline bool process(size_t slot) override {
+    auto item = f_();
+    if (!item) {
+      return false;
+    }
+    output.get()[slot] = std::move(item);
+    return true;
+  }
+
+ private:
+  std::decay_t<F> f_;
+
+ public:
+  const Allocator::unique_ptr<std::optional<Out>> output;
+};
+
+/// 中间阶段：F的签名为Out(In &&)
+template<typename In, typename Out, typename F>
+class PipelineTransform : public PipelineStage {
+ public:
+  MARL_NO_EXPORT inline PipelineTransform(StageMode mode, F &&f, std::optional<In> *input,
+                                          Allocator *allocator, size_t max_tokens)
+      : PipelineStage(mode, allocator, max_tokens),
+        f_(std::forward<F>(f)),
+        input_(input),
+        output(allocator->make_unique_n<std::optional<Out>>(max_tokens)) {}
+
+  MARL_NO_EXPORT inline void destroy(Allocator *allocator) override { allocator->destroy(this); }
+
+  MARL_NO_EXPORT inline bool process(size_t slot) override {
+    auto &in = input_[slot];
+    output.get()[slot].emplace(f_(std::move(*in)));
+    in.reset();
+    return true;
+  }
+
+ private:
+  std::decay_t<F> f_;
+  std::optional<In> *const input_;
+
+ public:
+  const Allocator::unique_ptr<std::optional<Out>> output;
+};
+
+/// 汇阶段：F的签名为void(In &&)
+template<typename In, typename F>
+class PipelineSink : public PipelineStage {
+ public:
+  MARL_NO_EXPORT inline PipelineSink(StageMode mode, F &&f, std::optional<In> *input,
+                                     Allocator *allocator, size_t max_tokens)
+      : PipelineStage(mode, allocator, max_tokens),
+        f_(std::forward<F>(f)),
+        input_(input) {}
+
+  MARL_NO_EXPORT inline void destroy(Allocator *allocator) override { allocator->destroy(this); }
+
+  MARL_NO_EXPORT inline bool process(size_t slot) override {
+    auto &in = input_[slot];
+    f_(std::move(*in));
+    in.reset();
+    return true;
+  }
+
+ private:
+  std::decay_t<F> f_;
+  std::optional<In> *const input_;
+};
+
+} // namespace detail
+
+/// 由一个源阶段和若干个串行或并行的阶段组成的流水线，在当前绑定的Scheduler上执行\n
+/// 同时在流水线中的token数不超过max_tokens：每个token占用一个槽位，处理完最后一个阶段之后回到源阶段读取下一个数据，
+/// 槽位都被占用时源阶段不再读取，因此下游较慢时上游会自然地停下来，不会向任务队列中堆积任务\n
+/// token在一个线程上依次经过各个阶段，遇到正忙或者还没有轮到它的串行阶段时被挂起（只记录槽位，不占用fiber），
+/// 串行阶段处理完当前token之后，如果有可以处理的被挂起的token，当前线程留在该阶段继续处理它，
+/// 而把刚处理完的token调度到其他工作线程上执行后面的阶段，因此串行阶段不会因为线程之间的交接而停顿\n
+/// 例如：
+/// ```
+/// marl::Pipeline pipeline(64);
+/// pipeline.source([&]() -> std::optional<std::string> { ... })
+///     .then(marl::StageMode::Parallel, [](std::string &&line) { return parse(line); })
+///     .sink(marl::StageMode::Serial, [&](Record &&record) { write(record); });
+/// pipeline.run();
+/// ```
+class Pipeline {
+ public:
+  MARL_EXPORT
+  Pipeline(size_t max_tokens, PipelineOrder order = PipelineOrder::Ordered,
+           Allocator *allocator = Allocator::Default);
+
+  MARL_EXPORT
+  ~Pipeline();
+
+  Pipeline(const Pipeline &) = delete;
+  Pipeline &operator=(const Pipeline &) = delete;
+
+  /// 设置源阶段，F的签名为std::optional<Out>()，返回std::nullopt表示没有更多数据\n
+  /// 源阶段总是串行的，必须是第一个被添加的阶段
+  template<typename F>
+  MARL_NO_EXPORT inline auto source(F &&f);
+
+  /// 处理数据直到源阶段没有更多数据，并且所有数据都经过了最后一个阶段\n
+  /// 调用者所在的fiber会参与执行，可以多次调用
+  /// @note 必须在绑定了Scheduler的线程上调用，同一时刻只能有一次run()
+  MARL_EXPORT
+  void run();
+
+  /// 返回阶段的个数，源阶段为第0个阶段
+  MARL_NO_EXPORT inline size_t numStages() const { return stages_.size(); }
+
+  /// 返回第stage个阶段在最近一次run()中的统计数据
+  MARL_EXPORT
+  PipelineStageStats stageStats(size_t stage) const;
+
+  /// 返回最近一次run()的总时间
+  MARL_NO_EXPORT inline std::chrono::nanoseconds elapsed() const { return elapsed_; }
+
+ private:
+  template<typename T>
+  friend class PipelineStream;
+
+  using Stage = detail::PipelineStage;
+
+  MARL_NO_EXPORT inline void addStage(Stage *stage, const void *output) {
+    stages_.push_back(stage);
+    last_output_ = output;
+  }
+
+  /// 从第stage个阶段开始处理位于slot的token，acquired为true表示已经获得了该串行阶段
+  void advance(size_t slot, size_t stage, bool acquired);
+  /// 尝试获得串行阶段，失败时token被挂起或者（源阶段已经结束时）退出
+  bool acquire(size_t slot, size_t stage);
+  /// 释放串行阶段，如果有挂起的token可以被处理，则阶段保持busy状态并交给它
+  /// @return 接手阶段的token的槽位加1，没有时返回0
+  size_t release(size_t stage);
+  /// token退出流水线
+  void retire();
+
+  Allocator *const allocator_;
+  const size_t max_tokens_;
+  const PipelineOrder order_;
+  containers::vector<Stage *, 8> stages_;
+  /// 最后一个阶段的输出数组，汇阶段没有输出，此时为nullptr
+  const void *last_output_ = nullptr;
+  /// 每个槽位中token的序号
+  const Allocator::unique_ptr<uint64_t> seqs_;
+  /// 源阶段产生的下一个token的序号，以及源阶段是否已经结束，由源阶段的mutex保护
+  uint64_t next_item_ = 0;
+  bool source_done_ = false;
+  InlineWaitGroup retired_;
+  std::chrono::nanoseconds elapsed_{0};
+};
+
+/// Pipeline::source()和PipelineStream::then()的返回值，表示最后一个阶段输出的类型为T的数据流
+template<typename T>
+class PipelineStream {
+ public:
+  /// 添加一个阶段，F的签名为Out(T &&)
+  template<typename F>
+  MARL_NO_EXPORT inline auto then(StageMode mode, F &&f) {
+    using Out = std::decay_t<std::invoke_result_t<F &, T &&>>;
+    checkLast();
+    auto stage = pipeline_->allocator_->template create<detail::PipelineTransform<T, Out, F>>(
+        mode, std::forward<F>(f), output_, pipeline_->allocator_, pipeline_->max_tokens_);
+    pipeline_->addStage(stage, stage->output.get());
+    return PipelineStream<Out>(pipeline_, stage->output.get());
+  }
+
+  /// 添加最后一个阶段，F的签名为void(T &&)
+  template<typename F>
+  MARL_NO_EXPORT inline void sink(StageMode mode, F &&f) {
+    checkLast();
+    auto stage = pipeline_->allocator_->template create<detail::PipelineSink<T, F>>(
+        mode, std::forward<F>(f), output_, pipeline_->allocator_, pipeline_->max_tokens_);
+    pipeline_->addStage(stage, nullptr);
+  }
+
+ private:
+  friend class Pipeline;
+  template<typename U>
+  friend class PipelineStream;
+
+  MARL_NO_EXPORT inline PipelineStream(Pipeline *pipeline, std::optional<T> *output)
+      : pipeline_(pipeline), output_(output) {}
+
+  /// 流水线是线性的，只能在最后一个阶段之后添加阶段
+  MARL_NO_EXPORT inline void checkLast() const {
+    MARL_ASSERT(pipeline_->last_output_ == output_, "Pipeline stage must follow the last stage");
+  }
+
+  Pipeline *pipeline_;
+  std::optional<T> *output_;
+};
+
+template<typename F>
+auto Pipeline::source(F &&f) {
+  using Item = std::decay_t<std::invoke_result_t<F &>>;
+  using Out = typename Item::value_type;
+  MARL_ASSERT(stages_.size() == 0, "Pipeline::source() must be the first stage");
+  auto stage = allocator_->template create<detail::PipelineSource<Out, F>>(
+      std::forward<F>(f), allocator_, max_tokens_);
+  addStage(stage, stage->output.get());
+  return PipelineStream<Out>(this, stage->output.get());
+}
+
+} // namespace marl
+
+#endif // MINIMARL_INCLUDE_MARL_PIPELINE_HPP_
@@ -0,0 +1,147 @@
+#ifndef MINIMARL_INCLUDE_MARL_REACTOR_HPP_
+#define MINIMARL_INCLUDE_MARL_REACTOR_HPP_
+
+#include "containers.hpp"
+#include "export.hpp"
+#include "memory.hpp"
+#include "mutex.hpp"
+#include "scheduler.hpp"
+#include "tsa.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+
+namespace marl {
+
+/// 基于epoll的I/O就绪通知，每个Scheduler持有一个Reactor，可以通过Scheduler::reactor()获取\n
+/// 等待fd就绪的fiber会被挂起，由正在轮询Reactor的Worker在fd就绪时通过Fiber::notify()唤醒\n
+/// 空闲的Worker在有fiber等待fd时会代替在条件变量上休眠，转而调用epoll_wait()轮询Reactor，
+/// 同一时间最多只有一个Worker在轮询，新的任务入队时会通过eventfd唤醒它，
+/// 轮询者开始执行任务之后，或者第一个fiber开始等待时没有轮询者，会唤醒一个休眠的Worker来接替轮询
+/// @note 所有Worker都在忙碌时，fd的就绪事件要等到某个Worker空闲下来之后才会被处理
+class Reactor {
+ public:
+  using TimePoint = std::chrono::system_clock::time_point;
+
+  /// 由scheduler的Worker轮询，需要轮询者时唤醒scheduler中休眠的Worker
+  MARL_EXPORT
+  explicit Reactor(Scheduler *scheduler, Allocator *allocator = Allocator::Default);
+
+  /// 调用前所有等待都必须已经结束
+  MARL_EXPORT
+  ~Reactor();
+
+  /// 挂起当前fiber，直到fd上出现events中的事件（EPOLLIN/EPOLLOUT），或者到达了timeout\n
+  /// fd出错或者被挂断时也会返回，同一个fd可以同时有多个fiber等待
+  /// @return 成功时返回0，超时时返回-ETIMEDOUT，无法监听fd时返回-errno
+  MARL_EXPORT
+  int wait(int fd, uint32_t events, const TimePoint *timeout = nullptr);
+
+  /// 是否有fiber正在等待
+  [[nodiscard]] MARL_NO_EXPORT inline bool hasWaiters() const {
+    return num_waiters_.load(std::memory_order_acquire) > 0;
+  }
+
+  /// 尝试成为轮询者，成功时返回true，之后需要调用endPoll()
+  MARL_NO_EXPORT inline bool tryBeginPoll() {
+    return !polling_.exchange(true, std::memory_order_acquire);
+  }
+
+  /// 放弃轮询者的身份
+  MARL_NO_EXPORT inline void endPoll() {
+    polling_.store(false, std::memory_order_seq_cst);
+  }
+
+  /// 是否有fiber正在等待但是没有轮询者\n
+  /// 和休眠的Worker先写入休眠状态再检查的顺序相对，都使用seq_cst，避免没有Worker接替轮询
+  [[nodiscard]] MARL_NO_EXPORT inline bool needsPoller() const {
+    return num_waiters_.load(std::memory_order_seq_cst) > 0 && !polling_.load(std::memory_order_seq_cst);
+  }
+
+  /// 等待最多timeout_ms毫秒（为-1时一直等待），唤醒所有fd已经就绪的fiber\n
+  /// 只能由通过tryBeginPoll()成为轮询者的线程调用
+  MARL_EXPORT
+  void poll(int timeout_ms);
+
+  /// 使正在进行的poll()立即返回
+  MARL_EXPORT
+  void wake();
+
+ private:
+  Reactor(const Reactor &) = delete;
+  Reactor &operator=(const Reactor &) = delete;
+
+  /// 位于等待者的栈上
+  struct Waiter {
+    Scheduler::Fiber *const fiber;
+    const uint32_t events;
+    Waiter *next = nullptr;
+    bool ready = false;
+  };
+
+  struct FdState {
+    Waiter *waiters = nullptr;
+    /// 当前在epoll中监听的事件，事件触发后（EPOLLONESHOT）变为0
+    uint32_t armed = 0;
+    /// fd是否已经加入epoll，fd关闭后epoll会自动移除它，因此只是一个提示
+    bool registered = false;
+  };
+
+  /// 根据等待者监听的事件更新fd在epoll中的注册，成功时返回0，失败时返回-errno
+  int arm(int fd, FdState &state) REQUIRES(mutex_);
+
+  /// 唤醒等待fd上的revents事件的fiber
+  void dispatch(int fd, uint32_t revents);
+
+  Scheduler *const scheduler_;
+  int epoll_fd_ = -1;
+  int wake_fd_ = -1;
+
+  marl::mutex mutex_;
+  GUARDED_BY(mutex_) containers::unordered_map<int, FdState> fds_;
+  std::atomic<int> num_waiters_{0};
+  std::atomic<bool> polling_{false};
+};
+
+/// 以下函数用于非阻塞（O_NONBLOCK）的fd，例如socket和pipe\n
+/// 操作会先直接执行，在返回EAGAIN时通过当前线程绑定的Scheduler的Reactor挂起当前fiber，
+/// 直到fd就绪后重试，因此等待期间工作线程可以继续执行其他任务\n
+/// 如果当前线程没有绑定Scheduler，则通过poll()阻塞当前线程\n
+/// 失败时返回-errno
+namespace net {
+
+/// 等待fd可读，timeout为nullptr时一直等待
+/// @return 成功时返回0，超时时返回-ETIMEDOUT
+MARL_EXPORT
+int waitReadable(int fd, const Reactor::TimePoint *timeout = nullptr);
+
+/// 等待fd可写，timeout为nullptr时一直等待
+/// @return 成功时返回0，超时时返回-ETIMEDOUT
+MARL_EXPORT
+int waitWritable(int fd, const Reactor::TimePoint *timeout = nullptr);
+
+/// 读取最多len字节，返回读取的字节数，对端关闭时返回0
+MARL_EXPORT
+ssize_t read(int fd, void *buf, size_t len);
+
+/// 写入最多len字节，返回写入的字节数
+MARL_EXPORT
+ssize_t write(int fd, const void *buf, size_t len);
+
+/// 接受一个连接，返回的fd是非阻塞的，并且设置了FD_CLOEXEC
+MARL_EXPORT
+int accept(int fd, sockaddr *addr = nullptr, socklen_t *addrlen = nullptr);
+
+/// 连接到addr，返回0表示连接已经建立
+MARL_EXPORT
+int connect(int fd, const sockaddr *addr, socklen_t addrlen);
+
+} // namespace marl::net
+} // namespace marl
+
+#endif //MINIMARL_INCLUDE_MARL_REACTOR_HPP_
@@ -11,11 +11,19 @@
 #include "thread.hpp"
 
 #include <atomic>
+#include <limits>
 #include <thread>
 
 namespace marl {
 
 class OSFiber;
+class BlockingCallPool;
+class Completion;
+class Reactor;
+
+namespace io {
+class Ring;
+} // namespace marl::io
 
 /// Scheduler异步地处理任务
 /// 通过bind()方法，一个Scheduler可以绑定到一个或者多个线程上
@@ -24,12 +32,50 @@ class OSFiber;
 /// 可以通过setWorkerThreadCount()方法来设置工作线程数
 class Scheduler {
   class Worker;
+  struct TimerState;
 
  public:
   using TimePoint = std::chrono::system_clock::time_point;
   using Predicate = std::function<bool()>;
   using ThreadInitializer = std::function<void(int worker_id)>;
 
+  /// enqueueAt()、enqueueAfter()和enqueuePeriodic()返回的定时任务句柄，可以用来取消任务\n
+  /// 句柄析构时不会取消任务
+  class Timer {
+   public:
+    MARL_NO_EXPORT inline Timer() = default;
+    MARL_NO_EXPORT inline Timer(Timer &&other) noexcept : state_(other.state_) {
+      other.state_ = nullptr;
+    }
+    MARL_NO_EXPORT inline Timer &operator=(Timer &&other) noexcept {
+      std::swap(state_, other.state_);
+      return *this;
+    }
+    MARL_EXPORT
+    ~Timer();
+
+    /// 取消定时任务，尚未开始执行的任务不会再执行，周期任务也不会再被调度\n
+    /// 正在执行的任务不会被中断，可以在任意线程（包括任务自身）中调用\n
+    /// 被取消的任务在所在的定时器堆中超过一半时被批量移除，否则在原本的触发时间移除，
+    /// 在此之前它持有的资源不会被释放
+    /// @note 不能和Scheduler的析构并发调用
+    MARL_EXPORT
+    void cancel();
+
+    /// 句柄是否关联了一个定时任务
+    MARL_NO_EXPORT inline explicit operator bool() const { return state_ != nullptr; }
+
+   private:
+    friend class Scheduler;
+
+    Timer(const Timer &) = delete;
+    Timer &operator=(const Timer &) = delete;
+
+    MARL_NO_EXPORT inline explicit Timer(TimerState *state) : state_(state) {}
+
+    TimerState *state_ = nullptr;
+  };
+
   /// 保存了Scheduler相关的配置，
   struct Config {
     static constexpr size_t DefautlFiberStackSize = 1024 * 1024;
@@ -44,7 +90,27 @@ class Scheduler {
       std::shared_ptr<Thread::Affinity::Policy> affinity_policy;
     };
 
+    /// 执行marl::blocking_call()的线程池的配置
+    struct BlockingCall {
+      /// 线程数的上限
+      int max_threads = 64;
+      /// 等待执行的调用数的上限，超过后提交调用的fiber会被阻塞
+      int max_queued = 1024;
+      /// 线程空闲超过该时间后会退出
+      std::chrono::milliseconds idle_timeout{5000};
+    };
+
+    /// marl::io使用的io_uring的配置
+    struct IoRing {
+      /// 提交队列的大小
+      unsigned int entries = 256;
+      /// 为false时不使用io_uring，所有的I/O请求都通过marl::blocking_call()执行
+      bool use_io_uring = true;
+    };
+
     WorkerThread worker_thread;
+    BlockingCall blocking_call;
+    IoRing io_ring;
     /// Scheduler和内部分配使用的内存分配器
     Allocator *allocator = Allocator::Default;
     /// 每个fiber栈的大小
@@ -75,6 +141,26 @@ class Scheduler {
       worker_thread.affinity_policy = policy;
       return *this;
     }
+    MARL_NO_EXPORT inline Config &setBlockingCallMaxThreads(int count) {
+      blocking_call.max_threads = count;
+      return *this;
+    }
+    MARL_NO_EXPORT inline Config &setBlockingCallMaxQueued(int count) {
+      blocking_call.max_queued = count;
+      return *this;
+    }
+    MARL_NO_EXPORT inline Config &setBlockingCallIdleTimeout(std::chrono::milliseconds timeout) {
+      blocking_call.idle_timeout = timeout;
+      return *this;
+    }
+    MARL_NO_EXPORT inline Config &setIoRingEntries(unsigned int entries) {
+      io_ring.entries = entries;
+      return *this;
+    }
+    MARL_NO_EXPORT inline Config &setUseIoUring(bool use) {
+      io_ring.use_io_uring = use;
+      return *this;
+    }
   };
 
   MARL_EXPORT
@@ -98,14 +184,75 @@ class Scheduler {
   MARL_EXPORT
   static void unbind();
 
+  /// 返回当前线程对应的工作线程的id，取值范围为[0, config().worker_thread.count)
+  /// 如果当前线程不是工作线程（例如通过bind()绑定的线程），则返回-1
+  MARL_EXPORT
+  static int currentWorkerId();
+
   /// 将任务放入队列中
   MARL_EXPORT
   void enqueue(Task &&task);
 
+  /// 将任务放入当前线程对应的Worker的队列末尾\n
+  /// 在当前fiber挂起或者结束之前，当前Worker不会执行它，但是正在自旋的其他工作线程可以从队列头部窃取它\n
+  /// 当前线程不是工作线程并且存在工作线程时，和enqueue()相同
+  MARL_EXPORT
+  void enqueueLocal(Task &&task);
+
+  /// 如果当前线程对应的Worker的队列末尾的任务满足match(task, arg)，将其移出队列保存到out中并返回true\n
+  /// 用于取回由enqueueLocal()放入、还没有被窃取或者执行的任务
+  MARL_EXPORT
+  bool popLocal(Task &out, bool (*match)(const Task &task, const void *arg), const void *arg);
+
+  /// 在when时刻将任务放入队列中\n
+  /// 任务以普通Task的形式保存在某个Worker的定时器堆中，不会占用fiber，
+  /// Worker会在空闲时休眠到最近的触发时间，忙碌时会在每个任务之间检查定时器，
+  /// 长时间执行同一个任务的Worker的到期定时任务会由空闲的Worker代为触发\n
+  /// Scheduler析构时尚未触发的定时任务会被丢弃
+  MARL_EXPORT
+  Timer enqueueAt(const TimePoint &when, Task &&task);
+
+  /// 在delay之后将任务放入队列中
+  template<typename Rep, typename Period>
+  MARL_NO_EXPORT inline Timer enqueueAfter(const std::chrono::duration<Rep, Period> &delay,
+                                           Task &&task) {
+    return enqueueAt(std::chrono::system_clock::now() +
+                         std::chrono::ceil<TimePoint::duration>(delay),
+                     std::move(task));
+  }
+
+  /// 每隔period将任务放入队列中一次，第一次在period之后\n
+  /// 触发时间按固定频率计算，任务执行完成后才会重新加入定时器，因此同一个任务不会并发执行，
+  /// 错过的触发时间会被跳过
+  template<typename Rep, typename Period>
+  MARL_NO_EXPORT inline Timer enqueuePeriodic(const std::chrono::duration<Rep, Period> &period,
+                                              Task &&task) {
+    auto interval = std::chrono::ceil<TimePoint::duration>(period);
+    return enqueueTimer(std::chrono::system_clock::now() + interval, interval, std::move(task));
+  }
+
   /// 返回当前Scheduler使用的配置
   MARL_EXPORT
   const Config &config() const;
 
+  /// 返回当前没有任务可做（正在自旋或者休眠）的工作线程数\n
+  /// 只是一个近似值，用于parallel_for()等算法判断是否值得将工作拆分给其他工作线程
+  MARL_NO_EXPORT inline int idleWorkerCount() const {
+    return idle_workers_.load(std::memory_order_relaxed);
+  }
+
+  /// 返回执行marl::blocking_call()的线程池
+  MARL_EXPORT
+  BlockingCallPool *blockingCallPool();
+
+  /// 返回marl::io使用的Ring，Ring会在第一次调用时创建
+  MARL_EXPORT
+  io::Ring *ioRing();
+
+  /// 返回marl::net使用的Reactor，Reactor会在第一次调用时创建
+  MARL_EXPORT
+  Reactor *reactor();
+
   /// Fiber向Scheduler暴露接口，以进行协作多任务处理，Fiber会由Scheduler自动创建\n
   /// 可以通过Fiber::current()来获取当前正在运行的fiber\n
   /// 当执行流被阻塞时，可以调用yield()的方法来挂起当前fiber，开始执行其他的正在等待的任务\n
@@ -175,12 +322,18 @@ class Scheduler {
     MARL_EXPORT
     void notify();
 
+    /// 批量重新调度被挂起的fibers，属于同一个Worker的fibers只需要加一次锁
+    /// @note fibers数组中的元素会按照所属的Worker重新排序
+    MARL_EXPORT
+    static void notify(Fiber **fibers, size_t count);
+
     /// 线程中唯一标识fiber的id
     uint32_t const id_;
 
    private:
     friend class Allocator;
     friend class Scheduler;
+    friend class Completion;
 
     enum class State {
       Idle,     ///< fiber未被使用，位于Worker::idle_fibers
@@ -224,6 +377,66 @@ class Scheduler {
   /// 最大的工作线程数
   static constexpr size_t MaxWorkerThreads = 256;
 
+  /// 没有需要发布的定时器触发时间
+  static constexpr TimePoint::rep NoTimerDeadline = std::numeric_limits<TimePoint::rep>::max();
+
+  /// 定时任务的状态，由Timer句柄和Worker的定时器堆共同持有
+  struct TimerState {
+    inline TimerState(Allocator *allocator, Task &&task, TimePoint when, TimePoint::duration period);
+
+    /// 释放一个引用，最后一个引用释放时销毁自身
+    inline void release();
+
+    Allocator *const allocator;
+    Task task;
+    /// 下一次触发的时间
+    TimePoint when;
+    /// 周期任务的间隔，一次性任务为0
+    const TimePoint::duration period;
+    std::atomic<int> refs{2};
+    std::atomic<bool> cancelled{false};
+    /// 定时任务所在的定时器堆的Worker，不在任何定时器堆中时为nullptr，取消时用来通知该Worker
+    std::atomic<Worker *> worker{nullptr};
+  };
+
+  /// 按触发时间排序的定时任务（最小堆），析构时释放所有的定时任务
+  struct TimerQueue {
+    inline TimerQueue(Allocator *allocator);
+    inline ~TimerQueue();
+
+    /// 如果存在定时任务，则返回true，否则返回false
+    inline operator bool() const;
+
+    /// 返回定时任务的数量
+    inline size_t size() const;
+
+    /// 返回最早的触发时间
+    /// @note 只有当bool()为true时，才能调用该函数
+    inline TimePoint next() const;
+
+    /// 添加一个定时任务，如果它成为了最早触发的任务则返回true
+    inline bool push(TimerState *state);
+
+    /// 返回下一个在now之前触发的定时任务，没有的话返回nullptr
+    inline TimerState *take(const TimePoint &now);
+
+    /// 移除并释放所有被取消的定时任务
+    inline void compact();
+
+   private:
+    struct Entry {
+      TimePoint when;
+      TimerState *state;
+      /// 用于构造最小堆
+      inline bool operator<(const Entry &other) const { return when > other.when; }
+    };
+    containers::vector<Entry, 16> heap;
+  };
+
+  /// 创建一个定时任务并分配给一个Worker，period为0时为一次性任务
+  MARL_EXPORT
+  Timer enqueueTimer(const TimePoint &when, TimePoint::duration period, Task &&task);
+
   /// 存储所有正在等待超时的fiber
   struct WaitingFibers {
     inline WaitingFibers(Allocator *allocator);
@@ -294,9 +507,31 @@ class Scheduler {
     /// 将一个fiber放入队列中，恢复一个挂起的fiber
     void enqueue(Fiber *fiber) EXCLUDES(work_.mutex);
 
+    /// 将count个属于当前Worker的fiber放入队列中，只加一次锁
+    void enqueue(Fiber *const *fibers, size_t count) EXCLUDES(work_.mutex);
+
+    /// 将fiber放入work_.fibers，如果fiber已经在队列中或者正在运行，则返回false
+    bool enqueueFiberLocked(Fiber *fiber) REQUIRES(work_.mutex);
+
     /// 将一个新的，未开始的任务放入队列中
     void enqueue(Task &&task) EXCLUDES(work_.mutex);
 
+    /// 将completion放入收件箱并唤醒当前Worker，无锁并且是异步信号安全的
+    void post(Completion &completion);
+
+    /// 如果Worker正在通过futex休眠，则唤醒它并返回true
+    bool wakeIfSleeping();
+
+    /// 挂起当前fiber，直到completion被当前Worker从收件箱中取出
+    void wait(Completion &completion) EXCLUDES(work_.mutex);
+
+    /// 将定时任务加入当前Worker的定时器堆
+    void addTimer(TimerState *state) EXCLUDES(work_.mutex);
+
+    /// 定时器堆中的一个定时任务被取消了，被取消的定时任务超过一半时唤醒休眠的Worker来移除它们\n
+    /// 只使用原子操作，可以在任意线程中调用
+    void onTimerCancelled();
+
     /// 尝试锁住worker，以进行任务入队操作
     /// 如果加锁成功则返回true，并且需要调用enqueueAndUnlock()来解锁
     bool tryLock() EXCLUDES(work_.mutex) TRY_ACQUIRE(true, work_.mutex);
@@ -311,6 +546,9 @@ class Scheduler {
     /// 尝试从当前Worker中窃取出一个任务给另一个Worker
     bool steal(Task &out) EXCLUDES(work_.mutex);
 
+    /// 如果队列末尾的任务满足match(task, arg)，将其移出队列保存到out中并返回true
+    bool popBack(Task &out, bool (*match)(const Task &task, const void *arg), const void *arg) EXCLUDES(work_.mutex);
+
     /// 返回绑定到当前线程的Worker
     static inline Worker *getCurrent() { return Worker::current; }
 
@@ -342,6 +580,53 @@ class Scheduler {
     /// 将所有完成等待的fiber加入队列中
     void enqueueFiberTimeouts() REQUIRES(work_.mutex);
 
+    /// 将所有到期的定时任务加入任务队列中，被取消的定时任务足够多时先移除它们
+    void enqueueDueTimers() REQUIRES(work_.mutex);
+
+    /// 把从定时器堆中取出的count个定时任务加入任务队列中
+    void enqueueTimers(TimerState *const *states, size_t count) REQUIRES(work_.mutex);
+
+    /// 将从定时器堆中取出的定时任务转换为要执行的任务，被取消的定时任务会被释放并返回false
+    static bool timerTask(TimerState *state, Task &out);
+
+    /// 被取消的定时任务是否超过了定时器堆的一半，需要移除
+    bool timersNeedCompaction() const;
+
+    /// 标记Worker是否正在执行任务，只有忙碌的Worker才会发布定时器的触发时间
+    void setBusy(bool busy) REQUIRES(work_.mutex);
+
+    /// 定时器堆发生变化之后调用，发布最早的触发时间，必要时唤醒看守定时器的Worker
+    void onTimersChanged() REQUIRES(work_.mutex);
+
+    /// 从忙碌的victim的定时器堆中取出最多max个到期的定时任务，只有超过触发时间TimerStealDelay仍未被触发时才会取出\n
+    /// 以try_lock的方式锁住victim，因此不能持有自身的锁
+    size_t takeOverdueTimers(Worker *victim, TimerState **out, size_t max) EXCLUDES(work_.mutex);
+
+    /// 从所有忙碌的Worker中取出超时未被触发的定时任务，加入自身的任务队列中
+    void stealOverdueTimers() REQUIRES(work_.mutex);
+
+    /// 计算看守定时器的Worker需要醒来检查其他Worker的时间，没有忙碌的Worker发布触发时间时返回false
+    bool timerWatchDeadline(TimePoint &deadline);
+
+    /// 执行周期任务，然后将它重新加入当前Worker的定时器堆
+    static void runPeriodic(TimerState *state);
+
+    /// 代替在work_.added上休眠，轮询reactor直到有新的任务或者有fiber等待超时
+    void pollForWork(Reactor *reactor) REQUIRES(work_.mutex);
+
+    /// Reactor中是否有fiber在等待但是没有Worker在轮询
+    bool reactorNeedsPoller() const;
+
+    /// 即将开始执行任务时调用，Reactor没有轮询者时唤醒一个休眠的Worker接替轮询
+    void handOffReactorPoll();
+
+    /// 取出收件箱中所有的Completion，恢复等待它们的fiber
+    void drainCompletions() REQUIRES(work_.mutex);
+
+    /// 敲响门铃，唤醒正在休眠或者轮询Reactor的Worker\n
+    /// 只使用原子操作和系统调用，可以在任意线程（包括信号处理函数）中调用
+    void wakeup();
+
     inline void changeFiberState(Fiber *fiber,
                                  Fiber::State from,
                                  Fiber::State to) const REQUIRES(work_.mutex);
@@ -349,6 +634,13 @@ class Scheduler {
     inline void setFiberState(Fiber *fiber, Fiber::State to) const REQUIRES(work_.mutex);
 
     struct Work {
+      /// Worker的休眠状态，决定wakeup()如何唤醒它
+      enum class Sleep : uint32_t {
+        Awake,    ///< 没有休眠，会在下一次检查时发现新的任务
+        Futex,    ///< 在Work::wait()中通过futex休眠
+        Reactor,  ///< 在pollForWork()中轮询Reactor，需要通过Reactor::wake()唤醒
+      };
+
       inline Work(Allocator *allocator);
 
       std::atomic<uint64_t> num{0}; // tasks.size() + fibers.size()
@@ -356,12 +648,30 @@ class Scheduler {
       GUARDED_BY(mutex) TaskQueue tasks;
       GUARDED_BY(mutex) FiberQueue fibers;
       GUARDED_BY(mutex) WaitingFibers waiting;
-      GUARDED_BY(mutex) bool notify_added{true};
-      std::condition_variable added;
+      GUARDED_BY(mutex) TimerQueue timers;
+      /// 是否正在执行任务，而不是在waitForWork()中等待
+      GUARDED_BY(mutex) bool busy{false};
+      /// timers.size()，由mutex保护写入，可以无锁地读取
+      std::atomic<size_t> num_timers{0};
+      /// 上一次移除之后被取消的定时任务数
+      std::atomic<size_t> cancelled_timers{0};
+      /// 由mutex保护写入，可以无锁地读取
+      std::atomic<Sleep> sleep{Sleep::Awake};
+      /// 每次wakeup()都会递增，Worker在doorbell上通过futex休眠
+      std::atomic<uint32_t> doorbell{0};
+      /// 外部线程post()的Completion，后进先出
+      std::atomic<Completion *> inbox{nullptr};
       marl::mutex mutex;
 
       template<typename F>
       inline void wait(F &&f) REQUIRES(mutex);
+
+      /// 休眠直到f()返回true，或者到达deadline(TimePoint &)返回的时间
+      template<typename F, typename D>
+      inline void wait(F &&f, D &&deadline) REQUIRES(mutex);
+
+      /// 返回等待超时的fiber和定时任务中最早的时间，两者都没有时返回false
+      inline bool nextDeadline(TimePoint &deadline) const REQUIRES(mutex);
     };
 
     class FaskRnd {
@@ -385,6 +695,8 @@ class Scheduler {
     Fiber *current_fiber_{nullptr};
     Thread thread_;
     Work work_;
+    /// 忙碌时定时器堆中最早的触发时间（TimePoint::rep），空闲或者没有定时任务时为NoTimerDeadline
+    std::atomic<TimePoint::rep> busy_timer_deadline_{NoTimerDeadline};
     FiberSet idle_fibers_;
     containers::vector<Allocator::unique_ptr<Fiber>, 16>
         worker_fibers_;
@@ -392,6 +704,17 @@ class Scheduler {
     bool shutdown{false};
   };
 
+  friend class BlockingCallPool;
+  friend class Reactor;
+
+  /// Reactor中有fiber在等待但是没有Worker在轮询时调用，唤醒一个正在休眠的工作线程来接替轮询
+  void wakeReactorPoller();
+
+  /// bind()和unbind()的实现，pooled为true时表示BlockingCallPool的线程，
+  /// Scheduler析构时不等待这些线程解绑，而是在所有工作线程结束之后销毁线程池
+  void bind(bool pooled);
+  static void unbind(bool pooled);
+
   /// 尝试窃取一个任务，如果窃取成功并且将任务放到out中，则返回true，否则返回false
   bool stealWork(Worker *thief, uint64_t from, Task &out);
 
@@ -405,11 +728,18 @@ class Scheduler {
   const Config cfg_;
 
   std::array<std::atomic<int>, 8> spinning_workers_;
+  /// 没有任务可做的工作线程数
+  std::atomic<int> idle_workers_{0};
   std::atomic<unsigned int> next_spinning_worker_index_{0x8000000};
 
   std::atomic<unsigned int> next_enqueue_index_{0};
   std::array<Worker *, MaxWorkerThreads> worker_threads_;
 
+  /// 代替忙碌的Worker看守定时器的休眠Worker的id，没有时为-1
+  std::atomic<int> timer_watcher_{-1};
+  /// 看守定时器的Worker下一次醒来的时间（TimePoint::rep）
+  std::atomic<TimePoint::rep> timer_watch_deadline_{NoTimerDeadline};
+
   struct SingleThreadedWorkers {
     inline SingleThreadedWorkers(Allocator *allocator);
 
@@ -418,8 +748,18 @@ class Scheduler {
     marl::mutex mutex;
     GUARDED_BY(mutex) std::condition_variable unbind;
     GUARDED_BY(mutex) WorkerByTid by_tid;
+    /// by_tid中属于BlockingCallPool的线程数
+    GUARDED_BY(mutex) size_t num_pooled = 0;
   };
   SingleThreadedWorkers single_threaded_workers_;
+
+  Allocator::unique_ptr<BlockingCallPool> blocking_call_pool_;
+
+  marl::mutex io_ring_mutex_;
+  std::atomic<io::Ring *> io_ring_{nullptr};
+
+  marl::mutex reactor_mutex_;
+  std::atomic<Reactor *> reactor_{nullptr};
 };
 
 /// 将任务分配给当前绑定的scheduler以异步执行
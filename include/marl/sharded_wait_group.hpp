@@ -0,0 +1,135 @@
+#ifndef MINIMARL_INCLUDE_MARL_SHARDED_WAIT_GROUP_HPP_
+#define MINIMARL_INCLUDE_MARL_SHARDED_WAIT_GROUP_HPP_
+
+#include "condition_variable.hpp"
+#include "debug.hpp"
+#include "memory.hpp"
+#include "scheduler.hpp"
+#include "thread.hpp"
+
+#include <atomic>
+
+namespace marl {
+
+/// ShardedWaitGroup和WaitGroup提供相同的add/done/wait接口，用于大量任务并发调用done()的场景\n
+/// WaitGroup的所有done()都会修改同一个原子计数器，当大量工作线程同时完成任务时，该计数器所在的缓存行会成为热点\n
+/// ShardedWaitGroup为每个工作线程分配一个独占缓存行的分片，done()只修改当前工作线程的分片，
+/// 分片中累积的计数每达到BatchSize时才合并到全局计数器中\n
+/// 当全局计数器接近0时，ShardedWaitGroup会进入排空阶段，此时done()会直接修改全局计数器，
+/// 并且把所有分片合并到全局计数器中，以保证最后一个done()能够准确地唤醒wait()
+class ShardedWaitGroup {
+ public:
+  /// 分片中累积的done()次数达到该值时，会被合并到全局计数器
+  static constexpr int64_t BatchSize = 32;
+
+  MARL_NO_EXPORT inline ShardedWaitGroup(unsigned int initial_count = 0,
+                                         Allocator *allocator = Allocator::Default)
+      : data_(allocator->make_shared<Data>(allocator, numShards())) {
+    data_->count = initial_count;
+  }
+
+  /// 使内部的计数器增加count
+  MARL_NO_EXPORT inline void add(unsigned int count = 1) const {
+    if (data_->count.fetch_add(count) == 0) {
+      // 计数器从0开始新的一轮计数，此时所有分片都已经被合并，可以重新启用分片
+      data_->draining = false;
+    }
+  }
+
+  /// 使内部的计数器减1
+  /// @return 如果计数器因为这次调用变为0，则返回true
+  MARL_NO_EXPORT inline bool done() const {
+    bool reached_zero = false;
+    if (!data_->draining.load()) {
+      auto &shard = data_->shard();
+      if (--shard.count <= -BatchSize) {
+        reached_zero = data_->flush(shard);
+      }
+      if (!data_->draining.load() && data_->count.load() > data_->threshold) {
+        return false;
+      }
+      data_->draining = true;
+    } else {
+      auto prev = data_->count--;
+      (void) prev;
+      MARL_ASSERT(prev > 0, "marl::ShardedWaitGroup::done() called too many times");
+      reached_zero = (prev == 1);
+    }
+    for (size_t i = 0; i < data_->num_shards; ++i) {
+      reached_zero |= data_->flush(data_->shards.get()[i]);
+    }
+    if (reached_zero) {
+      marl::lock lock(data_->mutex);
+      data_->cv.notify_all();
+    }
+    return reached_zero;
+  }
+
+  /// 阻塞，直到内部计数器为0
+  MARL_NO_EXPORT inline void wait() const {
+    marl::lock lock(data_->mutex);
+    data_->cv.wait(lock, [this] { return data_->count == 0; });
+  }
+
+ private:
+  struct alignas(CacheLineSize) Shard {
+    /// 当前分片中尚未合并到全局计数器的done()次数，始终小于等于0
+    std::atomic<int64_t> count{0};
+  };
+
+  struct Data {
+    MARL_NO_EXPORT inline Data(Allocator *allocator, size_t num_shards)
+        : cv(allocator),
+          num_shards(num_shards),
+          threshold(static_cast<int64_t>(num_shards) * BatchSize),
+          shards(allocator->make_unique_n<Shard>(num_shards)) {}
+
+    /// 返回当前线程使用的分片，非工作线程共享第0个分片
+    MARL_NO_EXPORT inline Shard &shard() {
+      auto id = Scheduler::currentWorkerId();
+      auto idx = id < 0 ? 0 : 1 + static_cast<size_t>(id) % (num_shards - 1);
+      return shards.get()[idx];
+    }
+
+    /// 将分片中的计数合并到全局计数器中
+    /// @return 如果全局计数器因为这次合并变为0，则返回true
+    MARL_NO_EXPORT inline bool flush(Shard &shard) {
+      if (shard.count.load() == 0) {
+        return false;
+      }
+      auto moved = shard.count.exchange(0);
+      if (moved == 0) {
+        return false;
+      }
+      auto prev = count.fetch_add(moved);
+      MARL_ASSERT(prev + moved >= 0, "marl::ShardedWaitGroup::done() called too many times");
+      return prev + moved == 0;
+    }
+
+    /// 全局计数器，由于分片的计数始终小于等于0，该值始终不小于实际的计数，为0时实际的计数也为0
+    alignas(CacheLineSize) std::atomic<int64_t> count{0};
+    /// 为true时表示处于排空阶段
+    std::atomic<bool> draining{false};
+    ConditionVariable cv;
+    marl::mutex mutex;
+    const size_t num_shards;
+    /// 全局计数器低于该值时进入排空阶段，所有分片中未合并的计数之和总是小于该值
+    const int64_t threshold;
+    const Allocator::unique_ptr<Shard> shards;
+  };
+
+  /// 分片数为工作线程数加1，第0个分片由非工作线程共享
+  MARL_NO_EXPORT static inline size_t numShards() {
+    auto scheduler = Scheduler::get();
+    auto num_workers = scheduler != nullptr
+                       ? scheduler->config().worker_thread.count
+                       : static_cast<int>(Thread::numLogicalCPUs());
+    return static_cast<size_t>(std::max(num_workers, 1)) + 1;
+  }
+
+  const std::shared_ptr<Data> data_;
+};
+
+} // namespace marl
+
+#endif //MINIMARL_INCLUDE_MARL_SHARDED_WAIT_GROUP_HPP_
@@ -0,0 +1,52 @@
+#ifndef MINIMARL_INCLUDE_MARL_SLEEP_HPP_
+#define MINIMARL_INCLUDE_MARL_SLEEP_HPP_
+
+#include "export.hpp"
+#include "scheduler.hpp"
+
+#include <chrono>
+#include <thread>
+#include <type_traits>
+
+namespace marl {
+
+/// 挂起当前fiber，直到到达timeout\n
+/// fiber通过Worker的超时等待队列挂起，休眠期间工作线程可以继续执行其他任务\n
+/// 如果当前线程没有正在运行的fiber（没有绑定Scheduler），则退化为std::this_thread::sleep_until()
+template<typename Clock, typename Duration>
+MARL_NO_EXPORT inline void sleep_until(const std::chrono::time_point<Clock, Duration> &timeout) {
+  auto fiber = Scheduler::Fiber::current();
+  if (fiber == nullptr) {
+    std::this_thread::sleep_until(timeout);
+    return;
+  }
+  using SystemClock = std::chrono::system_clock;
+  Scheduler::TimePoint deadline;
+  if constexpr (std::is_same_v<Clock, SystemClock>) {
+    deadline = std::chrono::time_point_cast<SystemClock::duration>(timeout);
+  } else {
+    // 其他时钟（例如steady_clock）的时间点转换为相对于现在的system_clock时间点
+    deadline = SystemClock::now() +
+        std::chrono::ceil<SystemClock::duration>(timeout - Clock::now());
+  }
+  // 没有其他人会notify()正在休眠的fiber，循环只是为了防止提前返回
+  while (fiber->wait(deadline)) {}
+}
+
+/// 挂起当前fiber至少duration的时间，行为和sleep_until()相同
+template<typename Rep, typename Period>
+MARL_NO_EXPORT inline void sleep_for(const std::chrono::duration<Rep, Period> &duration) {
+  if (duration <= duration.zero()) {
+    return;
+  }
+  if (Scheduler::Fiber::current() == nullptr) {
+    std::this_thread::sleep_for(duration);
+    return;
+  }
+  sleep_until(std::chrono::system_clock::now() +
+      std::chrono::ceil<std::chrono::system_clock::duration>(duration));
+}
+
+} // namespace marl
+
+#endif //MINIMARL_INCLUDE_MARL_SLEEP_HPP_
@@ -63,6 +63,12 @@ class Task {
         static_cast<int>(flag);
   }
 
+  /// @return Task保存的可调用对象的类型是F时返回指向它的指针，否则返回nullptr
+  template<typename F>
+  [[nodiscard]] MARL_NO_EXPORT inline const F *target() const {
+    return function_.template target<F>();
+  }
+
  private:
   Function function_;
   Flags flags_{Flags::None};
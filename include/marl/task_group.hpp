@@ -0,0 +1,160 @@
+#ifndef MINIMARL_INCLUDE_MARL_TASK_GROUP_HPP_
+#define MINIMARL_INCLUDE_MARL_TASK_GROUP_HPP_
+
+#include "condition_variable.hpp"
+#include "debug.hpp"
+#include "export.hpp"
+#include "memory.hpp"
+#include "mutex.hpp"
+#include "scheduler.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace marl {
+
+namespace detail {
+
+/// TaskGroup在自身内部保存子任务的字节数，超出的子任务从Scheduler的Allocator中分配
+constexpr size_t TaskGroupInlineBytes = 256;
+
+} // namespace detail
+
+/// 类似Cilk的spawn/sync，用于递归的分治算法（快速排序、树的遍历等）\n
+/// spawn()把子任务放入当前Worker的队列末尾，子任务的可调用对象保存在TaskGroup内部，
+/// 放入队列的Task只保存一个指针，不需要分配std::function和WaitGroup的控制块\n
+/// sync()从队列末尾按后进先出的顺序取回还没有被窃取的子任务，直接在当前fiber上执行，
+/// 只有存在被其他工作线程窃取并且还没有完成的子任务时才会挂起当前fiber\n
+/// 有空闲的工作线程时，子任务直接被调度给它们，使空闲的工作线程不需要等到自旋时才能窃取到任务\n
+/// 析构时会隐式地调用sync()
+/// @note 必须在绑定了Scheduler的线程上使用，spawn()和sync()只能在创建TaskGroup的fiber上调用，
+/// 子任务中可以创建新的TaskGroup
+class TaskGroup {
+ public:
+  MARL_NO_EXPORT inline TaskGroup() : scheduler_(Scheduler::get()) {
+    MARL_ASSERT(scheduler_ != nullptr, "marl::TaskGroup created without a bound scheduler");
+    allocator_ = scheduler_->config().allocator;
+  }
+
+  MARL_NO_EXPORT inline ~TaskGroup() { sync(); }
+
+  TaskGroup(const TaskGroup &) = delete;
+  TaskGroup &operator=(const TaskGroup &) = delete;
+
+  /// 创建一个执行f()的子任务，它可能被其他工作线程窃取，也可能在sync()中由当前fiber执行
+  template<typename F>
+  MARL_NO_EXPORT inline void spawn(F &&f) {
+    using C = Closure<std::decay_t<F>>;
+    C *closure;
+    auto offset = (used_ + alignof(C) - 1) & ~(alignof(C) - 1);
+    if (alignof(C) <= alignof(std::max_align_t) && offset + sizeof(C) <= detail::TaskGroupInlineBytes) {
+      closure = new(storage_ + offset) C(this, false, std::forward<F>(f));
+      used_ = offset + sizeof(C);
+    } else {
+      closure = allocator_->create<C>(this, true, std::forward<F>(f));
+    }
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    if (scheduler_->idleWorkerCount() > 0) {
+      scheduler_->enqueue(Task(Runner{closure}));
+    } else {
+      scheduler_->enqueueLocal(Task(Runner{closure}));
+    }
+  }
+
+  /// 等待所有的子任务完成\n
+  /// 先在当前fiber上执行仍然位于当前Worker队列末尾的子任务，再等待被窃取的子任务
+  MARL_NO_EXPORT inline void sync() {
+    Task task;
+    while (scheduler_->popLocal(task, &TaskGroup::owns, this)) {
+      auto child = task.target<Runner>()->child;
+      child->run(child, false);
+    }
+    if (pending_.load() != 0) {
+      marl::lock lock(mutex_);
+      cv_.wait(lock, [this] { return pending_.load() == 0; });
+    }
+    used_ = 0;
+  }
+
+ private:
+  /// 子任务的公共部分，run执行并销毁子任务，然后通知所属的TaskGroup
+  struct Child {
+    MARL_NO_EXPORT inline Child(TaskGroup *group, bool allocated) : group(group), allocated(allocated) {}
+
+    void (*run)(Child *child, bool stolen) = nullptr;
+    TaskGroup *const group;
+    /// 为true时子任务由allocator_->create()分配，否则位于storage_中
+    const bool allocated;
+  };
+
+  template<typename F>
+  struct Closure : Child {
+    template<typename Arg>
+    MARL_NO_EXPORT inline Closure(TaskGroup *group, bool allocated, Arg &&arg)
+        : Child(group, allocated), f(std::forward<Arg>(arg)) {
+      this->run = &Closure::invoke;
+    }
+
+    MARL_NO_EXPORT static inline void invoke(Child *child, bool stolen) {
+      auto self = static_cast<Closure *>(child);
+      self->f();
+      // 必须在通知TaskGroup之前销毁可调用对象，之后TaskGroup可能随时被销毁
+      auto group = self->group;
+      if (self->allocated) {
+        group->allocator_->destroy(self);
+      } else {
+        self->~Closure();
+      }
+      group->done(stolen);
+    }
+
+    F f;
+  };
+
+  /// 放入队列中的Task，只保存一个指针，std::function不需要为它分配内存
+  struct Runner {
+    MARL_NO_EXPORT inline void operator()() const { child->run(child, true); }
+    Child *child;
+  };
+
+  /// 队列中的task是否是group的子任务
+  MARL_NO_EXPORT static inline bool owns(const Task &task, const void *group) {
+    auto runner = task.target<Runner>();
+    return runner != nullptr && runner->child->group == group;
+  }
+
+  /// 使未完成的子任务数减1\n
+  /// 在sync()中执行的子任务由等待者自己递减，不需要通知；被窃取的子任务的最后一次递减必须在持有锁的情况下进行，
+  /// 否则sync()可能在notify_all()之前返回并销毁当前对象
+  MARL_NO_EXPORT inline void done(bool stolen) {
+    if (!stolen) {
+      pending_.fetch_sub(1);
+      return;
+    }
+    auto count = pending_.load();
+    while (count > 1) {
+      if (pending_.compare_exchange_weak(count, count - 1)) {
+        return;
+      }
+    }
+    marl::lock lock(mutex_);
+    if (--pending_ == 0) {
+      cv_.notify_all();
+    }
+  }
+
+  Scheduler *const scheduler_;
+  Allocator *allocator_ = nullptr;
+  std::atomic<unsigned int> pending_{0};
+  marl::mutex mutex_;
+  ConditionVariable cv_;
+  size_t used_ = 0;
+  alignas(std::max_align_t) unsigned char storage_[detail::TaskGroupInlineBytes];
+};
+
+} // namespace marl
+
+#endif // MINIMARL_INCLUDE_MARL_TASK_GROUP_HPP_
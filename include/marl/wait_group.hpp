@@ -12,7 +12,7 @@ class WaitGroup {
  public:
   MARL_NO_EXPORT inline WaitGroup(unsigned int initial_count = 0,
                                   Allocator *allocator = Allocator::Default)
-      : data_(std::make_shared<Data>(allocator)) {
+      : data_(allocator->make_shared<Data>(allocator)) {
     data_->count = initial_count;
   }
 
@@ -51,6 +51,71 @@ class WaitGroup {
   const std::shared_ptr<Data> data_;  ///< 通过使用shared_ptr使得WaitGroup在复制的情况下也能正确运行
 };
 
+/// InlineWaitGroup提供和WaitGroup相同的功能，但是不进行任何堆内存分配，可以直接放在fiber栈上或者其他对象中\n
+/// InlineWaitGroup不可复制，需要通过ref()获取一个轻量的Ref传递给其他任务，复制Ref不涉及任何原子操作\n
+/// 调用者需要保证InlineWaitGroup的生命周期长于所有的Ref，通常在同一个作用域内调用wait()即可保证
+class InlineWaitGroup {
+ public:
+  /// 指向InlineWaitGroup的引用，提供和WaitGroup相同的接口
+  class Ref {
+   public:
+    MARL_NO_EXPORT inline void add(unsigned int count = 1) const { wg_->add(count); }
+    MARL_NO_EXPORT inline bool done() const { return wg_->done(); }
+    MARL_NO_EXPORT inline void wait() const { wg_->wait(); }
+
+   private:
+    friend class InlineWaitGroup;
+    MARL_NO_EXPORT inline Ref(InlineWaitGroup *wg) : wg_(wg) {}
+    InlineWaitGroup *wg_;
+  };
+
+  /// @param allocator 仅用于ConditionVariable的内部分配
+  MARL_NO_EXPORT inline InlineWaitGroup(unsigned int initial_count = 0,
+                                        Allocator *allocator = Allocator::Default)
+      : count_(initial_count), cv_(allocator) {}
+
+  /// 返回指向当前InlineWaitGroup的引用
+  MARL_NO_EXPORT inline Ref ref() { return Ref(this); }
+
+  /// 使内部的计数器增加count
+  MARL_NO_EXPORT inline void add(unsigned int count = 1) {
+    count_ += count;
+  }
+
+  /// 使内部的计数器减1
+  MARL_NO_EXPORT inline bool done() {
+    // 计数器不会变为0时，无需加锁
+    auto count = count_.load();
+    while (count > 1) {
+      if (count_.compare_exchange_weak(count, count - 1)) {
+        return false;
+      }
+    }
+    // 最后一次递减必须在持有锁的情况下进行，否则wait()可能在notify_all()之前返回并销毁当前对象
+    marl::lock lock(mutex_);
+    MARL_ASSERT(count_ > 0, "marl::InlineWaitGroup::done() called too many times");
+    if (--count_ == 0) {
+      cv_.notify_all();
+      return true;
+    }
+    return false;
+  }
+
+  /// 阻塞，直到内部计数器为0
+  MARL_NO_EXPORT inline void wait() {
+    marl::lock lock(mutex_);
+    cv_.wait(lock, [this] { return count_ == 0; });
+  }
+
+ private:
+  InlineWaitGroup(const InlineWaitGroup &) = delete;
+  InlineWaitGroup &operator=(const InlineWaitGroup &) = delete;
+
+  std::atomic<unsigned int> count_;
+  ConditionVariable cv_;
+  marl::mutex mutex_;
+};
+
 } // namespace marl
 
 #endif //MINIMARL_INCLUDE_MARL_WAIT_GROUP_HPP_
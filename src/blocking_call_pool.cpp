@@ -0,0 +1,137 @@
+#include "marl/blocking_call_pool.hpp"
+
+#include "marl/debug.hpp"
+#include "marl/scheduler.hpp"
+
+#include <algorithm>
+
+namespace marl {
+
+BlockingCallPool::BlockingCallPool(Scheduler *scheduler,
+                                   const Config &config,
+                                   Allocator *allocator)
+    : scheduler_(scheduler),
+      cfg_(config),
+      work_(allocator),
+      space_(allocator),
+      threads_(allocator),
+      exited_(allocator) {
+  MARL_ASSERT(cfg_.max_threads > 0, "BlockingCallPool requires at least one thread");
+  MARL_ASSERT(cfg_.max_queued > 0, "BlockingCallPool requires a positive queue size");
+}
+
+BlockingCallPool::~BlockingCallPool() {
+  {
+    marl::lock lock(mutex_);
+    shutdown_ = true;
+    work_.notify_all();
+  }
+  // 设置shutdown_之后不会再创建新的线程，线程退出时也不会修改threads_
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+void BlockingCallPool::call(Job &job) {
+  {
+    marl::lock lock(mutex_);
+    MARL_ASSERT(!shutdown_, "BlockingCallPool::call() called after shutdown");
+    space_.wait(lock, [this]() REQUIRES(mutex_) {
+      return stats_.num_queued < cfg_.max_queued;
+    });
+    job.submitted = Job::Clock::now();
+    job.next = nullptr;
+    if (tail_ != nullptr) {
+      tail_->next = &job;
+    } else {
+      head_ = &job;
+    }
+    tail_ = &job;
+    ++stats_.num_queued;
+    if (stats_.num_queued > stats_.num_idle_threads &&
+        stats_.num_threads < cfg_.max_threads) {
+      spawnLocked();
+    } else {
+      work_.notify_one();
+    }
+  }
+  job.done.wait();
+}
+
+BlockingCallPool::Stats BlockingCallPool::stats() {
+  marl::lock lock(mutex_);
+  return stats_;
+}
+
+void BlockingCallPool::threadMain() {
+  scheduler_->bind(true);
+  marl::lock lock(mutex_);
+  ++stats_.num_idle_threads;
+  while (true) {
+    auto has_work = work_.wait_for(lock, cfg_.idle_timeout, [this]() REQUIRES(mutex_) {
+      return head_ != nullptr || shutdown_;
+    });
+    if (head_ == nullptr && (shutdown_ || !has_work)) {
+      break;
+    }
+
+    auto job = head_;
+    head_ = job->next;
+    if (head_ == nullptr) {
+      tail_ = nullptr;
+    }
+    --stats_.num_queued;
+    --stats_.num_idle_threads;
+    space_.notify_one();
+    auto started = Job::Clock::now();
+    auto queue_wait = started - job->submitted;
+
+    lock.unlock_no_tsa();
+    job->run();
+    auto exec = Job::Clock::now() - started;
+    lock.lock_no_tsa();
+
+    ++stats_.num_calls;
+    stats_.total_queue_wait += queue_wait;
+    stats_.max_queue_wait = std::max<std::chrono::nanoseconds>(stats_.max_queue_wait, queue_wait);
+    stats_.total_exec += exec;
+    stats_.max_exec = std::max<std::chrono::nanoseconds>(stats_.max_exec, exec);
+    // 先标记为空闲再通知调用者，使得调用者紧接着提交的调用可以复用当前线程
+    ++stats_.num_idle_threads;
+    // 调用者可能在done发出信号后立即销毁job
+    job->done.signal();
+  }
+  --stats_.num_idle_threads;
+  --stats_.num_threads;
+  lock.unlock_no_tsa();
+
+  Scheduler::unbind(true);
+
+  lock.lock_no_tsa();
+  if (!shutdown_) {
+    // 由下一次创建线程的调用者负责join
+    exited_.push_back(std::this_thread::get_id());
+  }
+}
+
+void BlockingCallPool::spawnLocked() {
+  reapLocked();
+  ++stats_.num_threads;
+  ++stats_.num_threads_created;
+  threads_.emplace_front([this] { threadMain(); });
+}
+
+void BlockingCallPool::reapLocked() {
+  for (size_t i = 0; i < exited_.size(); ++i) {
+    for (auto it = threads_.begin(); it != threads_.end(); ++it) {
+      if (it->get_id() == exited_[i]) {
+        it->join();
+        threads_.erase(it);
+        break;
+      }
+    }
+  }
+  exited_.resize(0);
+}
+
+} // namespace marl
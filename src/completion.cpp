@@ -0,0 +1,21 @@
+#include "marl/completion.hpp"
+
+#include "marl/debug.hpp"
+
+namespace marl {
+
+Completion::Completion() : fiber_(Scheduler::Fiber::current()) {
+  MARL_ASSERT(fiber_ != nullptr, "Completion must be created on a fiber");
+}
+
+void Completion::wait() {
+  MARL_ASSERT(Scheduler::Fiber::current() == fiber_,
+              "Completion::wait() must be called on the fiber that created it");
+  fiber_->worker_->wait(*this);
+}
+
+void Completion::post() {
+  fiber_->worker_->post(*this);
+}
+
+} // namespace marl
@@ -0,0 +1,70 @@
+#include "marl/file_scan.hpp"
+
+#include "marl/debug.hpp"
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace marl {
+
+MappedFile::~MappedFile() {
+  unmap();
+}
+
+int MappedFile::map(int fd) {
+  unmap();
+  struct stat st = {};
+  if (fstat(fd, &st) != 0) {
+    return -errno;
+  }
+  if (st.st_size == 0) {
+    return 0;
+  }
+  auto size = static_cast<size_t>(st.st_size);
+  auto mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (mapping == MAP_FAILED) {
+    return -errno;
+  }
+  // 只是提示，失败时不影响正确性
+  madvise(mapping, size, MADV_SEQUENTIAL);
+  data_ = static_cast<const char *>(mapping);
+  size_ = size;
+  return 0;
+}
+
+int MappedFile::open(const char *path) {
+  auto fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return -errno;
+  }
+  auto res = map(fd);
+  close(fd);
+  return res;
+}
+
+void MappedFile::prefetch(size_t offset, size_t len) const {
+  if (data_ == nullptr || offset >= size_) {
+    return;
+  }
+  // madvise()要求起始地址按页对齐
+  auto page = pageSize();
+  auto begin = offset / page * page;
+  auto end = std::min(offset + len, size_);
+  madvise(const_cast<char *>(data_) + begin, end - begin, MADV_WILLNEED);
+}
+
+void MappedFile::unmap() {
+  if (data_ != nullptr) {
+    auto res = munmap(const_cast<char *>(data_), size_);
+    (void) res;
+    MARL_ASSERT(res == 0, "Failed to unmap file");
+    data_ = nullptr;
+    size_ = 0;
+  }
+}
+
+} // namespace marl
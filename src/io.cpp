@@ -0,0 +1,406 @@
+#include "marl/io.hpp"
+
+#include "marl/blocking_call.hpp"
+#include "marl/debug.hpp"
+#include "marl/scheduler.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+inline int ioUringSetup(unsigned int entries, io_uring_params *params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+inline int ioUringEnter(int fd, unsigned int to_submit, unsigned int min_complete, unsigned int flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+inline int ioUringRegister(int fd, unsigned int opcode, const void *arg, unsigned int nr_args) {
+  return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+/// Ring::complete()每一批处理的CQE个数上限，每一批的group指针保存在栈上
+constexpr unsigned int CompleteBatchSize = 64;
+
+inline ssize_t resultOf(ssize_t res) {
+  return res < 0 ? -errno : res;
+}
+
+/// SQE的len只有32位，更长的请求不能被提交
+inline bool validLength(const marl::io::Request &request) {
+  return request.len <= std::numeric_limits<uint32_t>::max();
+}
+
+/// 在当前线程上同步地执行请求
+void execute(marl::io::Request &request) {
+  using Op = marl::io::Request::Op;
+  // 和io_uring的路径保持一致，拒绝SQE无法表示的长度
+  if (!validLength(request)) {
+    request.result = -EINVAL;
+    return;
+  }
+  ssize_t res;
+  do {
+    switch (request.op) {
+      case Op::Read:
+      case Op::ReadFixed:
+        res = ::pread(request.fd, request.buf, request.len, request.offset);
+        break;
+      case Op::Write:
+      case Op::WriteFixed:
+        res = ::pwrite(request.fd, request.buf, request.len, request.offset);
+        break;
+      case Op::ReadV:
+        res = ::preadv(request.fd, static_cast<const iovec *>(request.buf),
+                       static_cast<int>(request.len), request.offset);
+        break;
+      case Op::WriteV:
+        res = ::pwritev(request.fd, static_cast<const iovec *>(request.buf),
+                        static_cast<int>(request.len), request.offset);
+        break;
+      case Op::Fsync:
+        res = ::fsync(request.fd);
+        break;
+      case Op::Fdatasync:
+        res = ::fdatasync(request.fd);
+        break;
+      default:
+        res = -1;
+        errno = EINVAL;
+        break;
+    }
+  } while (res < 0 && errno == EINTR);
+  request.result = resultOf(res);
+}
+
+} // anonymous namespace
+
+namespace marl {
+namespace io {
+
+//// Ring ////
+
+Ring::Ring(unsigned int entries, bool use_io_uring, Allocator *allocator)
+    : slots_(allocator) {
+  if (use_io_uring && setup(entries)) {
+    reaper_ = std::thread([this] { reap(); });
+  }
+}
+
+Ring::~Ring() {
+  if (!usingIoUring()) {
+    return;
+  }
+  {
+    // 提交一个user_data为0的NOP，通知完成线程退出
+    marl::lock lock(mutex_);
+    MARL_ASSERT(in_flight_ == 0, "marl::io::Ring destroyed with requests in flight");
+    auto tail = *sq_.tail;
+    auto idx = tail & *sq_.mask;
+    auto sqe = &sq_.sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_NOP;
+    sqe->user_data = 0;
+    sq_.array[idx] = idx;
+    __atomic_store_n(sq_.tail, tail + 1, __ATOMIC_RELEASE);
+    enter(1);
+  }
+  reaper_.join();
+  munmap(sqes_, sqes_size_);
+  if (cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  munmap(sq_ring_, sq_ring_size_);
+  close(ring_fd_);
+}
+
+bool Ring::setup(unsigned int entries) {
+  io_uring_params params{};
+  auto fd = ioUringSetup(entries, &params);
+  if (fd < 0) {
+    return false;
+  }
+  // 需要IORING_OP_READ/WRITE（Linux 5.6），并且CQ溢出时不能丢弃CQE
+  constexpr unsigned int required = IORING_FEAT_NODROP | IORING_FEAT_RW_CUR_POS;
+  if ((params.features & required) != required) {
+    close(fd);
+    return false;
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+  cq_ring_ = single_mmap ? sq_ring_
+                         : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = cq_ring_ == MAP_FAILED
+          ? MAP_FAILED
+          : mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    munmap(sq_ring_, sq_ring_size_);
+    close(fd);
+    return false;
+  }
+
+  auto sq = static_cast<char *>(sq_ring_);
+  sq_.head = reinterpret_cast<unsigned int *>(sq + params.sq_off.head);
+  sq_.tail = reinterpret_cast<unsigned int *>(sq + params.sq_off.tail);
+  sq_.mask = reinterpret_cast<unsigned int *>(sq + params.sq_off.ring_mask);
+  sq_.array = reinterpret_cast<unsigned int *>(sq + params.sq_off.array);
+  sq_.sqes = static_cast<io_uring_sqe *>(sqes_);
+  sq_.entries = params.sq_entries;
+
+  auto cq = static_cast<char *>(cq_ring_);
+  cq_.head = reinterpret_cast<unsigned int *>(cq + params.cq_off.head);
+  cq_.tail = reinterpret_cast<unsigned int *>(cq + params.cq_off.tail);
+  cq_.mask = reinterpret_cast<unsigned int *>(cq + params.cq_off.ring_mask);
+  cq_.cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+  cq_.entries = params.cq_entries;
+
+  ring_fd_ = fd;
+  return true;
+}
+
+void Ring::submit(Request *requests, size_t count) {
+  if (count == 0) {
+    return;
+  }
+  if (!usingIoUring()) {
+    blocking_call([=] {
+      for (size_t i = 0; i < count; ++i) {
+        execute(requests[i]);
+      }
+    });
+    return;
+  }
+
+  InlineWaitGroup group(static_cast<unsigned int>(count));
+  for (size_t submitted = 0; submitted < count;) {
+    marl::lock lock(mutex_);
+    // 在途的请求数不超过CQ的大小，保证CQ不会溢出
+    slots_.wait(lock, [this]() REQUIRES(mutex_) { return in_flight_ < cq_.entries; });
+    auto n = static_cast<unsigned int>(std::min<size_t>(
+        {count - submitted, sq_.entries, cq_.entries - in_flight_}));
+    unsigned int prepared = 0;
+    for (unsigned int i = 0; i < n; ++i) {
+      auto &request = requests[submitted + i];
+      request.group_ = &group;
+      if (prepare(request)) {
+        ++prepared;
+      } else {
+        request.result = -EINVAL;
+        group.done();
+      }
+    }
+    in_flight_ += prepared;
+    enter(prepared);
+    submitted += n;
+  }
+  // 命中页缓存的读写通常在io_uring_enter()返回前就已经完成，
+  // 此时直接处理CQE，可以避免挂起当前fiber并等待完成线程唤醒
+  if (cq_mutex_.try_lock()) {
+    complete();
+    cq_mutex_.unlock();
+  }
+  group.wait();
+}
+
+int Ring::registerBuffers(const iovec *iovs, unsigned int count) {
+  if (!usingIoUring()) {
+    return 0;
+  }
+  auto res = ioUringRegister(ring_fd_, IORING_REGISTER_BUFFERS, iovs, count);
+  return res < 0 ? -errno : 0;
+}
+
+int Ring::unregisterBuffers() {
+  if (!usingIoUring()) {
+    return 0;
+  }
+  auto res = ioUringRegister(ring_fd_, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+  return res < 0 ? -errno : 0;
+}
+
+bool Ring::prepare(Request &request) {
+  if (!validLength(request)) {
+    return false;
+  }
+  // 只有持有mutex_时才会修改sq的tail
+  auto tail = *sq_.tail;
+  auto idx = tail & *sq_.mask;
+  auto sqe = &sq_.sqes[idx];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->fd = request.fd;
+  sqe->addr = reinterpret_cast<uint64_t>(request.buf);
+  sqe->len = static_cast<uint32_t>(request.len);
+  sqe->off = static_cast<uint64_t>(request.offset);
+  switch (request.op) {
+    case Request::Op::Read:
+      sqe->opcode = IORING_OP_READ;
+      break;
+    case Request::Op::Write:
+      sqe->opcode = IORING_OP_WRITE;
+      break;
+    case Request::Op::ReadV:
+      sqe->opcode = IORING_OP_READV;
+      break;
+    case Request::Op::WriteV:
+      sqe->opcode = IORING_OP_WRITEV;
+      break;
+    case Request::Op::ReadFixed:
+      sqe->opcode = IORING_OP_READ_FIXED;
+      sqe->buf_index = static_cast<uint16_t>(request.buf_index);
+      break;
+    case Request::Op::WriteFixed:
+      sqe->opcode = IORING_OP_WRITE_FIXED;
+      sqe->buf_index = static_cast<uint16_t>(request.buf_index);
+      break;
+    case Request::Op::Fsync:
+      sqe->opcode = IORING_OP_FSYNC;
+      break;
+    case Request::Op::Fdatasync:
+      sqe->opcode = IORING_OP_FSYNC;
+      sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+      break;
+  }
+  sqe->user_data = reinterpret_cast<uint64_t>(&request);
+  sq_.array[idx] = idx;
+  __atomic_store_n(sq_.tail, tail + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+void Ring::enter(unsigned int count) {
+  while (count > 0) {
+    auto res = ioUringEnter(ring_fd_, count, 0, 0);
+    if (res < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+        continue;
+      }
+      MARL_FATAL("io_uring_enter() failed: %s", strerror(errno));
+    }
+    count -= static_cast<unsigned int>(res);
+  }
+}
+
+void Ring::reap() {
+  bool stop = false;
+  while (!stop) {
+    auto res = ioUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS);
+    if (res < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      MARL_FATAL("io_uring_enter() failed: %s", strerror(errno));
+    }
+    std::lock_guard<std::mutex> lock(cq_mutex_);
+    stop = complete();
+  }
+}
+
+bool Ring::complete() {
+  auto head = *cq_.head;
+  auto tail = __atomic_load_n(cq_.tail, __ATOMIC_ACQUIRE);
+  bool stop = false;
+  // 分批处理CQE：先取出每个请求的group并写入结果，然后推进cq的head，再释放在途的名额，最后调用done()\n
+  // head必须在释放名额之前推进，否则被唤醒的提交者可能在CQE仍然占用完成队列时提交更多的请求，使CQ溢出；
+  // 在途的请求数必须在done()之前减少，否则提交者返回之后Ring可能在减少之前就被销毁
+  InlineWaitGroup *groups[CompleteBatchSize];
+  while (head != tail) {
+    unsigned int completed = 0;
+    for (; head != tail && completed < CompleteBatchSize; ++head) {
+      auto cqe = &cq_.cqes[head & *cq_.mask];
+      if (cqe->user_data == 0) {
+        stop = true;
+        continue;
+      }
+      auto request = reinterpret_cast<Request *>(cqe->user_data);
+      request->result = cqe->res;
+      groups[completed++] = request->group_;
+    }
+    __atomic_store_n(cq_.head, head, __ATOMIC_RELEASE);
+    if (completed > 0) {
+      {
+        marl::lock lock(mutex_);
+        in_flight_ -= completed;
+        slots_.notify_all();
+      }
+      // done()之后提交者可能随时销毁request和group
+      for (unsigned int i = 0; i < completed; ++i) {
+        groups[i]->done();
+      }
+    }
+  }
+  return stop;
+}
+
+//// 使用当前Scheduler的Ring ////
+
+ssize_t read(int fd, void *buf, size_t len, off_t offset) {
+  auto request = Request::read(fd, buf, len, offset);
+  submit(&request, 1);
+  return request.result;
+}
+
+ssize_t write(int fd, const void *buf, size_t len, off_t offset) {
+  auto request = Request::write(fd, buf, len, offset);
+  submit(&request, 1);
+  return request.result;
+}
+
+ssize_t readv(int fd, const iovec *iov, int iovcnt, off_t offset) {
+  auto request = Request::readv(fd, iov, iovcnt, offset);
+  submit(&request, 1);
+  return request.result;
+}
+
+ssize_t writev(int fd, const iovec *iov, int iovcnt, off_t offset) {
+  auto request = Request::writev(fd, iov, iovcnt, offset);
+  submit(&request, 1);
+  return request.result;
+}
+
+int fsync(int fd) {
+  auto request = Request::fsync(fd);
+  submit(&request, 1);
+  return static_cast<int>(request.result);
+}
+
+int fdatasync(int fd) {
+  auto request = Request::fdatasync(fd);
+  submit(&request, 1);
+  return static_cast<int>(request.result);
+}
+
+void submit(Request *requests, size_t count) {
+  auto scheduler = Scheduler::get();
+  if (scheduler == nullptr) {
+    for (size_t i = 0; i < count; ++i) {
+      execute(requests[i]);
+    }
+    return;
+  }
+  scheduler->ioRing()->submit(requests, count);
+}
+
+} // namespace marl::io
+} // namespace marl
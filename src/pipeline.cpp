@@ -0,0 +1,176 @@
+#include "marl/pipeline.hpp"
+
+#include "marl/debug.hpp"
+#include "marl/scheduler.hpp"
+
+#include <algorithm>
+
+namespace marl {
+
+Pipeline::Pipeline(size_t max_tokens, PipelineOrder order, Allocator *allocator)
+    : allocator_(allocator),
+      max_tokens_(max_tokens),
+      order_(order),
+      stages_(allocator),
+      seqs_(allocator->make_unique_n<uint64_t>(max_tokens)),
+      retired_(0, allocator) {
+  MARL_ASSERT(max_tokens > 0, "Pipeline requires at least one token");
+}
+
+Pipeline::~Pipeline() {
+  for (auto stage : stages_) {
+    stage->destroy(allocator_);
+  }
+}
+
+void Pipeline::run() {
+  MARL_ASSERT(stages_.size() > 0, "Pipeline::run() called without a source");
+  for (auto stage : stages_) {
+    stage->busy = false;
+    stage->next_seq = 0;
+    stage->head = 0;
+    stage->count = 0;
+    std::fill(stage->waiting.get(), stage->waiting.get() + max_tokens_, 0);
+    stage->items = 0;
+    stage->busy_ns = 0;
+    stage->stalls = 0;
+  }
+  next_item_ = 0;
+  source_done_ = false;
+
+  // 槽位0由调用者直接获得源阶段，其余的槽位在源阶段中排队，源阶段每产生一个数据就把自己交给下一个槽位
+  auto source = stages_[0];
+  source->busy = true;
+  for (size_t slot = 1; slot < max_tokens_; ++slot) {
+    source->waiting.get()[source->count++] = slot + 1;
+  }
+  retired_.add(static_cast<unsigned int>(max_tokens_));
+  auto start = std::chrono::steady_clock::now();
+  advance(0, 0, true);
+  retired_.wait();
+  elapsed_ = std::chrono::steady_clock::now() - start;
+}
+
+PipelineStageStats Pipeline::stageStats(size_t stage) const {
+  MARL_ASSERT(stage < stages_.size(), "Pipeline::stageStats() stage out of range");
+  auto &s = *stages_[stage];
+  PipelineStageStats stats;
+  stats.items = s.items.load();
+  stats.busy = std::chrono::nanoseconds(s.busy_ns.load());
+  stats.stalls = s.stalls.load();
+  if (elapsed_.count() > 0) {
+    auto seconds = std::chrono::duration<double>(elapsed_).count();
+    stats.throughput = static_cast<double>(stats.items) / seconds;
+    stats.utilization = static_cast<double>(stats.busy.count()) / static_cast<double>(elapsed_.count());
+  }
+  return stats;
+}
+
+void Pipeline::advance(size_t slot, size_t stage, bool acquired) {
+  while (true) {
+    if (stage == stages_.size()) {
+      // 经过了最后一个阶段，回到源阶段读取下一个数据
+      stage = 0;
+    }
+    auto s = stages_[stage];
+    if (s->mode == StageMode::Serial && !acquired && !acquire(slot, stage)) {
+      return;
+    }
+    acquired = false;
+
+    auto start = std::chrono::steady_clock::now();
+    auto produced = s->process(slot);
+    if (produced) {
+      auto busy = std::chrono::steady_clock::now() - start;
+      s->items.fetch_add(1, std::memory_order_relaxed);
+      s->busy_ns.fetch_add(static_cast<uint64_t>(busy.count()), std::memory_order_relaxed);
+    }
+    if (stage == 0) {
+      if (produced) {
+        seqs_.get()[slot] = next_item_++;
+      } else {
+        marl::lock lock(s->mutex);
+        source_done_ = true;
+      }
+    }
+    if (s->mode == StageMode::Serial) {
+      if (auto next = release(stage)) {
+        // 串行阶段留在当前线程上继续处理被挂起的token，使串行阶段之间的交接不需要等待其他线程被唤醒，
+        // 当前token则被调度到其他线程上继续执行后面的阶段
+        if (produced) {
+          schedule(Task([this, slot, stage] { advance(slot, stage + 1, false); }));
+        } else {
+          retire();
+        }
+        slot = next - 1;
+        acquired = true;
+        continue;
+      }
+    }
+    if (!produced) {
+      retire();
+      return;
+    }
+    ++stage;
+  }
+}
+
+bool Pipeline::acquire(size_t slot, size_t stage) {
+  auto s = stages_[stage];
+  auto ordered = order_ == PipelineOrder::Ordered && stage > 0;
+  {
+    marl::lock lock(s->mutex);
+    if (stage != 0 || !source_done_) {
+      if (!s->busy && (!ordered || seqs_.get()[slot] == s->next_seq)) {
+        s->busy = true;
+        return true;
+      }
+      if (ordered) {
+        s->waiting.get()[seqs_.get()[slot] % max_tokens_] = slot + 1;
+      } else {
+        s->waiting.get()[(s->head + s->count++) % max_tokens_] = slot + 1;
+      }
+      s->stalls.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  }
+  // 源阶段已经没有数据了
+  retire();
+  return false;
+}
+
+size_t Pipeline::release(size_t stage) {
+  auto s = stages_[stage];
+  auto ordered = order_ == PipelineOrder::Ordered && stage > 0;
+  size_t next = 0;
+  size_t num_retired = 0;
+  {
+    marl::lock lock(s->mutex);
+    if (ordered) {
+      auto &waiting = s->waiting.get()[++s->next_seq % max_tokens_];
+      next = waiting;
+      waiting = 0;
+    } else if (stage == 0 && source_done_) {
+      // 源阶段结束时，所有还在排队的槽位都直接退出
+      num_retired = s->count;
+      s->count = 0;
+    } else if (s->count > 0) {
+      next = s->waiting.get()[s->head];
+      s->head = (s->head + 1) % max_tokens_;
+      --s->count;
+    }
+    if (next == 0) {
+      s->busy = false;
+    }
+  }
+  for (size_t i = 0; i < num_retired; ++i) {
+    retire();
+  }
+  return next;
+}
+
+void Pipeline::retire() {
+  retired_.done();
+}
+
+} // namespace marl
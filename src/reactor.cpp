@@ -0,0 +1,313 @@
+#include "marl/reactor.hpp"
+
+#include "marl/debug.hpp"
+
+#include <algorithm>
+#include <cerrno>
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace {
+
+/// 一次最多处理的epoll事件数
+constexpr int MaxEvents = 64;
+
+/// 一次最多唤醒的fiber数
+constexpr size_t MaxNotifyBatch = 32;
+
+/// fd出错或者被挂断时唤醒所有的等待者
+constexpr uint32_t ErrorEvents = EPOLLERR | EPOLLHUP;
+
+/// 在没有绑定Scheduler的线程上通过poll()等待fd就绪
+int pollFd(int fd, uint32_t events, const marl::Reactor::TimePoint *timeout) {
+  pollfd pfd = {fd, static_cast<short>(events), 0};
+  while (true) {
+    int timeout_ms = -1;
+    if (timeout != nullptr) {
+      auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+          *timeout - std::chrono::system_clock::now());
+      timeout_ms = static_cast<int>(std::max<std::chrono::milliseconds::rep>(remaining.count(), 0));
+    }
+    auto res = ::poll(&pfd, 1, timeout_ms);
+    if (res > 0) {
+      return 0;
+    }
+    if (res == 0) {
+      return -ETIMEDOUT;
+    }
+    if (errno != EINTR) {
+      return -errno;
+    }
+  }
+}
+
+/// 等待fd上出现events中的事件
+int waitFor(int fd, uint32_t events, const marl::Reactor::TimePoint *timeout) {
+  auto scheduler = marl::Scheduler::get();
+  if (scheduler == nullptr) {
+    return pollFd(fd, events, timeout);
+  }
+  return scheduler->reactor()->wait(fd, events, timeout);
+}
+
+} // anonymous namespace
+
+namespace marl {
+
+//// Reactor ////
+
+Reactor::Reactor(Scheduler *scheduler, Allocator *allocator) : scheduler_(scheduler), fds_(allocator) {
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  MARL_ASSERT(epoll_fd_ >= 0, "epoll_create1() failed: %d", errno);
+  wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  MARL_ASSERT(wake_fd_ >= 0, "eventfd() failed: %d", errno);
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = wake_fd_;
+  auto res = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+  (void) res;
+  MARL_ASSERT(res == 0, "epoll_ctl() failed: %d", errno);
+}
+
+Reactor::~Reactor() {
+  MARL_ASSERT(!hasWaiters(), "Reactor destroyed with fibers still waiting");
+  close(wake_fd_);
+  close(epoll_fd_);
+}
+
+int Reactor::wait(int fd, uint32_t events, const TimePoint *timeout) {
+  auto fiber = Scheduler::Fiber::current();
+  MARL_ASSERT(fiber != nullptr, "Reactor::wait() must be called on a fiber");
+  Waiter waiter{fiber, events};
+
+  marl::lock lock(mutex_);
+  auto &state = fds_[fd];
+  if (state.waiters == nullptr) {
+    // 没有等待者时记录的监听状态不可信：fd可能已经被关闭并复用，原本的注册已经被epoll移除，
+    // 因此第一个等待者总是重新注册
+    state.armed = 0;
+  }
+  waiter.next = state.waiters;
+  state.waiters = &waiter;
+  auto res = arm(fd, state);
+  if (res < 0) {
+    state.waiters = waiter.next;
+    if (state.waiters == nullptr) {
+      fds_.erase(fd);
+    }
+    return res;
+  }
+  if (num_waiters_++ == 0 && !polling_.load(std::memory_order_seq_cst)) {
+    // 当前没有轮询者，所有空闲的Worker都在休眠，唤醒其中一个来轮询
+    scheduler_->wakeReactorPoller();
+  }
+
+  auto pred = [&waiter]() { return waiter.ready; };
+  bool ready;
+  if (timeout != nullptr) {
+    ready = fiber->wait(lock, *timeout, pred);
+  } else {
+    fiber->wait(lock, pred);
+    ready = true;
+  }
+  if (ready || waiter.ready) {
+    // dispatch()已经将waiter从链表中移除
+    return 0;
+  }
+
+  // 超时，将waiter从链表中移除，fd中可能还留有已经没有等待者的监听，事件触发时会被忽略
+  for (auto link = &state.waiters; *link != nullptr; link = &(*link)->next) {
+    if (*link == &waiter) {
+      *link = waiter.next;
+      break;
+    }
+  }
+  if (state.waiters == nullptr) {
+    // 最后一个等待者离开时删除fd的状态，避免fds_随着不再使用的fd无限增长
+    fds_.erase(fd);
+  }
+  --num_waiters_;
+  return -ETIMEDOUT;
+}
+
+void Reactor::poll(int timeout_ms) {
+  epoll_event events[MaxEvents];
+  auto count = epoll_wait(epoll_fd_, events, MaxEvents, timeout_ms);
+  for (int i = 0; i < count; ++i) {
+    if (events[i].data.fd == wake_fd_) {
+      uint64_t value;
+      auto res = ::read(wake_fd_, &value, sizeof(value));
+      (void) res;
+      continue;
+    }
+    dispatch(events[i].data.fd, events[i].events);
+  }
+}
+
+void Reactor::wake() {
+  uint64_t value = 1;
+  auto res = ::write(wake_fd_, &value, sizeof(value));
+  (void) res;
+}
+
+int Reactor::arm(int fd, FdState &state) {
+  uint32_t events = 0;
+  for (auto waiter = state.waiters; waiter != nullptr; waiter = waiter->next) {
+    events |= waiter->events;
+  }
+  if (events == 0 || (state.armed & events) == events) {
+    return 0;
+  }
+
+  // 使用EPOLLONESHOT，事件触发后由dispatch()根据剩余的等待者重新监听
+  // 水平触发保证了在arm()之前就已经就绪的fd也会立即产生事件
+  epoll_event event = {};
+  event.events = events | EPOLLONESHOT;
+  event.data.fd = fd;
+  auto op = state.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+  auto res = epoll_ctl(epoll_fd_, op, fd, &event);
+  if (res < 0 && errno == ENOENT) {
+    // fd关闭之后被复用，已经不在epoll中了
+    res = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+  } else if (res < 0 && errno == EEXIST) {
+    res = epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event);
+  }
+  if (res < 0) {
+    return -errno;
+  }
+  state.registered = true;
+  state.armed = events;
+  return 0;
+}
+
+void Reactor::dispatch(int fd, uint32_t revents) {
+  Scheduler::Fiber *fibers[MaxNotifyBatch];
+  size_t count = 0;
+
+  marl::lock lock(mutex_);
+  auto it = fds_.find(fd);
+  if (it == fds_.end()) {
+    return;
+  }
+  auto &state = it->second;
+  state.armed = 0;
+  for (auto link = &state.waiters; *link != nullptr;) {
+    auto waiter = *link;
+    if ((waiter->events & revents) == 0 && (revents & ErrorEvents) == 0) {
+      link = &waiter->next;
+      continue;
+    }
+    *link = waiter->next;
+    waiter->ready = true;
+    --num_waiters_;
+    // 等待者在持有mutex_时检查ready，因此必须在释放锁之前唤醒它
+    fibers[count++] = waiter->fiber;
+    if (count == MaxNotifyBatch) {
+      Scheduler::Fiber::notify(fibers, count);
+      count = 0;
+    }
+  }
+  if (count > 0) {
+    Scheduler::Fiber::notify(fibers, count);
+  }
+  if (state.waiters != nullptr) {
+    auto res = arm(fd, state);
+    if (res < 0) {
+      // fd已经无法监听，唤醒剩余的等待者，由它们重试操作并得到错误
+      for (auto waiter = state.waiters; waiter != nullptr; waiter = waiter->next) {
+        waiter->ready = true;
+        --num_waiters_;
+        waiter->fiber->notify();
+      }
+      state.waiters = nullptr;
+    }
+  }
+}
+
+namespace net {
+
+int waitReadable(int fd, const Reactor::TimePoint *timeout) {
+  return waitFor(fd, EPOLLIN, timeout);
+}
+
+int waitWritable(int fd, const Reactor::TimePoint *timeout) {
+  return waitFor(fd, EPOLLOUT, timeout);
+}
+
+ssize_t read(int fd, void *buf, size_t len) {
+  while (true) {
+    auto res = ::read(fd, buf, len);
+    if (res >= 0) {
+      return res;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      auto err = waitFor(fd, EPOLLIN, nullptr);
+      if (err < 0) {
+        return err;
+      }
+    } else if (errno != EINTR) {
+      return -errno;
+    }
+  }
+}
+
+ssize_t write(int fd, const void *buf, size_t len) {
+  while (true) {
+    auto res = ::write(fd, buf, len);
+    if (res >= 0) {
+      return res;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      auto err = waitFor(fd, EPOLLOUT, nullptr);
+      if (err < 0) {
+        return err;
+      }
+    } else if (errno != EINTR) {
+      return -errno;
+    }
+  }
+}
+
+int accept(int fd, sockaddr *addr, socklen_t *addrlen) {
+  while (true) {
+    auto res = ::accept4(fd, addr, addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (res >= 0) {
+      return res;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      auto err = waitFor(fd, EPOLLIN, nullptr);
+      if (err < 0) {
+        return err;
+      }
+    } else if (errno != EINTR && errno != ECONNABORTED) {
+      return -errno;
+    }
+  }
+}
+
+int connect(int fd, const sockaddr *addr, socklen_t addrlen) {
+  auto res = ::connect(fd, addr, addrlen);
+  if (res == 0) {
+    return 0;
+  }
+  if (errno != EINPROGRESS && errno != EINTR) {
+    return -errno;
+  }
+  // 连接在后台建立，fd可写时通过SO_ERROR获取结果
+  auto err = waitFor(fd, EPOLLOUT, nullptr);
+  if (err < 0) {
+    return err;
+  }
+  int so_error = 0;
+  socklen_t len = sizeof(so_error);
+  if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &so_error, &len) < 0) {
+    return -errno;
+  }
+  return -so_error;
+}
+
+} // namespace marl::net
+} // namespace marl
@@ -2,11 +2,21 @@
 
 #include "marl/scheduler.hpp"
 
+#include "marl/blocking_call_pool.hpp"
+#include "marl/completion.hpp"
 #include "marl/debug.hpp"
+#include "marl/io.hpp"
+#include "marl/reactor.hpp"
 #include "marl/sanitizer.hpp"
 #include "marl/thread.hpp"
 #include "marl/trace.hpp"
 
+#include <algorithm>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
 #define ENABLE_TRACE_EVENTS 0
 #define ENABLE_DEBUG_LOGGING 0
 
@@ -53,6 +63,42 @@ inline marl::Scheduler::Config setConfigDefaults(
   return config;
 }
 
+/// 如果*addr仍然等于expected，则休眠直到被futexWake()唤醒或者到达timeout（system_clock的绝对时间）
+inline void futexWait(std::atomic<uint32_t> &addr, uint32_t expected,
+                      const marl::Scheduler::TimePoint *timeout) {
+  static_assert(sizeof(addr) == sizeof(uint32_t), "futex word must be 32 bits");
+  timespec ts{};
+  if (timeout != nullptr) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        timeout->time_since_epoch()).count();
+    ts.tv_sec = static_cast<time_t>(ns / 1000000000);
+    ts.tv_nsec = static_cast<long>(ns % 1000000000);
+  }
+  // FUTEX_CLOCK_REALTIME使超时时间以CLOCK_REALTIME（即system_clock）的绝对时间表示
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&addr),
+          FUTEX_WAIT_BITSET_PRIVATE | FUTEX_CLOCK_REALTIME, expected,
+          timeout != nullptr ? &ts : nullptr, nullptr, FUTEX_BITSET_MATCH_ANY);
+}
+
+/// 唤醒一个在addr上休眠的线程
+inline void futexWake(std::atomic<uint32_t> &addr) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&addr), FUTEX_WAKE_PRIVATE, 1,
+          nullptr, nullptr, 0);
+}
+
+/// 工作线程在休眠前自旋的时间
+constexpr auto SpinDuration = std::chrono::milliseconds(1);
+
+/// 忙碌的Worker的定时任务超过触发时间这么久仍未被触发时，由空闲的Worker代为触发
+constexpr auto TimerStealDelay = std::chrono::milliseconds(1);
+
+/// 每次最多从其他Worker的定时器堆中取出的定时任务数
+constexpr size_t MaxStolenTimers = 64;
+
+inline marl::Scheduler::TimePoint toTimePoint(marl::Scheduler::TimePoint::rep rep) {
+  return marl::Scheduler::TimePoint(marl::Scheduler::TimePoint::duration(rep));
+}
+
 } // anonymous namespace
 
 namespace marl {
@@ -66,6 +112,14 @@ Scheduler *Scheduler::get() {
 }
 
 void Scheduler::bind() {
+  bind(false);
+}
+
+void Scheduler::unbind() {
+  unbind(false);
+}
+
+void Scheduler::bind(bool pooled) {
 #if !MEMORY_SANITIZER_ENABLED
   // 动态库中的thread_local变量会在装载的时候初始化，
   // 但是如果loader没有被检测到的话，这个行为无法被MemorySanitizer观察到
@@ -80,10 +134,13 @@ void Scheduler::bind() {
     worker->start();
     auto tid = std::this_thread::get_id();
     single_threaded_workers_.by_tid.emplace(tid, std::move(worker));
+    if (pooled) {
+      ++single_threaded_workers_.num_pooled;
+    }
   }
 }
 
-void Scheduler::unbind() {
+void Scheduler::unbind(bool pooled) {
   MARL_ASSERT(bound != nullptr, "No scheduler bound");
   auto worker = Worker::getCurrent();
   worker->stop();
@@ -95,7 +152,10 @@ void Scheduler::unbind() {
                 "singleThreadedWorker not found");
     MARL_ASSERT(it->second.get() == worker, "worker is not bound?");
     bound->single_threaded_workers_.by_tid.erase(it);
-    if (bound->single_threaded_workers_.by_tid.empty()) {
+    if (pooled) {
+      --bound->single_threaded_workers_.num_pooled;
+    }
+    if (bound->single_threaded_workers_.by_tid.size() == bound->single_threaded_workers_.num_pooled) {
       bound->single_threaded_workers_.unbind.notify_one();
     }
   }
@@ -115,25 +175,43 @@ Scheduler::Scheduler(const Config &config)
   for (int i = 0; i < cfg_.worker_thread.count; ++i) {
     worker_threads_[i]->start();
   }
+  blocking_call_pool_ = cfg_.allocator->make_unique<BlockingCallPool>(
+      this, cfg_.blocking_call, cfg_.allocator);
 }
 
 Scheduler::~Scheduler() {
   {
-    // 等待所有single threaded workers被解绑
+    // 等待所有single threaded workers被解绑，BlockingCallPool的线程除外
     marl::lock lock(single_threaded_workers_.mutex);
     lock.wait(single_threaded_workers_.unbind,
               [this]() REQUIRES(single_threaded_workers_.mutex) {
-                return single_threaded_workers_.by_tid.empty();
+                return single_threaded_workers_.by_tid.size() == single_threaded_workers_.num_pooled;
               });
   }
   // 释放所有的工作线程
-  // 这个过程会等待所有任务完成
+  // 这个过程会等待所有任务完成，这些任务仍然可以调用marl::blocking_call()
   for (int i = cfg_.worker_thread.count - 1; i >= 0; --i) {
     worker_threads_[i]->stop();
   }
+  // 所有的调用都已经完成，线程池中的线程只会在各自的SingleThreaded Worker上等待，
+  // 不依赖已经停止的工作线程，结束并解绑它们
+  blocking_call_pool_.reset();
   for (int i = cfg_.worker_thread.count - 1; i >= 0; --i) {
     cfg_.allocator->destroy(worker_threads_[i]);
   }
+  // 所有的fiber都已经结束，不会再有在途的I/O请求
+  if (auto ring = io_ring_.load()) {
+    cfg_.allocator->destroy(ring);
+  }
+  if (auto reactor = reactor_.load()) {
+    cfg_.allocator->destroy(reactor);
+  }
+}
+
+int Scheduler::currentWorkerId() {
+  // SingleThreaded模式的Worker的id为-1
+  auto worker = Worker::getCurrent();
+  return worker != nullptr ? static_cast<int>(worker->id_) : -1;
 }
 
 void Scheduler::enqueue(Task &&task) {
@@ -171,6 +249,84 @@ const Scheduler::Config &Scheduler::config() const {
   return cfg_;
 }
 
+BlockingCallPool *Scheduler::blockingCallPool() {
+  return blocking_call_pool_.get();
+}
+
+io::Ring *Scheduler::ioRing() {
+  if (auto ring = io_ring_.load(std::memory_order_acquire)) {
+    return ring;
+  }
+  marl::lock lock(io_ring_mutex_);
+  auto ring = io_ring_.load(std::memory_order_relaxed);
+  if (ring == nullptr) {
+    ring = cfg_.allocator->create<io::Ring>(cfg_.io_ring.entries,
+                                            cfg_.io_ring.use_io_uring,
+                                            cfg_.allocator);
+    io_ring_.store(ring, std::memory_order_release);
+  }
+  return ring;
+}
+
+Scheduler::Timer Scheduler::enqueueAt(const TimePoint &when, Task &&task) {
+  return enqueueTimer(when, TimePoint::duration::zero(), std::move(task));
+}
+
+Scheduler::Timer Scheduler::enqueueTimer(const TimePoint &when,
+                                         TimePoint::duration period,
+                                         Task &&task) {
+  auto state = cfg_.allocator->create<TimerState>(cfg_.allocator, std::move(task), when, period);
+  Worker *worker;
+  if (cfg_.worker_thread.count > 0) {
+    worker = worker_threads_[next_enqueue_index_++ % cfg_.worker_thread.count];
+  } else {
+    worker = Worker::getCurrent();
+    MARL_ASSERT(worker != nullptr,
+                "singleThreadedWorker not found. Did you forget to call "
+                "marl::Scheduler::bind()?");
+  }
+  worker->addTimer(state);
+  return Timer(state);
+}
+
+void Scheduler::wakeReactorPoller() {
+  auto count = cfg_.worker_thread.count;
+  auto start = next_enqueue_index_.load(std::memory_order_relaxed);
+  for (int i = 0; i < count; ++i) {
+    if (worker_threads_[(start + i) % count]->wakeIfSleeping()) {
+      return;
+    }
+  }
+}
+
+Reactor *Scheduler::reactor() {
+  if (auto reactor = reactor_.load(std::memory_order_acquire)) {
+    return reactor;
+  }
+  marl::lock lock(reactor_mutex_);
+  auto reactor = reactor_.load(std::memory_order_relaxed);
+  if (reactor == nullptr) {
+    reactor = cfg_.allocator->create<Reactor>(this, cfg_.allocator);
+    reactor_.store(reactor, std::memory_order_release);
+  }
+  return reactor;
+}
+
+void Scheduler::enqueueLocal(Task &&task) {
+  auto worker = Worker::getCurrent();
+  if (worker == nullptr || (currentWorkerId() < 0 && cfg_.worker_thread.count > 0)) {
+    // 通过bind()绑定的线程的队列不会被工作线程窃取
+    enqueue(std::move(task));
+    return;
+  }
+  worker->enqueue(std::move(task));
+}
+
+bool Scheduler::popLocal(Task &out, bool (*match)(const Task &, const void *), const void *arg) {
+  auto worker = Worker::getCurrent();
+  return worker != nullptr && worker->popBack(out, match, arg);
+}
+
 bool Scheduler::stealWork(Worker *thief, uint64_t from, Task &out) {
   if (cfg_.worker_thread.count > 0) {
     auto thread = worker_threads_[from % cfg_.worker_thread.count];
@@ -211,6 +367,21 @@ void Scheduler::Fiber::notify() {
   worker_->enqueue(this);
 }
 
+void Scheduler::Fiber::notify(Fiber **fibers, size_t count) {
+  std::sort(fibers, fibers + count, [](Fiber *a, Fiber *b) {
+    return std::less<Worker *>()(a->worker_, b->worker_);
+  });
+  for (size_t begin = 0; begin < count;) {
+    auto worker = fibers[begin]->worker_;
+    auto end = begin + 1;
+    while (end < count && fibers[end]->worker_ == worker) {
+      ++end;
+    }
+    worker->enqueue(fibers + begin, end - begin);
+    begin = end;
+  }
+}
+
 void Scheduler::Fiber::wait(marl::lock &lock, const Predicate &pred) {
   MARL_ASSERT(worker_ == Worker::getCurrent(),
               "Scheduler::Fiber::wait() must only be called on the currently "
@@ -256,6 +427,94 @@ const char *Scheduler::Fiber::toString(State state) {
   return "<unknown>";
 }
 
+//// Scheduler::Timer ////
+
+Scheduler::Timer::~Timer() {
+  if (state_ != nullptr) {
+    state_->release();
+  }
+}
+
+void Scheduler::Timer::cancel() {
+  if (state_ != nullptr && !state_->cancelled.exchange(true, std::memory_order_acq_rel)) {
+    if (auto worker = state_->worker.load(std::memory_order_acquire)) {
+      worker->onTimerCancelled();
+    }
+  }
+}
+
+//// Scheduler::TimerState ////
+
+Scheduler::TimerState::TimerState(Allocator *allocator,
+                                  Task &&task,
+                                  TimePoint when,
+                                  TimePoint::duration period)
+    : allocator(allocator), task(std::move(task)), when(when), period(period) {}
+
+void Scheduler::TimerState::release() {
+  if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    allocator->destroy(this);
+  }
+}
+
+//// Scheduler::TimerQueue ////
+
+Scheduler::TimerQueue::TimerQueue(Allocator *allocator) : heap(allocator) {}
+
+Scheduler::TimerQueue::~TimerQueue() {
+  for (auto &entry : heap) {
+    entry.state->worker.store(nullptr, std::memory_order_relaxed);
+    entry.state->release();
+  }
+}
+
+Scheduler::TimerQueue::operator bool() const {
+  return heap.size() > 0;
+}
+
+size_t Scheduler::TimerQueue::size() const {
+  return heap.size();
+}
+
+Scheduler::TimePoint Scheduler::TimerQueue::next() const {
+  MARL_ASSERT(*this, "TimerQueue::next() called when there's no timers");
+  return heap.front().when;
+}
+
+bool Scheduler::TimerQueue::push(TimerState *state) {
+  heap.push_back(Entry{state->when, state});
+  std::push_heap(heap.begin(), heap.end());
+  return heap.front().state == state;
+}
+
+Scheduler::TimerState *Scheduler::TimerQueue::take(const TimePoint &now) {
+  if (!*this || now < heap.front().when) {
+    return nullptr;
+  }
+  std::pop_heap(heap.begin(), heap.end());
+  auto state = heap.back().state;
+  heap.pop_back();
+  state->worker.store(nullptr, std::memory_order_relaxed);
+  return state;
+}
+
+void Scheduler::TimerQueue::compact() {
+  size_t kept = 0;
+  for (size_t i = 0; i < heap.size(); ++i) {
+    auto state = heap[i].state;
+    if (state->cancelled.load(std::memory_order_acquire)) {
+      // Timer句柄可能还持有TimerState，先销毁任务来释放它持有的资源
+      state->worker.store(nullptr, std::memory_order_relaxed);
+      state->task = Task();
+      state->release();
+    } else {
+      heap[kept++] = heap[i];
+    }
+  }
+  heap.resize(kept);
+  std::make_heap(heap.begin(), heap.end());
+}
+
 //// Scheduler::WaitingFibers ////
 
 Scheduler::WaitingFibers::WaitingFibers(Allocator *allocator)
@@ -455,32 +714,55 @@ bool Scheduler::Worker::tryLock() {
 }
 
 void Scheduler::Worker::enqueue(Fiber *fiber) {
-  bool notify = false;
+  bool sleeping = false;
   {
     marl::lock lock(work_.mutex);
-    DBG_LOG("%d: ENQUEUE(%d %s)", (int) id, (int) fiber->id,
-            Fiber::toString(fiber->state));
-    switch (fiber->state_) {
-      case Fiber::State::Running:
-      case Fiber::State::Queued:
-        return; // 什么都不需要做
-      case Fiber::State::Waiting:
-        work_.waiting.erase(fiber);
-        break;
-      case Fiber::State::Idle:
-      case Fiber::State::Yielded:
-        break;
+    if (!enqueueFiberLocked(fiber)) {
+      return; // 什么都不需要做
     }
-    notify = work_.notify_added;
-    work_.fibers.push_back(fiber);
-    MARL_ASSERT(!work_.waiting.contains(fiber),
-                "fiber is unexpectedly in the waiting list");
-    setFiberState(fiber, Fiber::State::Queued);
-    ++work_.num;
+    sleeping = work_.sleep.load(std::memory_order_relaxed) != Work::Sleep::Awake;
+  }
+  if (sleeping) {
+    wakeup();
+  }
+}
+
+void Scheduler::Worker::enqueue(Fiber *const *fibers, size_t count) {
+  bool sleeping = false;
+  {
+    marl::lock lock(work_.mutex);
+    bool added = false;
+    for (size_t i = 0; i < count; ++i) {
+      added |= enqueueFiberLocked(fibers[i]);
+    }
+    sleeping = added && work_.sleep.load(std::memory_order_relaxed) != Work::Sleep::Awake;
+  }
+  // 只有当前Worker会处理work_.fibers，唤醒一次就足够了
+  if (sleeping) {
+    wakeup();
   }
-  if (notify) {
-    work_.added.notify_one();
+}
+
+bool Scheduler::Worker::enqueueFiberLocked(Fiber *fiber) {
+  DBG_LOG("%d: ENQUEUE(%d %s)", (int) id, (int) fiber->id,
+          Fiber::toString(fiber->state));
+  switch (fiber->state_) {
+    case Fiber::State::Running:
+    case Fiber::State::Queued:
+      return false;
+    case Fiber::State::Waiting:
+      work_.waiting.erase(fiber);
+      break;
+    case Fiber::State::Idle:
+    case Fiber::State::Yielded:
+      break;
   }
+  work_.fibers.push_back(fiber);
+  MARL_ASSERT(!work_.waiting.contains(fiber),
+              "fiber is unexpectedly in the waiting list");
+  setFiberState(fiber, Fiber::State::Queued);
+  ++work_.num;
+  return true;
 }
 
 void Scheduler::Worker::enqueue(Task &&task) {
@@ -489,12 +771,79 @@ void Scheduler::Worker::enqueue(Task &&task) {
 }
 
 void Scheduler::Worker::enqueueAndUnlock(Task &&task) {
-  auto notify = work_.notify_added;
+  auto sleeping = work_.sleep.load(std::memory_order_relaxed) != Work::Sleep::Awake;
   work_.tasks.push_back(std::move(task));
   ++work_.num;
   work_.mutex.unlock();
-  if (notify) {
-    work_.added.notify_one();
+  if (sleeping) {
+    wakeup();
+  }
+}
+
+void Scheduler::Worker::post(Completion &completion) {
+  auto head = work_.inbox.load(std::memory_order_relaxed);
+  do {
+    completion.next_ = head;
+  } while (!work_.inbox.compare_exchange_weak(head, &completion, std::memory_order_seq_cst,
+                                              std::memory_order_relaxed));
+  // 收件箱原本非空时，之前的post()已经唤醒过Worker，并且Worker在取出所有Completion之前不会休眠
+  if (head == nullptr) {
+    wakeup();
+  }
+}
+
+void Scheduler::Worker::wait(Completion &completion) {
+  marl::lock lock(work_.mutex);
+  drainCompletions();
+  while (!completion.done_) {
+    suspend(nullptr);
+  }
+  completion.done_ = false;
+}
+
+void Scheduler::Worker::drainCompletions() {
+  if (work_.inbox.load(std::memory_order_relaxed) == nullptr) {
+    return;
+  }
+  auto head = work_.inbox.exchange(nullptr, std::memory_order_acquire);
+  // 收件箱是后进先出的，反转之后按照post()的顺序恢复fiber
+  Completion *fifo = nullptr;
+  while (head != nullptr) {
+    auto next = head->next_;
+    head->next_ = fifo;
+    fifo = head;
+    head = next;
+  }
+  while (fifo != nullptr) {
+    // fiber恢复之后可能会立即销毁Completion，需要先取出next_
+    auto next = fifo->next_;
+    fifo->done_ = true;
+    enqueueFiberLocked(fifo->fiber_);
+    fifo = next;
+  }
+}
+
+bool Scheduler::Worker::wakeIfSleeping() {
+  if (work_.sleep.load(std::memory_order_seq_cst) != Work::Sleep::Futex) {
+    return false;
+  }
+  wakeup();
+  return true;
+}
+
+void Scheduler::Worker::wakeup() {
+  // 与Work::wait()和pollForWork()中先设置sleep，再读取doorbell和检查任务的顺序配对，
+  // 保证Worker要么能看到新的任务，要么能被唤醒
+  work_.doorbell.fetch_add(1, std::memory_order_seq_cst);
+  switch (work_.sleep.load(std::memory_order_seq_cst)) {
+    case Work::Sleep::Futex:
+      futexWake(work_.doorbell);
+      break;
+    case Work::Sleep::Reactor:
+      scheduler_->reactor_.load(std::memory_order_acquire)->wake();
+      break;
+    case Work::Sleep::Awake:
+      break;
   }
 }
 
@@ -515,15 +864,29 @@ bool Scheduler::Worker::steal(Task &out) {
   return true;
 }
 
+bool Scheduler::Worker::popBack(Task &out, bool (*match)(const Task &, const void *), const void *arg) {
+  marl::lock lock(work_.mutex);
+  if (work_.tasks.empty() || !match(work_.tasks.back(), arg)) {
+    return false;
+  }
+  --work_.num;
+  out = std::move(work_.tasks.back());
+  work_.tasks.pop_back();
+  return true;
+}
+
 void Scheduler::Worker::run() {
   if (mode_ == Mode::MultiThreaded) {
     MARL_NAME_THREAD("Thread<%.2d> Fiber<%.2d>", int(id), Fiber::current()->id);
+    scheduler_->idle_workers_.fetch_add(1, std::memory_order_relaxed);
     work_.wait([this]() REQUIRES(work_.mutex) {
-      return work_.num > 0 || work_.waiting || shutdown;
+      return work_.num > 0 || work_.waiting || shutdown || timersNeedCompaction() || reactorNeedsPoller();
     });
+    scheduler_->idle_workers_.fetch_sub(1, std::memory_order_relaxed);
   }
   ASSERT_FIBER_STATE(current_fiber_, Fiber::State::Running);
   runUntilShutdown();
+  setBusy(false);
   switchToFiber(main_fiber_.get());
 }
 
@@ -537,22 +900,254 @@ void Scheduler::Worker::runUntilShutdown() {
 void Scheduler::Worker::waitForWork() {
   MARL_ASSERT(work_.num == work_.fibers.size() + work_.tasks.size(),
               "work.num out of sync");
+  drainCompletions();
+  if (work_.timers) {
+    enqueueDueTimers();
+  }
   if (work_.num > 0) {
+    setBusy(true);
+    handOffReactorPoll();
     return;
   }
+  setBusy(false);
   if (mode_ == Mode::MultiThreaded) {
+    scheduler_->idle_workers_.fetch_add(1, std::memory_order_relaxed);
+  }
+  // 自旋最多持续SpinDuration，即将到期的定时任务不能被自旋推迟
+  auto timer_due_soon = work_.timers &&
+      work_.timers.next() - std::chrono::system_clock::now() < SpinDuration;
+  if (mode_ == Mode::MultiThreaded && !timer_due_soon) {
     scheduler_->onBeginSpinning(id_);
     work_.mutex.unlock();
     spinForWork();
     work_.mutex.lock();
   }
 
-  work_.wait([this]() REQUIRES(work_.mutex) {
-    return work_.num > 0 || (shutdown && work_.num_blocked_fibers == 0);
-  });
+  // 有fiber在等待fd就绪时，由一个空闲的Worker轮询reactor
+  auto reactor = scheduler_->reactor_.load(std::memory_order_acquire);
+  if (reactor != nullptr && work_.num == 0 && reactor->hasWaiters() && reactor->tryBeginPoll()) {
+    pollForWork(reactor);
+    reactor->endPoll();
+  }
+
+  // 由一个休眠的工作线程看守定时器，在忙碌的Worker没能及时触发定时任务时醒来代为触发
+  int no_watcher = -1;
+  auto watching = mode_ == Mode::MultiThreaded && scheduler_->cfg_.worker_thread.count > 1 &&
+      scheduler_->timer_watcher_.compare_exchange_strong(no_watcher, int(id_));
+  auto pred = [this]() REQUIRES(work_.mutex) {
+    return work_.num > 0 || work_.inbox.load() != nullptr ||
+        (shutdown && work_.num_blocked_fibers == 0) || timersNeedCompaction() || reactorNeedsPoller();
+  };
+  if (watching) {
+    work_.wait(pred, [this](TimePoint &deadline) REQUIRES(work_.mutex) {
+      TimePoint watch;
+      auto has_deadline = work_.nextDeadline(deadline);
+      if (timerWatchDeadline(watch) && (!has_deadline || watch < deadline)) {
+        deadline = watch;
+        has_deadline = true;
+      }
+      return has_deadline;
+    });
+    scheduler_->timer_watch_deadline_.store(NoTimerDeadline, std::memory_order_seq_cst);
+    scheduler_->timer_watcher_.store(-1, std::memory_order_seq_cst);
+  } else {
+    work_.wait(pred);
+  }
+  if (mode_ == Mode::MultiThreaded) {
+    scheduler_->idle_workers_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  if (watching) {
+    stealOverdueTimers();
+  }
+  drainCompletions();
   if (work_.waiting) {
     enqueueFiberTimeouts();
   }
+  if (work_.timers) {
+    enqueueDueTimers();
+  }
+  setBusy(work_.num > 0);
+  handOffReactorPoll();
+}
+
+void Scheduler::Worker::enqueueDueTimers() {
+  auto changed = false;
+  if (timersNeedCompaction()) {
+    work_.cancelled_timers.store(0, std::memory_order_relaxed);
+    work_.timers.compact();
+    changed = true;
+  }
+  auto now = std::chrono::system_clock::now();
+  Task task;
+  while (auto state = work_.timers.take(now)) {
+    changed = true;
+    if (timerTask(state, task)) {
+      work_.tasks.push_back(std::move(task));
+      ++work_.num;
+    }
+  }
+  if (changed) {
+    onTimersChanged();
+  }
+}
+
+void Scheduler::Worker::enqueueTimers(TimerState *const *states, size_t count) {
+  Task task;
+  for (size_t i = 0; i < count; ++i) {
+    if (timerTask(states[i], task)) {
+      work_.tasks.push_back(std::move(task));
+      ++work_.num;
+    }
+  }
+}
+
+bool Scheduler::Worker::timerTask(TimerState *state, Task &out) {
+  if (state->cancelled.load(std::memory_order_acquire)) {
+    state->task = Task();
+    state->release();
+    return false;
+  }
+  if (state->period == TimePoint::duration::zero()) {
+    out = std::move(state->task);
+    state->release();
+  } else {
+    out = Task([state] { runPeriodic(state); });
+  }
+  return true;
+}
+
+bool Scheduler::Worker::timersNeedCompaction() const {
+  // 每次移除的代价和定时器堆的大小成正比，而定时器堆不超过被取消的定时任务数的两倍，均摊到每次取消是常数时间
+  // 被取消的定时任务也可能在触发时间被取出，计数会偏大，定时器堆为空时不需要移除
+  auto cancelled = work_.cancelled_timers.load(std::memory_order_relaxed);
+  auto num_timers = work_.num_timers.load(std::memory_order_relaxed);
+  return cancelled > 0 && num_timers > 0 && cancelled * 2 >= num_timers;
+}
+
+void Scheduler::Worker::onTimerCancelled() {
+  // 和Work::wait()中先写入sleep再检查条件的顺序相对，都使用seq_cst，避免错过唤醒
+  work_.cancelled_timers.fetch_add(1, std::memory_order_seq_cst);
+  // 忙碌的Worker会在下一次检查定时器时移除它们，休眠的Worker需要被唤醒
+  if (timersNeedCompaction() && work_.sleep.load(std::memory_order_seq_cst) != Work::Sleep::Awake) {
+    wakeup();
+  }
+}
+
+void Scheduler::Worker::setBusy(bool busy) {
+  if (work_.busy != busy) {
+    work_.busy = busy;
+    onTimersChanged();
+  }
+}
+
+void Scheduler::Worker::onTimersChanged() {
+  work_.num_timers.store(work_.timers.size(), std::memory_order_relaxed);
+  if (mode_ != Mode::MultiThreaded) {
+    return;
+  }
+  auto deadline = work_.busy && work_.timers ?
+      work_.timers.next().time_since_epoch().count() : NoTimerDeadline;
+  if (busy_timer_deadline_.exchange(deadline, std::memory_order_seq_cst) == deadline ||
+      deadline == NoTimerDeadline) {
+    return;
+  }
+  // 看守者在计算休眠时间之后才会读到新的触发时间，所以需要唤醒它重新计算，
+  // 和timerWatchDeadline()都使用seq_cst，保证两者至少有一方能看到对方的写入
+  auto watcher = scheduler_->timer_watcher_.load(std::memory_order_seq_cst);
+  if (watcher >= 0 && watcher != int(id_)) {
+    auto wake = (toTimePoint(deadline) + TimerStealDelay).time_since_epoch().count();
+    if (wake < scheduler_->timer_watch_deadline_.load(std::memory_order_seq_cst)) {
+      scheduler_->worker_threads_[watcher]->wakeup();
+    }
+  }
+}
+
+bool Scheduler::Worker::timerWatchDeadline(TimePoint &deadline) {
+  auto earliest = NoTimerDeadline;
+  for (int i = 0; i < scheduler_->cfg_.worker_thread.count; ++i) {
+    auto worker = scheduler_->worker_threads_[i];
+    if (worker != this) {
+      earliest = std::min(earliest, worker->busy_timer_deadline_.load(std::memory_order_seq_cst));
+    }
+  }
+  auto watch = earliest == NoTimerDeadline ? NoTimerDeadline :
+      (toTimePoint(earliest) + TimerStealDelay).time_since_epoch().count();
+  scheduler_->timer_watch_deadline_.store(watch, std::memory_order_seq_cst);
+  if (watch == NoTimerDeadline) {
+    return false;
+  }
+  deadline = toTimePoint(watch);
+  return true;
+}
+
+size_t Scheduler::Worker::takeOverdueTimers(Worker *victim, TimerState **out, size_t max) {
+  auto deadline = victim->busy_timer_deadline_.load(std::memory_order_acquire);
+  if (deadline == NoTimerDeadline) {
+    return 0;
+  }
+  auto now = std::chrono::system_clock::now();
+  if (now < toTimePoint(deadline) + TimerStealDelay || !victim->work_.mutex.try_lock()) {
+    return 0;
+  }
+  size_t count = 0;
+  while (count < max) {
+    auto state = victim->work_.timers.take(now);
+    if (state == nullptr) {
+      break;
+    }
+    out[count++] = state;
+  }
+  victim->onTimersChanged();
+  victim->work_.mutex.unlock();
+  return count;
+}
+
+void Scheduler::Worker::stealOverdueTimers() {
+  TimerState *due[MaxStolenTimers];
+  size_t count = 0;
+  work_.mutex.unlock();
+  for (int i = 0; i < scheduler_->cfg_.worker_thread.count && count < MaxStolenTimers; ++i) {
+    auto victim = scheduler_->worker_threads_[i];
+    if (victim != this) {
+      count += takeOverdueTimers(victim, due + count, MaxStolenTimers - count);
+    }
+  }
+  work_.mutex.lock();
+  enqueueTimers(due, count);
+}
+
+void Scheduler::Worker::runPeriodic(TimerState *state) {
+  if (!state->cancelled.load(std::memory_order_acquire)) {
+    state->task();
+  }
+  if (state->cancelled.load(std::memory_order_acquire)) {
+    state->release();
+    return;
+  }
+  // 按固定频率计算下一次触发的时间，跳过已经错过的触发时间
+  state->when += state->period;
+  auto now = std::chrono::system_clock::now();
+  if (state->when <= now) {
+    auto missed = (now - state->when) / state->period + 1;
+    state->when += missed * state->period;
+  }
+  // 任务可能被其他Worker窃取，加入当前执行它的Worker的定时器堆
+  getCurrent()->addTimer(state);
+}
+
+void Scheduler::Worker::addTimer(TimerState *state) {
+  bool wake = false;
+  {
+    marl::lock lock(work_.mutex);
+    state->worker.store(this, std::memory_order_release);
+    // 只有成为最早触发的任务时，才需要唤醒Worker重新计算休眠时间
+    wake = work_.timers.push(state) &&
+        work_.sleep.load(std::memory_order_relaxed) != Work::Sleep::Awake;
+    onTimersChanged();
+  }
+  if (wake) {
+    wakeup();
+  }
 }
 
 void Scheduler::Worker::enqueueFiberTimeouts() {
@@ -565,6 +1160,39 @@ void Scheduler::Worker::enqueueFiberTimeouts() {
   }
 }
 
+void Scheduler::Worker::pollForWork(Reactor *reactor) {
+  TRACE("POLL");
+  work_.sleep.store(Work::Sleep::Reactor, std::memory_order_seq_cst);
+  while (work_.num == 0 && work_.inbox.load() == nullptr &&
+      !(shutdown && work_.num_blocked_fibers == 0)) {
+    int timeout_ms = -1;
+    TimePoint next;
+    if (work_.nextDeadline(next)) {
+      auto now = std::chrono::system_clock::now();
+      if (next <= now) {
+        break;
+      }
+      timeout_ms = static_cast<int>(
+          std::chrono::ceil<std::chrono::milliseconds>(next - now).count());
+    }
+    work_.mutex.unlock();
+    reactor->poll(timeout_ms);
+    work_.mutex.lock();
+  }
+  work_.sleep.store(Work::Sleep::Awake, std::memory_order_relaxed);
+}
+
+bool Scheduler::Worker::reactorNeedsPoller() const {
+  auto reactor = scheduler_->reactor_.load(std::memory_order_acquire);
+  return reactor != nullptr && reactor->needsPoller();
+}
+
+void Scheduler::Worker::handOffReactorPoll() {
+  if (work_.num > 0 && reactorNeedsPoller()) {
+    scheduler_->wakeReactorPoller();
+  }
+}
+
 void Scheduler::Worker::changeFiberState(Fiber *fiber, Fiber::State from, Fiber::State to) const {
   (void) from;
   DBG_LOG("%d: CHANGE_FIBER_STATE(%d %s -> %s)", (int) id, (int) fiber->id,
@@ -583,9 +1211,17 @@ void Scheduler::Worker::spinForWork() {
   TRACE("SPIN");
   Task stolen;
 
-  constexpr auto duration = std::chrono::milliseconds(1);
   auto start = std::chrono::high_resolution_clock::now();
-  while (std::chrono::high_resolution_clock::now() - start < duration) {
+  auto reactor = scheduler_->reactor_.load(std::memory_order_acquire);
+  while (std::chrono::high_resolution_clock::now() - start < SpinDuration) {
+    // 有fiber在等待fd就绪时，顺便以非阻塞的方式检查一下是否有fd已经就绪
+    if (reactor != nullptr && reactor->hasWaiters() && reactor->tryBeginPoll()) {
+      reactor->poll(0);
+      reactor->endPoll();
+      if (work_.num > 0 || work_.inbox.load(std::memory_order_relaxed) != nullptr) {
+        return;
+      }
+    }
     for (int i = 0; i < 256; ++i) { // 256为按经验挑选的魔数
       // @formatter:off
       nop(); nop(); nop(); nop(); nop(); nop(); nop(); nop();
@@ -593,7 +1229,7 @@ void Scheduler::Worker::spinForWork() {
       nop(); nop(); nop(); nop(); nop(); nop(); nop(); nop();
       nop(); nop(); nop(); nop(); nop(); nop(); nop(); nop();
       // @formatter:on
-      if (work_.num > 0) {
+      if (work_.num > 0 || work_.inbox.load(std::memory_order_relaxed) != nullptr) {
         return;
       }
     } // end of for loop
@@ -603,6 +1239,19 @@ void Scheduler::Worker::spinForWork() {
       ++work_.num;
       return;
     }
+    // 没有可以窃取的任务时，检查一个Worker是否有因为忙碌而没能及时触发的定时任务
+    if (auto count = scheduler_->cfg_.worker_thread.count) {
+      auto victim = scheduler_->worker_threads_[rng() % count];
+      TimerState *due[MaxStolenTimers];
+      auto num_due = victim != this ? takeOverdueTimers(victim, due, MaxStolenTimers) : 0;
+      if (num_due > 0) {
+        marl::lock lock(work_.mutex);
+        enqueueTimers(due, num_due);
+        if (work_.num > 0) {
+          return;
+        }
+      }
+    }
     std::this_thread::yield();
   } // end of while loop
 }
@@ -612,6 +1261,11 @@ void Scheduler::Worker::runUntilIdle() {
   MARL_ASSERT(work_.num == work_.fibers.size() + work_.tasks.size(),
               "work.num out of sync");
   while (!work_.fibers.empty() || !work_.tasks.empty()) {
+    // 忙碌时也需要及时恢复外部线程post()的fiber，以及执行到期的定时任务
+    drainCompletions();
+    if (work_.timers) {
+      enqueueDueTimers();
+    }
     // 我们不能同时获取和存储多个fiber
     while (!work_.fibers.empty()) {
       --work_.num;
@@ -667,17 +1321,50 @@ void Scheduler::Worker::switchToFiber(Fiber *to) {
 
 //// Scheduler::Worker::Work
 Scheduler::Worker::Work::Work(Allocator *allocator)
-    : tasks(allocator), fibers(allocator), waiting(allocator) {}
+    : tasks(allocator), fibers(allocator), waiting(allocator), timers(allocator) {}
 
 template<typename F>
 void Scheduler::Worker::Work::wait(F &&f) {
-  notify_added = true;
-  if (waiting) {
-    mutex.wait_until_locked(added, waiting.next(), f);
+  wait(std::forward<F>(f), [this](TimePoint &deadline) REQUIRES(mutex) {
+    return nextDeadline(deadline);
+  });
+}
+
+template<typename F, typename D>
+void Scheduler::Worker::Work::wait(F &&f, D &&next_deadline) {
+  sleep.store(Sleep::Futex, std::memory_order_seq_cst);
+  while (true) {
+    // 必须在检查f()之前读取doorbell，在此之后的wakeup()都会使futexWait()立即返回
+    auto seq = doorbell.load(std::memory_order_seq_cst);
+    if (f()) {
+      break;
+    }
+    TimePoint timeout;
+    const TimePoint *deadline = nullptr;
+    if (next_deadline(timeout)) {
+      if (std::chrono::system_clock::now() >= timeout) {
+        break;
+      }
+      deadline = &timeout;
+    }
+    mutex.unlock();
+    futexWait(doorbell, seq, deadline);
+    mutex.lock();
+  }
+  sleep.store(Sleep::Awake, std::memory_order_relaxed);
+}
+
+bool Scheduler::Worker::Work::nextDeadline(TimePoint &deadline) const {
+  if (waiting && timers) {
+    deadline = std::min(waiting.next(), timers.next());
+  } else if (waiting) {
+    deadline = waiting.next();
+  } else if (timers) {
+    deadline = timers.next();
   } else {
-    mutex.wait_locked(added, f);
+    return false;
   }
-  notify_added = false;
+  return true;
 }
 
 //// Scheduler::Worker::Work ////
@@ -3,6 +3,7 @@
 #include "marl_test.hpp"
 
 #include "marl/defer.hpp"
+#include "marl/wait_group.hpp"
 
 class BlockingCallTestWithBound : public WithBoundScheduler {};
 
@@ -62,3 +63,98 @@ TEST_P(BlockingCallTestWithBound, ScheduleTask) {
   wg.wait();
 }
 
+
+TEST_P(BlockingCallTestWithBound, ReusesThreads) {
+  auto pool = marl::Scheduler::get()->blockingCallPool();
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(marl::blocking_call([i] { return i; }), i);
+  }
+  auto stats = pool->stats();
+  ASSERT_EQ(stats.num_calls, 100U);
+  ASSERT_EQ(stats.num_threads_created, 1U);
+  ASSERT_EQ(stats.num_queued, 0);
+}
+
+class BlockingCallTestWithoutBound : public WithoutBoundScheduler {};
+
+TEST_F(BlockingCallTestWithoutBound, NoScheduler) {
+  auto id = std::this_thread::get_id();
+  ASSERT_EQ(marl::blocking_call([] { return std::this_thread::get_id(); }), id);
+}
+
+TEST_F(BlockingCallTestWithoutBound, Backpressure) {
+  marl::Scheduler::Config cfg;
+  cfg.setAllocator(allocator_)
+      .setWorkerThreadCount(4)
+      .setBlockingCallMaxThreads(2)
+      .setBlockingCallMaxQueued(3);
+  auto scheduler = new marl::Scheduler(cfg);
+  scheduler->bind();
+  auto pool = scheduler->blockingCallPool();
+
+  std::atomic<int> running{0};
+  std::atomic<int> max_running{0};
+  marl::WaitGroup wg(100);
+  for (int i = 0; i < 100; i++) {
+    marl::schedule([&, wg] {
+      defer(wg.done());
+      marl::blocking_call([&] {
+        auto n = ++running;
+        for (auto m = max_running.load(); n > m && !max_running.compare_exchange_weak(m, n);) {}
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        --running;
+      });
+      ASSERT_LE(pool->stats().num_queued, 3);
+    });
+  }
+  wg.wait();
+
+  auto stats = pool->stats();
+  ASSERT_EQ(stats.num_calls, 100U);
+  ASSERT_LE(stats.num_threads, 2);
+  ASSERT_LE(max_running.load(), 2);
+  ASSERT_GT(stats.total_exec.count(), 0);
+  ASSERT_GE(stats.total_exec, stats.max_exec);
+  ASSERT_GE(stats.total_queue_wait, stats.max_queue_wait);
+
+  marl::Scheduler::unbind();
+  delete scheduler;
+}
+
+TEST_F(BlockingCallTestWithoutBound, IdleThreadsExit) {
+  marl::Scheduler::Config cfg;
+  cfg.setAllocator(allocator_)
+      .setBlockingCallIdleTimeout(std::chrono::milliseconds(1));
+  auto scheduler = new marl::Scheduler(cfg);
+  scheduler->bind();
+  auto pool = scheduler->blockingCallPool();
+
+  for (int round = 0; round < 3; round++) {
+    marl::blocking_call([] {});
+    while (pool->stats().num_threads > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  ASSERT_EQ(pool->stats().num_threads_created, 3U);
+
+  marl::Scheduler::unbind();
+  delete scheduler;
+}
+
+TEST_F(BlockingCallTestWithoutBound, CallDuringShutdown) {
+  // Scheduler析构时仍在队列中的任务可以调用blocking_call()，线程池在所有工作线程结束之后才被销毁
+  marl::Scheduler::Config cfg;
+  cfg.setAllocator(allocator_).setWorkerThreadCount(1);
+  auto scheduler = new marl::Scheduler(cfg);
+  scheduler->bind();
+
+  std::atomic<int> result{0};
+  marl::schedule([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    result = marl::blocking_call([] { return 42; });
+  });
+
+  marl::Scheduler::unbind();
+  delete scheduler;
+  ASSERT_EQ(result.load(), 42);
+}
@@ -0,0 +1,144 @@
+#include "marl/completion.hpp"
+
+#include "marl_test.hpp"
+
+#include "marl/defer.hpp"
+#include "marl/wait_group.hpp"
+
+#include <pthread.h>
+#include <signal.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CompletionTestWithBound : public WithBoundScheduler {};
+
+INSTANTIATE_WithBoundSchedulerTest(CompletionTestWithBound);
+
+TEST_P(CompletionTestWithBound, PostFromForeignThread) {
+  constexpr int N = 100;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<marl::Completion *> completions;
+
+  std::thread poster([&] {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&] { return completions.size() == N; });
+    for (auto completion : completions) {
+      completion->post();
+    }
+  });
+
+  marl::WaitGroup wg(N);
+  for (int i = 0; i < N; ++i) {
+    marl::schedule([&, wg] {
+      defer(wg.done());
+      marl::Completion completion;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        completions.push_back(&completion);
+        cv.notify_one();
+      }
+      completion.wait();
+    });
+  }
+  wg.wait();
+  poster.join();
+}
+
+TEST_P(CompletionTestWithBound, PostBeforeWait) {
+  marl::WaitGroup wg(1);
+  marl::schedule([wg] {
+    defer(wg.done());
+    marl::Completion completion;
+    std::thread([&] { completion.post(); }).join();
+    completion.wait();
+  });
+  wg.wait();
+}
+
+TEST_P(CompletionTestWithBound, Reuse) {
+  constexpr int N = 1000;
+  std::atomic<int> requested{-1};
+  std::atomic<marl::Completion *> shared{nullptr};
+  std::thread poster([&] {
+    for (int i = 0; i < N; ++i) {
+      while (requested.load() != i) {
+        std::this_thread::yield();
+      }
+      shared.load()->post();
+    }
+  });
+
+  marl::WaitGroup wg(1);
+  marl::schedule([&, wg] {
+    defer(wg.done());
+    marl::Completion completion;
+    shared = &completion;
+    for (int i = 0; i < N; ++i) {
+      requested = i;
+      completion.wait();
+    }
+  });
+  wg.wait();
+  poster.join();
+}
+
+TEST_P(CompletionTestWithBound, WhileWorkerBusy) {
+  // Worker一直在执行其他任务时，也需要恢复被post()的fiber
+  std::atomic<bool> resumed{false};
+  marl::WaitGroup wg(2);
+  marl::schedule([&, wg] {
+    defer(wg.done());
+    marl::Completion completion;
+    std::thread poster([&] { completion.post(); });
+    completion.wait();
+    resumed = true;
+    poster.join();
+  });
+  // 不断重新调度自己的任务，使Worker一直有任务可做
+  std::function<void()> busy = [&, wg] {
+    if (resumed) {
+      wg.done();
+    } else {
+      marl::schedule(busy);
+    }
+  };
+  marl::schedule(busy);
+  wg.wait();
+}
+
+namespace {
+
+std::atomic<marl::Completion *> signal_completion{nullptr};
+
+void onSignal(int) {
+  signal_completion.load()->post();
+}
+
+} // anonymous namespace
+
+TEST_P(CompletionTestWithBound, PostFromSignalHandler) {
+  struct sigaction action = {};
+  struct sigaction old_action = {};
+  action.sa_handler = onSignal;
+  sigemptyset(&action.sa_mask);
+  ASSERT_EQ(sigaction(SIGUSR1, &action, &old_action), 0);
+  defer(sigaction(SIGUSR1, &old_action, nullptr));
+
+  marl::WaitGroup wg(1);
+  marl::schedule([&, wg] {
+    defer(wg.done());
+    marl::Completion completion;
+    signal_completion = &completion;
+    // 在外部线程上执行信号处理函数
+    std::thread raiser([] { raise(SIGUSR1); });
+    completion.wait();
+    raiser.join();
+  });
+  wg.wait();
+}
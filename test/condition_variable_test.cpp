@@ -169,3 +169,68 @@ TEST_P(ConditionVariableTestWithBound, WaitForTimeout) {
   cv.notify_one();
   thread.join();
 }
+
+TEST_P(ConditionVariableTestWithBound, NotifyOneIsFifo) {
+  constexpr int N = 8;
+  marl::mutex mutex;
+  marl::ConditionVariable cv;
+  marl::ConditionVariable arrived;
+  int num_waiting = 0;
+  int tokens = 0;
+  std::vector<int> order;
+
+  for (int i = 0; i < N; i++) {
+    marl::schedule([&, i] {
+      marl::lock lock(mutex);
+      ++num_waiting;
+      arrived.notify_one();
+      cv.wait(lock, [&] { return tokens > 0; });
+      --tokens;
+      order.push_back(i);
+      arrived.notify_one();
+    });
+    // 等到第i个fiber进入等待队列后再调度下一个
+    marl::lock lock(mutex);
+    arrived.wait(lock, [&] { return num_waiting == i + 1; });
+  }
+
+  for (int i = 0; i < N; i++) {
+    marl::lock lock(mutex);
+    ++tokens;
+    cv.notify_one();
+    arrived.wait(lock, [&] { return static_cast<int>(order.size()) == i + 1; });
+  }
+
+  std::vector<int> expected(N);
+  for (int i = 0; i < N; i++) {
+    expected[i] = i;
+  }
+  ASSERT_EQ(order, expected);
+}
+
+TEST_P(ConditionVariableTestWithBound, NotifyAllManyFibers) {
+  constexpr int N = 1000;
+  marl::mutex mutex;
+  marl::ConditionVariable cv;
+  marl::ConditionVariable done;
+  bool signal = false;
+  int num_waiting = 0;
+  int num_woken = 0;
+
+  for (int i = 0; i < N; i++) {
+    marl::schedule([&] {
+      marl::lock lock(mutex);
+      ++num_waiting;
+      done.notify_one();
+      cv.wait(lock, [&] { return signal; });
+      ++num_woken;
+      done.notify_one();
+    });
+  }
+
+  marl::lock lock(mutex);
+  done.wait(lock, [&] { return num_waiting == N; });
+  signal = true;
+  cv.notify_all();
+  done.wait(lock, [&] { return num_woken == N; });
+}
@@ -2,6 +2,12 @@
 
 #include "marl_test.hpp"
 
+#include <atomic>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <thread>
+
 namespace {
 
 struct Data {
@@ -149,3 +155,581 @@ TEST_P(DAGTestWithBound, FanOutFanIn) {
               testing::UnorderedElementsAre("E0", "E1", "E2", "E3"));
   ASSERT_THAT(data.order[11], "F");
 }
+
+TEST_P(DAGTestWithBound, Wide) {
+  // 大量就绪的后置节点会被分批调度
+  static constexpr int N = 10000;
+  marl::DAG<std::atomic<int> &>::Builder builder;
+  auto root = builder.root();
+  auto sink = builder.node([](std::atomic<int> &count) { ASSERT_EQ(count.load(), N); });
+  for (int i = 0; i < N; ++i) {
+    auto node = root.then([](std::atomic<int> &count) { ++count; });
+    builder.addDependency(node, sink);
+  }
+  auto dag = builder.build();
+
+  std::atomic<int> count{0};
+  dag->run(count);
+  ASSERT_EQ(count.load(), N);
+}
+
+TEST_P(DAGTestWithBound, Deep) {
+  constexpr int N = 100000;
+  marl::DAG<int &>::Builder builder;
+  auto node = builder.root();
+  for (int i = 0; i < N; ++i) {
+    node = node.then([i](int &value) { ASSERT_EQ(value++, i); });
+  }
+  auto dag = builder.build();
+
+  int value = 0;
+  dag->run(value);
+  ASSERT_EQ(value, N);
+}
+
+TEST_P(DAGTestWithBound, Random) {
+  // 每个节点执行时，它的所有前置节点都必须已经执行完
+  constexpr int N = 2000;
+  std::vector<std::atomic<bool>> done(N);
+  std::vector<std::vector<int>> parents(N);
+  marl::DAG<>::Builder builder;
+  std::vector<marl::DAG<>::NodeBuilder> nodes;
+  std::mt19937 rng(1234);
+  for (int i = 0; i < N; ++i) {
+    auto node = builder.node([&, i] {
+      for (auto parent : parents[i]) {
+        ASSERT_TRUE(done[parent].load());
+      }
+      done[i] = true;
+    });
+    if (i == 0) {
+      builder.addDependency(builder.root(), node);
+    }
+    for (int j = 0; i > 0 && j < 3; ++j) {
+      auto parent = static_cast<int>(rng() % i);
+      parents[i].push_back(parent);
+      builder.addDependency(nodes[parent], node);
+    }
+    nodes.push_back(node);
+  }
+  auto dag = builder.build();
+
+  for (int run = 0; run < 3; ++run) {
+    for (auto &d : done) {
+      d = false;
+    }
+    dag->run();
+    for (auto &d : done) {
+      ASSERT_TRUE(d.load());
+    }
+  }
+}
+
+TEST_P(DAGTestWithBound, HeavyFanOut) {
+  // 开销较大的节点的后置节点会被拆分给其他Worker，结果与顺序执行时相同
+  constexpr int N = 64;
+  marl::DAG<std::atomic<int> &>::Builder builder;
+  auto node = builder.root().then([](std::atomic<int> &) {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  });
+  for (int i = 0; i < N; ++i) {
+    node.then([](std::atomic<int> &count) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      ++count;
+    });
+  }
+  auto dag = builder.build();
+
+  std::atomic<int> count{0};
+  dag->run(count);
+  ASSERT_EQ(count.load(), N);
+}
+
+TEST_P(DAGTestWithBound, CheapNodeFanOut) {
+  // 开销很小的节点的后置节点开销未知，它们会被拆分给其他Worker并行执行，而不是在同一个线程上依次执行
+  if (GetParam().num_worker_threads < 2) {
+    GTEST_SKIP() << "需要至少两个工作线程";
+  }
+  constexpr int N = 2;
+  struct State {
+    std::atomic<int> running{0};
+    std::atomic<int> maxRunning{0};
+  };
+  marl::DAG<State &>::Builder builder;
+  auto node = builder.root().then([](State &) {});
+  for (int i = 0; i < N; ++i) {
+    node.then([](State &state) {
+      auto running = ++state.running;
+      auto maxRunning = state.maxRunning.load();
+      while (running > maxRunning && !state.maxRunning.compare_exchange_weak(maxRunning, running)) {}
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      --state.running;
+    });
+  }
+  auto dag = builder.build();
+
+  State state;
+  dag->run(state);
+  ASSERT_EQ(state.maxRunning.load(), N);
+}
+
+TEST_P(DAGTestWithBound, RunAsync) {
+  constexpr int N = 8;
+  marl::DAG<Data &>::Builder builder;
+  auto root = builder.root();
+  auto a = root.then([](Data &data) { data.push("A"); });
+  auto b = root.then([](Data &data) { data.push("B"); });
+  builder.node([](Data &data) { data.push("C"); }, {a, b});
+  auto dag = builder.build();
+
+  std::vector<Data> data(N);
+  std::vector<marl::DAG<Data &>::RunHandle> handles;
+  for (auto &d : data) {
+    handles.push_back(dag->runAsync(d));
+  }
+  for (auto &handle : handles) {
+    handle.wait();
+    ASSERT_TRUE(handle.finished());
+  }
+  for (auto &d : data) {
+    ASSERT_THAT(slice(d.order, 0, 2), testing::UnorderedElementsAre("A", "B"));
+    ASSERT_EQ(d.order[2], "C");
+  }
+}
+
+TEST_P(DAGTestWithBound, RunAsyncWithoutWait) {
+  // 不等待句柄，DAG析构时会等待所有的运行结束
+  std::atomic<int> count{0};
+  {
+    marl::DAG<>::Builder builder;
+    builder.root().then([&] { ++count; }).then([&] { ++count; });
+    auto dag = builder.build();
+    for (int i = 0; i < 10; ++i) {
+      dag->runAsync();
+    }
+  }
+  ASSERT_EQ(count.load(), 20);
+}
+
+TEST_P(DAGTestWithBound, MaxInFlight) {
+  constexpr int N = 20;
+  constexpr int MaxInFlight = 2;
+  std::atomic<int> active{0};
+  std::atomic<int> maxActive{0};
+  marl::DAG<>::Builder builder;
+  builder.root()
+      .then([&] {
+        auto count = ++active;
+        auto max = maxActive.load();
+        while (count > max && !maxActive.compare_exchange_weak(max, count)) {}
+      })
+      .then([] { std::this_thread::sleep_for(std::chrono::microseconds(100)); })
+      .then([&] { --active; });
+  auto dag = builder.build();
+  dag->setMaxInFlight(MaxInFlight);
+
+  std::vector<marl::DAG<>::RunHandle> handles;
+  for (int i = 0; i < N; ++i) {
+    handles.push_back(dag->runAsync());
+  }
+  for (auto &handle : handles) {
+    handle.wait();
+  }
+  ASSERT_LE(maxActive.load(), MaxInFlight);
+}
+
+namespace {
+
+/// 统计allocate()被调用的次数
+class CountingAllocator : public marl::Allocator {
+ public:
+  marl::Allocation allocate(const marl::Allocation::Request &request) override {
+    ++count;
+    return marl::Allocator::Default->allocate(request);
+  }
+
+  void free(const marl::Allocation &allocation) override {
+    marl::Allocator::Default->free(allocation);
+  }
+
+  std::atomic<int> count{0};
+};
+
+} // anonymous namespace
+
+TEST_P(DAGTestWithBound, ReuseRunContexts) {
+  // 第一次运行之后，RunContext会被复用，不再分配内存
+  CountingAllocator allocator;
+  marl::DAG<std::atomic<int> &>::Builder builder;
+  auto root = builder.root();
+  auto sink = builder.node([](std::atomic<int> &) {});
+  for (int i = 0; i < 100; ++i) {
+    builder.addDependency(root.then([](std::atomic<int> &count) { ++count; }), sink);
+  }
+  auto dag = builder.build();
+
+  std::atomic<int> count{0};
+  dag->run(count, &allocator);
+  auto allocations = allocator.count.load();
+  ASSERT_GT(allocations, 0);
+  for (int i = 0; i < 10; ++i) {
+    dag->run(count, &allocator);
+    dag->runAsync(count, &allocator).wait();
+  }
+  ASSERT_EQ(allocator.count.load(), allocations);
+  ASSERT_EQ(count.load(), 2100);
+}
+
+TEST_P(DAGTestWithBound, CriticalPathFirst) {
+  // 单线程时，就绪的节点中优先级（到终点的最长路径）最高的节点先执行，与添加的顺序无关
+  if (GetParam().num_worker_threads > 0) {
+    GTEST_SKIP() << "多个线程时执行顺序不确定";
+  }
+  for (bool chainFirst : {true, false}) {
+    marl::DAG<Data &>::Builder builder;
+    auto root = builder.root();
+    auto addChain = [&] {
+      root.then([](Data &data) { data.push("B0"); })
+          .then([](Data &data) { data.push("B1"); })
+          .then([](Data &data) { data.push("B2"); });
+    };
+    if (chainFirst) {
+      addChain();
+    }
+    root.then([](Data &data) { data.push("A"); });
+    if (!chainFirst) {
+      addChain();
+    }
+    auto dag = builder.build();
+
+    Data data;
+    dag->run(data);
+    ASSERT_THAT(data.order, testing::ElementsAre("B0", "B1", "B2", "A"));
+  }
+}
+
+TEST_P(DAGTestWithBound, MeasuredPriorities) {
+  // 以节点数计算时链更长，以测得的执行时间计算时单个的慢节点路径更长
+  if (GetParam().num_worker_threads > 0) {
+    GTEST_SKIP() << "多个线程时执行顺序不确定";
+  }
+  marl::DAG<Data &>::Builder builder;
+  auto root = builder.root();
+  root.then([](Data &data) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    data.push("X");
+  });
+  root.then([](Data &data) { data.push("Y0"); }).then([](Data &data) { data.push("Y1"); });
+  auto dag = builder.build();
+
+  Data before;
+  dag->setMeasureCosts(true);
+  dag->run(before);
+  ASSERT_THAT(before.order, testing::ElementsAre("Y0", "Y1", "X"));
+
+  dag->setMeasureCosts(false);
+  dag->updatePriorities();
+  Data after;
+  dag->run(after);
+  ASSERT_THAT(after.order, testing::ElementsAre("X", "Y0", "Y1"));
+}
+
+TEST_P(DAGTestWithBound, IncrementalRun) {
+  marl::DAG<Data &>::Builder builder;
+  auto root = builder.root();
+  auto a = root.then([](Data &data) { data.push("A"); });
+  auto b = a.then([](Data &data) { data.push("B"); });
+  auto c = a.then([](Data &data) { data.push("C"); });
+  builder.node([](Data &data) { data.push("D"); }, {b, c});
+  root.then([](Data &data) { data.push("X"); });
+  auto dag = builder.build();
+  dag->setIncremental(true);
+
+  // 第一次运行执行整个DAG
+  Data all;
+  dag->run(all);
+  ASSERT_THAT(all.order, testing::UnorderedElementsAre("A", "B", "C", "D", "X"));
+
+  // 没有被标记的节点，什么都不执行
+  Data none;
+  dag->run(none);
+  ASSERT_TRUE(none.order.empty());
+
+  // D有两个前置节点，但是只需要等待受影响的B
+  Data partial;
+  dag->markDirty(b);
+  dag->run(partial);
+  ASSERT_THAT(partial.order, testing::ElementsAre("B", "D"));
+
+  Data subtree;
+  dag->markDirty(c);
+  dag->markDirty(a);
+  dag->run(subtree);
+  ASSERT_THAT(subtree.order, testing::UnorderedElementsAre("A", "B", "C", "D"));
+  ASSERT_EQ(subtree.order[0], "A");
+  ASSERT_EQ(subtree.order[3], "D");
+
+  Data rootDirty;
+  dag->markDirty(root);
+  dag->run(rootDirty);
+  ASSERT_THAT(rootDirty.order, testing::UnorderedElementsAre("A", "B", "C", "D", "X"));
+}
+
+TEST_P(DAGTestWithBound, IncrementalRandom) {
+  // 每个节点记录自己被执行的次数，并检查受影响的前置节点都已经执行完
+  constexpr int N = 2000;
+  constexpr int Rounds = 20;
+  std::mt19937 rng(42);
+  std::vector<std::vector<int>> ins(N);
+  std::vector<std::vector<int>> outs(N);
+  std::vector<std::atomic<int>> runs(N);
+  std::atomic<int> violations{0};
+  std::vector<int> expected(N, 0);
+
+  marl::DAG<>::Builder builder;
+  std::vector<marl::DAG<>::NodeBuilder> nodes;
+  for (int i = 0; i < N; ++i) {
+    nodes.push_back(builder.node([&, i] {
+      for (auto in : ins[i]) {
+        if (runs[in].load() < expected[in]) {
+          ++violations;
+        }
+      }
+      ++runs[i];
+    }));
+    if (i == 0) {
+      builder.addDependency(builder.root(), nodes[i]);
+      continue;
+    }
+    auto numIns = 1 + static_cast<int>(rng() % 3);
+    for (int j = 0; j < numIns; ++j) {
+      auto parent = static_cast<int>(rng() % i);
+      builder.addDependency(nodes[parent], nodes[i]);
+      ins[i].push_back(parent);
+      outs[parent].push_back(i);
+    }
+  }
+  auto dag = builder.build();
+  dag->setIncremental(true);
+  dag->run();
+  std::fill(expected.begin(), expected.end(), 1);
+
+  for (int round = 0; round < Rounds; ++round) {
+    // 求出被标记的节点及其所有后置节点
+    std::vector<bool> affected(N, false);
+    std::vector<int> stack;
+    auto numDirty = 1 + static_cast<int>(rng() % 4);
+    for (int i = 0; i < numDirty; ++i) {
+      auto idx = static_cast<int>(rng() % N);
+      dag->markDirty(nodes[idx]);
+      stack.push_back(idx);
+    }
+    while (!stack.empty()) {
+      auto idx = stack.back();
+      stack.pop_back();
+      if (!affected[idx]) {
+        affected[idx] = true;
+        stack.insert(stack.end(), outs[idx].begin(), outs[idx].end());
+      }
+    }
+    for (int i = 0; i < N; ++i) {
+      if (affected[i]) {
+        ++expected[i];
+      }
+    }
+    dag->run();
+    for (int i = 0; i < N; ++i) {
+      ASSERT_EQ(runs[i].load(), expected[i]) << "node " << i << " round " << round;
+    }
+  }
+  ASSERT_EQ(violations.load(), 0);
+}
+
+TEST_P(DAGTestWithBound, DynamicSpawn) {
+  constexpr int N = 100;
+  std::atomic<int> count{0};
+  int seen = -1;
+  marl::DAG<>::Builder builder;
+  builder.root()
+      .thenDynamic([&](marl::DAG<>::Spawner spawner) {
+        for (int i = 0; i < N; ++i) {
+          spawner.spawn([&] {
+            std::this_thread::sleep_for(std::chrono::microseconds(10));
+            ++count;
+          });
+        }
+      })
+      .then([&] { seen = count.load(); });
+  auto dag = builder.build();
+  dag->run();
+  ASSERT_EQ(seen, N);
+}
+
+TEST_P(DAGTestWithBound, DynamicSpawnRange) {
+  constexpr size_t N = 1000;
+  std::vector<std::atomic<int>> hits(N);
+  bool allHit = false;
+  marl::DAG<>::Builder builder;
+  auto root = builder.root();
+  // 没有派生任何子任务的动态节点
+  auto empty = root.thenDynamic([](marl::DAG<>::Spawner) {});
+  auto fanOut = root.thenDynamic([&](marl::DAG<>::Spawner spawner) {
+    spawner.spawn(N, [&](size_t i) { ++hits[i]; });
+  });
+  builder.node([&] {
+    allHit = std::all_of(hits.begin(), hits.end(), [](auto &hit) { return hit.load() == 1; });
+  }, {empty, fanOut});
+  auto dag = builder.build();
+  dag->run();
+  ASSERT_TRUE(allHit);
+}
+
+namespace {
+
+void fanOut(marl::DAG<>::Spawner spawner, int depth, std::atomic<int> &leaves) {
+  if (depth == 0) {
+    ++leaves;
+    return;
+  }
+  for (int i = 0; i < 2; ++i) {
+    spawner.spawn([spawner, depth, &leaves] { fanOut(spawner, depth - 1, leaves); });
+  }
+}
+
+} // anonymous namespace
+
+TEST_P(DAGTestWithBound, DynamicRecursive) {
+  constexpr int Depth = 10;
+  std::atomic<int> leaves{0};
+  std::vector<int> seen;
+  marl::DAG<>::Builder builder;
+  builder.root()
+      .thenDynamic([&](marl::DAG<>::Spawner spawner) { fanOut(spawner, Depth, leaves); })
+      .then([&] { seen.push_back(leaves.load()); });
+  auto dag = builder.build();
+  for (int i = 1; i <= 3; ++i) {
+    dag->run();
+    ASSERT_EQ(leaves.load(), i << Depth);
+  }
+  ASSERT_THAT(seen, testing::ElementsAre(1 << Depth, 2 << Depth, 3 << Depth));
+}
+
+TEST_P(DAGTestWithBound, DynamicSubDAG) {
+  marl::DAG<Data &>::Builder childBuilder;
+  auto childRoot = childBuilder.root();
+  auto c0 = childRoot.then([](Data &data) { data.push("C0"); });
+  auto c1 = childRoot.then([](Data &data) { data.push("C1"); });
+  childBuilder.node([](Data &data) { data.push("C2"); }, {c0, c1});
+  auto child = childBuilder.build();
+
+  marl::DAG<Data &>::Builder builder;
+  builder.root()
+      .then([](Data &data) { data.push("A"); })
+      .thenDynamic([&](Data &data, marl::DAG<Data &>::Spawner spawner) {
+        data.push("B");
+        spawner.run(*child);
+        spawner.run(*child);
+      })
+      .then([](Data &data) { data.push("D"); });
+  auto dag = builder.build();
+
+  for (int i = 0; i < 3; ++i) {
+    Data data;
+    dag->runAsync(data).wait();
+    ASSERT_EQ(data.order.size(), 9u);
+    ASSERT_EQ(data.order[0], "A");
+    ASSERT_EQ(data.order[1], "B");
+    ASSERT_THAT(slice(data.order, 2, 8),
+                testing::UnorderedElementsAre("C0", "C0", "C1", "C1", "C2", "C2"));
+    ASSERT_EQ(data.order[8], "D");
+  }
+}
+
+TEST_P(DAGTestWithBound, ParallelNode) {
+  constexpr size_t N = 10007;
+  constexpr size_t Grain = 100;
+  std::vector<int> values(N, 0);
+  std::atomic<size_t> numChunks{0};
+  std::atomic<bool> badChunk{false};
+  int64_t sum = -1;
+  marl::DAG<std::vector<int> &>::Builder builder;
+  builder.root()
+      .thenParallel(N, Grain, [&](std::vector<int> &data, size_t begin, size_t end) {
+        if (begin % Grain != 0 || end - begin > Grain || end > N) {
+          badChunk = true;
+        }
+        for (auto i = begin; i < end; ++i) {
+          data[i] += static_cast<int>(i);
+        }
+        ++numChunks;
+      })
+      .then([&](std::vector<int> &data) { sum = std::accumulate(data.begin(), data.end(), 0ll); });
+  auto dag = builder.build();
+  dag->run(values);
+  ASSERT_FALSE(badChunk.load());
+  ASSERT_EQ(numChunks.load(), (N + Grain - 1) / Grain);
+  ASSERT_EQ(sum, static_cast<int64_t>(N * (N - 1) / 2));
+}
+
+TEST_P(DAGTestWithBound, ParallelNodeEdgeCases) {
+  std::atomic<int> calls{0};
+  bool done = false;
+  marl::DAG<>::Builder builder;
+  auto root = builder.root();
+  // 空的范围不执行任何块，单个块在当前线程上执行
+  auto empty = builder.parallelNode(0, 16, [&](size_t, size_t) { ++calls; }, {root});
+  auto single = builder.parallelNode(10, 16, [&](size_t begin, size_t end) {
+    if (begin == 0 && end == 10) {
+      ++calls;
+    }
+  }, {root});
+  builder.node([&] { done = calls.load() == 1; }, {empty, single});
+  auto dag = builder.build();
+  dag->run();
+  ASSERT_TRUE(done);
+}
+
+TEST_P(DAGTestWithBound, Profiling) {
+  constexpr int Runs = 10;
+  marl::DAG<>::Builder builder;
+  auto root = builder.root();
+  auto slow = root.then([] { std::this_thread::sleep_for(std::chrono::microseconds(200)); });
+  auto after = slow.then([] {});
+  auto fast = root.then([] {});
+  auto dag = builder.build();
+
+  // 未开启profiling时没有任何记录
+  dag->run();
+  ASSERT_EQ(dag->nodeStats(slow).count, 0u);
+  std::stringstream empty;
+  dag->writeTrace(empty);
+  ASSERT_EQ(empty.str().find("\"ph\":\"X\""), std::string::npos);
+
+  dag->setProfiling(true);
+  for (int i = 0; i < Runs; ++i) {
+    dag->run();
+  }
+  auto slowStats = dag->nodeStats(slow);
+  ASSERT_EQ(slowStats.count, static_cast<uint64_t>(Runs));
+  ASSERT_GE(slowStats.duration.p50, std::chrono::microseconds(150));
+  ASSERT_GE(slowStats.duration.max, slowStats.duration.p50);
+  ASSERT_EQ(dag->nodeStats(after).count, static_cast<uint64_t>(Runs));
+  ASSERT_LT(dag->nodeStats(after).duration.p50, slowStats.duration.p50);
+  ASSERT_EQ(dag->nodeStats(fast).count, static_cast<uint64_t>(Runs));
+
+  std::stringstream trace;
+  dag->writeTrace(trace);
+  auto json = trace.str();
+  ASSERT_EQ(json.rfind("{\"traceEvents\":[", 0), 0u);
+  size_t numEvents = 0;
+  for (auto pos = json.find("\"ph\":\"X\""); pos != std::string::npos;
+       pos = json.find("\"ph\":\"X\"", pos + 1)) {
+    ++numEvents;
+  }
+  ASSERT_EQ(numEvents, 3u);
+
+  // 关闭之后统计数据不再增加
+  dag->setProfiling(false);
+  dag->run();
+  ASSERT_EQ(dag->nodeStats(slow).count, static_cast<uint64_t>(Runs));
+}
@@ -188,3 +188,162 @@ TEST_P(EventTestWithBound, Any) {
   }
 }
 
+
+class EventTestWithoutBound : public WithoutBoundScheduler {};
+
+TEST_F(EventTestWithoutBound, InlineNoAllocation) {
+  marl::InlineEvent event(marl::Event::Mode::Manual, false, allocator_);
+  marl::InlineEvent done(marl::Event::Mode::Auto, false, allocator_);
+  std::thread thread([e = event.ref(), d = done.ref()] {
+    e.wait();
+    d.signal();
+  });
+  EXPECT_FALSE(event.isSignalled());
+  event.signal();
+  done.wait();
+  thread.join();
+  EXPECT_TRUE(event.test());
+  EXPECT_FALSE(done.test());
+  EXPECT_EQ(allocator_->stats().numAllocations(), 0U);
+}
+
+TEST_P(EventTestWithBound, InlineAutoWait) {
+  std::atomic<int> counter{0};
+  marl::InlineEvent event(marl::Event::Mode::Auto);
+  marl::InlineEvent done(marl::Event::Mode::Auto);
+
+  for (int i = 0; i < 3; ++i) {
+    marl::schedule([e = event.ref(), d = done.ref(), &counter] {
+      e.wait();
+      ++counter;
+      d.signal();
+    });
+  }
+
+  EXPECT_EQ(counter.load(), 0);
+  for (int i = 1; i <= 3; ++i) {
+    event.signal();
+    done.wait();
+    EXPECT_EQ(counter.load(), i);
+  }
+}
+
+TEST_P(EventTestWithBound, InlineWaitForTimeout) {
+  marl::InlineEvent event(marl::Event::Mode::Manual);
+  marl::InlineWaitGroup wg(100);
+  for (int i = 0; i < 100; i++) {
+    marl::schedule([e = event.ref(), w = wg.ref()] {
+      defer(w.done());
+      EXPECT_FALSE(e.wait_for(10ms));
+    });
+  }
+  wg.wait();
+}
+
+TEST_P(EventTestWithBound, PingPong) {
+  // signal()在没有等待者时不加锁，交替等待可以检查是否会丢失唤醒
+  auto ping = marl::Event(marl::Event::Mode::Auto);
+  auto pong = marl::Event(marl::Event::Mode::Auto);
+  auto wg = marl::WaitGroup(1);
+  marl::schedule([=] {
+    for (int i = 0; i < 1000; ++i) {
+      ping.wait();
+      pong.signal();
+    }
+    wg.done();
+  });
+  for (int i = 0; i < 1000; ++i) {
+    ping.signal();
+    pong.wait();
+  }
+  wg.wait();
+  EXPECT_FALSE(ping.isSignalled());
+  EXPECT_FALSE(pong.isSignalled());
+}
+
+TEST_P(EventTestWithBound, AnyAfterSignal) {
+  auto event = marl::Event(marl::Event::Mode::Manual);
+  event.signal();
+  std::array<marl::Event, 1> events = {event};
+  auto any = marl::Event::any(events.begin(), events.end());
+  ASSERT_TRUE(any.isSignalled());
+}
+
+TEST_P(EventTestWithBound, AnyAfterDepsDestroyed) {
+  auto event = marl::Event(marl::Event::Mode::Auto);
+  std::array<marl::Event, 1> events = {event};
+  marl::Event::any(events.begin(), events.end());
+  // 依赖已经被销毁，signal()会清空依赖列表
+  event.signal();
+  EXPECT_TRUE(event.test());
+  auto any = marl::Event::any(events.begin(), events.end());
+  event.signal();
+  ASSERT_TRUE(any.isSignalled());
+}
+
+TEST_P(EventTestWithBound, WaitAny) {
+  for (int i = 0; i < 3; i++) {
+    auto a = marl::Event(marl::Event::Mode::Auto);
+    auto b = marl::Event(marl::Event::Mode::Manual);
+    marl::InlineEvent c(marl::Event::Mode::Auto);
+    marl::schedule([=, &c] {
+      switch (i) {
+        case 0: a.signal(); break;
+        case 1: b.signal(); break;
+        default: c.signal(); break;
+      }
+    });
+    EXPECT_EQ(marl::Event::wait_any(a, b, c), i);
+    // Auto模式的event被选中后信号会被重置，Manual模式的保持不变
+    EXPECT_FALSE(a.isSignalled());
+    EXPECT_EQ(b.isSignalled(), i == 1);
+    EXPECT_FALSE(c.isSignalled());
+  }
+}
+
+TEST_P(EventTestWithBound, WaitAnyTimeout) {
+  auto a = marl::Event(marl::Event::Mode::Auto);
+  auto b = marl::Event(marl::Event::Mode::Auto);
+  EXPECT_EQ(marl::Event::wait_any_for(10ms, a, b), -1);
+  b.signal();
+  EXPECT_EQ(marl::Event::wait_any_for(10ms, a, b), 1);
+  EXPECT_FALSE(b.isSignalled());
+}
+
+TEST_P(EventTestWithBound, WaitAnyPingPong) {
+  auto a = marl::Event(marl::Event::Mode::Auto);
+  auto b = marl::Event(marl::Event::Mode::Auto);
+  auto ack = marl::Event(marl::Event::Mode::Auto);
+  auto wg = marl::WaitGroup(1);
+  marl::schedule([=] {
+    for (int i = 0; i < 1000; ++i) {
+      (i % 2 == 0 ? a : b).signal();
+      ack.wait();
+    }
+    wg.done();
+  });
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(marl::Event::wait_any(a, b), i % 2);
+    ack.signal();
+  }
+  wg.wait();
+  EXPECT_FALSE(a.isSignalled());
+  EXPECT_FALSE(b.isSignalled());
+}
+
+TEST_F(EventTestWithoutBound, AnyDoesNotLeak) {
+  auto event = marl::Event(marl::Event::Mode::Auto, false, allocator_);
+  std::array<marl::Event, 1> events = {event};
+  marl::Event::any(events.begin(), events.end());
+  marl::Event::any(events.begin(), events.end());
+  auto bytes = allocator_->stats().bytesAllocated();
+  for (int i = 0; i < 100; i++) {
+    // 已经被销毁的any event会在下一次调用any()时从依赖列表中清理
+    marl::Event::any(events.begin(), events.end());
+  }
+  EXPECT_EQ(allocator_->stats().bytesAllocated(), bytes);
+  // wait_any()超时返回之后不会在event上留下等待者，之后的signal()仍然能被wait_any()观察到
+  EXPECT_EQ(marl::Event::wait_any_for(1ms, event), -1);
+  event.signal();
+  EXPECT_EQ(marl::Event::wait_any(event), 0);
+}
@@ -0,0 +1,159 @@
+#include "marl/file_scan.hpp"
+
+#include "marl_test.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+/// 写入了content的临时文件，析构时删除
+class TempFile {
+ public:
+  explicit TempFile(const std::string &content) {
+    char path[] = "/tmp/marl_file_scan_test_XXXXXX";
+    fd_ = mkstemp(path);
+    EXPECT_GE(fd_, 0);
+    path_ = path;
+    EXPECT_EQ(write(fd_, content.data(), content.size()), static_cast<ssize_t>(content.size()));
+  }
+  ~TempFile() {
+    close(fd_);
+    unlink(path_.c_str());
+  }
+
+  [[nodiscard]] const char *path() const { return path_.c_str(); }
+
+ private:
+  int fd_;
+  std::string path_;
+};
+
+/// 长度不等的numbered行
+std::vector<std::string> makeLines(int n) {
+  std::vector<std::string> lines;
+  for (int i = 0; i < n; ++i) {
+    lines.push_back("line " + std::to_string(i) + std::string(static_cast<size_t>(i % 13), 'x'));
+  }
+  return lines;
+}
+
+std::string join(const std::vector<std::string> &lines, bool trailing_delimiter) {
+  std::string content;
+  for (size_t i = 0; i < lines.size(); ++i) {
+    content += lines[i];
+    if (i + 1 < lines.size() || trailing_delimiter) {
+      content += '\n';
+    }
+  }
+  return content;
+}
+
+/// 用scanFile()读出所有的行，同时检查块的边界
+std::vector<std::string> scanLines(const char *path, const marl::FileScanOptions &options, int *res) {
+  std::vector<std::string> lines;
+  size_t next_index = 0;
+  size_t next_offset = 0;
+  *res = marl::scanFile(path, [](const marl::FileChunk &chunk) {
+    std::vector<std::string> chunk_lines;
+    chunk.forEachRecord([&](std::string_view line) { chunk_lines.emplace_back(line); });
+    return std::make_pair(chunk, chunk_lines);
+  }, [&](std::pair<marl::FileChunk, std::vector<std::string>> &&result) {
+    auto &chunk = result.first;
+    if (options.order == marl::PipelineOrder::Ordered) {
+      EXPECT_EQ(chunk.index, next_index++);
+      EXPECT_EQ(chunk.offset, next_offset);
+      next_offset += chunk.size;
+    }
+    lines.insert(lines.end(), result.second.begin(), result.second.end());
+  }, options);
+  return lines;
+}
+
+} // anonymous namespace
+
+class FileScanTestWithBound : public WithBoundScheduler {};
+INSTANTIATE_WithBoundSchedulerTest(FileScanTestWithBound);
+
+TEST_P(FileScanTestWithBound, Ordered) {
+  auto lines = makeLines(5000);
+  for (bool trailing : {true, false}) {
+    TempFile file(join(lines, trailing));
+    for (size_t chunk_size : {1, 7, 100, 4096, 1 << 20}) {
+      marl::FileScanOptions options;
+      options.chunk_size = chunk_size;
+      int res = -1;
+      auto out = scanLines(file.path(), options, &res);
+      ASSERT_EQ(res, 0);
+      ASSERT_EQ(out, lines) << "chunk_size " << chunk_size << " trailing " << trailing;
+    }
+  }
+}
+
+TEST_P(FileScanTestWithBound, Unordered) {
+  auto lines = makeLines(5000);
+  TempFile file(join(lines, true));
+  marl::FileScanOptions options;
+  options.chunk_size = 512;
+  options.order = marl::PipelineOrder::Unordered;
+  options.max_chunks = 3;
+  int res = -1;
+  auto out = scanLines(file.path(), options, &res);
+  ASSERT_EQ(res, 0);
+  std::sort(out.begin(), out.end());
+  std::sort(lines.begin(), lines.end());
+  ASSERT_EQ(out, lines);
+}
+
+TEST_P(FileScanTestWithBound, ChunksEndWithDelimiter) {
+  auto lines = makeLines(1000);
+  TempFile file(join(lines, true));
+  marl::MappedFile mapped;
+  ASSERT_EQ(mapped.open(file.path()), 0);
+  marl::FileScanOptions options;
+  options.chunk_size = 100;
+  options.delimiter = '\n';
+  size_t total = 0;
+  marl::scanFile(mapped, [](const marl::FileChunk &chunk) {
+    EXPECT_GT(chunk.size, 0u);
+    EXPECT_EQ(chunk.data[chunk.size - 1], '\n');
+    return chunk.size;
+  }, [&](size_t size) { total += size; }, options);
+  ASSERT_EQ(total, mapped.size());
+}
+
+TEST_P(FileScanTestWithBound, CustomDelimiter) {
+  TempFile file("a,bb,,ccc,");
+  marl::FileScanOptions options;
+  options.chunk_size = 2;
+  options.delimiter = ',';
+  std::vector<std::string> records;
+  ASSERT_EQ(marl::scanFile(file.path(), [](const marl::FileChunk &chunk) {
+    std::vector<std::string> out;
+    chunk.forEachRecord([&](std::string_view record) { out.emplace_back(record); });
+    return out;
+  }, [&](std::vector<std::string> &&out) {
+    records.insert(records.end(), out.begin(), out.end());
+  }, options), 0);
+  ASSERT_EQ(records, (std::vector<std::string>{"a", "bb", "", "ccc"}));
+}
+
+TEST_P(FileScanTestWithBound, EmptyFile) {
+  TempFile file("");
+  int calls = 0;
+  ASSERT_EQ(marl::scanFile(file.path(), [&](const marl::FileChunk &) { return 0; },
+                           [&](int) { ++calls; }), 0);
+  ASSERT_EQ(calls, 0);
+}
+
+TEST_P(FileScanTestWithBound, MissingFile) {
+  auto res = marl::scanFile("/nonexistent/marl_file_scan_test", [](const marl::FileChunk &) { return 0; },
+                            [](int) {});
+  ASSERT_EQ(res, -ENOENT);
+}
@@ -0,0 +1,214 @@
+#include "marl/io.hpp"
+
+#include "marl_test.hpp"
+
+#include "marl/defer.hpp"
+#include "marl/scheduler.hpp"
+#include "marl/wait_group.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+/// 测试用的临时文件，析构时删除
+class TempFile {
+ public:
+  TempFile() {
+    char path[] = "/tmp/marl_io_test_XXXXXX";
+    fd_ = mkstemp(path);
+    EXPECT_GE(fd_, 0);
+    unlink(path);
+  }
+  ~TempFile() { close(fd_); }
+
+  [[nodiscard]] int fd() const { return fd_; }
+
+ private:
+  int fd_;
+};
+
+std::vector<char> pattern(size_t size, int seed) {
+  std::vector<char> data(size);
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<char>((i * 31 + seed) & 0xff);
+  }
+  return data;
+}
+
+} // anonymous namespace
+
+class IoTestWithBound : public WithBoundScheduler {};
+
+INSTANTIATE_WithBoundSchedulerTest(IoTestWithBound);
+
+TEST_P(IoTestWithBound, ReadWrite) {
+  TempFile file;
+  auto data = pattern(64 * 1024, 1);
+  ASSERT_EQ(marl::io::write(file.fd(), data.data(), data.size(), 0),
+            static_cast<ssize_t>(data.size()));
+  ASSERT_EQ(marl::io::fsync(file.fd()), 0);
+  ASSERT_EQ(marl::io::fdatasync(file.fd()), 0);
+
+  std::vector<char> out(data.size());
+  ASSERT_EQ(marl::io::read(file.fd(), out.data(), out.size(), 0),
+            static_cast<ssize_t>(out.size()));
+  ASSERT_EQ(out, data);
+}
+
+TEST_P(IoTestWithBound, Vectored) {
+  TempFile file;
+  auto a = pattern(100, 2);
+  auto b = pattern(200, 3);
+  iovec out[] = {{a.data(), a.size()}, {b.data(), b.size()}};
+  ASSERT_EQ(marl::io::writev(file.fd(), out, 2, 10), 300);
+
+  std::vector<char> c(100), d(200);
+  iovec in[] = {{c.data(), c.size()}, {d.data(), d.size()}};
+  ASSERT_EQ(marl::io::readv(file.fd(), in, 2, 10), 300);
+  ASSERT_EQ(c, a);
+  ASSERT_EQ(d, b);
+}
+
+TEST_P(IoTestWithBound, Batch) {
+  constexpr int N = 600;  // 超过提交队列的大小，需要分多次提交
+  constexpr size_t BlockSize = 512;
+  TempFile file;
+  auto data = pattern(N * BlockSize, 4);
+
+  std::vector<marl::io::Request> requests;
+  for (int i = 0; i < N; ++i) {
+    requests.push_back(marl::io::Request::write(
+        file.fd(), data.data() + i * BlockSize, BlockSize, i * BlockSize));
+  }
+  marl::io::submit(requests.data(), requests.size());
+  for (auto &request : requests) {
+    ASSERT_EQ(request.result, static_cast<ssize_t>(BlockSize));
+  }
+
+  std::vector<char> out(data.size());
+  requests.clear();
+  for (int i = 0; i < N; ++i) {
+    requests.push_back(marl::io::Request::read(
+        file.fd(), out.data() + i * BlockSize, BlockSize, i * BlockSize));
+  }
+  requests.push_back(marl::io::Request::fsync(file.fd()));
+  marl::io::submit(requests.data(), requests.size());
+  for (int i = 0; i < N; ++i) {
+    ASSERT_EQ(requests[i].result, static_cast<ssize_t>(BlockSize));
+  }
+  ASSERT_EQ(requests.back().result, 0);
+  ASSERT_EQ(out, data);
+}
+
+TEST_P(IoTestWithBound, ConcurrentFibers) {
+  constexpr int N = 256;
+  constexpr size_t BlockSize = 4096;
+  TempFile file;
+  auto data = pattern(N * BlockSize, 5);
+  ASSERT_EQ(marl::io::write(file.fd(), data.data(), data.size(), 0),
+            static_cast<ssize_t>(data.size()));
+
+  std::vector<char> out(data.size());
+  marl::WaitGroup wg(N);
+  for (int i = 0; i < N; ++i) {
+    marl::schedule([&, i, wg] {
+      defer(wg.done());
+      auto res = marl::io::read(file.fd(), out.data() + i * BlockSize, BlockSize, i * BlockSize);
+      EXPECT_EQ(res, static_cast<ssize_t>(BlockSize));
+    });
+  }
+  wg.wait();
+  ASSERT_EQ(out, data);
+}
+
+TEST_P(IoTestWithBound, RegisteredBuffers) {
+  TempFile file;
+  auto ring = marl::Scheduler::get()->ioRing();
+  auto buffer = pattern(8192, 6);
+  auto expected = buffer;
+  iovec iov = {buffer.data(), buffer.size()};
+  auto res = ring->registerBuffers(&iov, 1);
+  if (res == -ENOMEM || res == -EPERM) {
+    GTEST_SKIP() << "没有注册缓冲区的权限";
+  }
+  ASSERT_EQ(res, 0);
+  defer(ring->unregisterBuffers());
+
+  auto write = marl::io::Request::writeFixed(file.fd(), buffer.data(), buffer.size(), 0, 0);
+  ring->submit(&write, 1);
+  ASSERT_EQ(write.result, static_cast<ssize_t>(buffer.size()));
+
+  std::fill(buffer.begin(), buffer.end(), 0);
+  auto read = marl::io::Request::readFixed(file.fd(), buffer.data() + 4096, 4096, 4096, 0);
+  ring->submit(&read, 1);
+  ASSERT_EQ(read.result, 4096);
+  ASSERT_TRUE(std::equal(buffer.begin() + 4096, buffer.end(), expected.begin() + 4096));
+}
+
+TEST_P(IoTestWithBound, Error) {
+  char c;
+  ASSERT_EQ(marl::io::read(-1, &c, 1, 0), -EBADF);
+  ASSERT_EQ(marl::io::fsync(-1), -EBADF);
+}
+
+TEST_P(IoTestWithBound, LengthTooLong) {
+  // SQE无法表示的长度被拒绝，不能被截断为短读，同一批中的其他请求不受影响
+  TempFile file;
+  auto data = pattern(4096, 9);
+  ASSERT_EQ(marl::io::write(file.fd(), data.data(), data.size(), 0), 4096);
+  std::vector<char> out(data.size());
+  marl::io::Request requests[] = {
+      marl::io::Request::read(file.fd(), out.data(), (size_t(1) << 32) + 16, 0),
+      marl::io::Request::read(file.fd(), out.data(), out.size(), 0),
+  };
+  marl::io::submit(requests, 2);
+  ASSERT_EQ(requests[0].result, -EINVAL);
+  ASSERT_EQ(requests[1].result, 4096);
+  ASSERT_EQ(out, data);
+}
+
+class IoTestWithoutBound : public WithoutBoundScheduler {};
+
+TEST_F(IoTestWithoutBound, NoScheduler) {
+  TempFile file;
+  auto data = pattern(1000, 7);
+  ASSERT_EQ(marl::io::write(file.fd(), data.data(), data.size(), 0), 1000);
+  std::vector<char> out(data.size());
+  ASSERT_EQ(marl::io::read(file.fd(), out.data(), out.size(), 0), 1000);
+  ASSERT_EQ(out, data);
+}
+
+TEST_F(IoTestWithoutBound, Fallback) {
+  auto scheduler = new marl::Scheduler(marl::Scheduler::Config()
+                                           .setAllocator(allocator_)
+                                           .setWorkerThreadCount(2)
+                                           .setUseIoUring(false));
+  scheduler->bind();
+  ASSERT_FALSE(scheduler->ioRing()->usingIoUring());
+  {
+    TempFile file;
+    auto data = pattern(4096, 8);
+    marl::WaitGroup wg(1);
+    marl::schedule([&, wg] {
+      defer(wg.done());
+      EXPECT_EQ(marl::io::write(file.fd(), data.data(), data.size(), 0), 4096);
+      std::vector<char> out(data.size());
+      marl::io::Request requests[] = {
+          marl::io::Request::read(file.fd(), out.data(), 2048, 0),
+          marl::io::Request::read(file.fd(), out.data() + 2048, 2048, 2048),
+      };
+      marl::io::submit(requests, 2);
+      EXPECT_EQ(requests[0].result, 2048);
+      EXPECT_EQ(requests[1].result, 2048);
+      EXPECT_EQ(out, data);
+    });
+    wg.wait();
+  }
+  marl::Scheduler::unbind();
+  delete scheduler;
+}
@@ -0,0 +1,84 @@
+#include "marl/parallel_for.hpp"
+
+#include "marl_test.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+class ParallelForTestWithBound : public WithBoundScheduler {};
+INSTANTIATE_WithBoundSchedulerTest(ParallelForTestWithBound);
+
+TEST_P(ParallelForTestWithBound, EachIndexOnce) {
+  constexpr size_t N = 100000;
+  std::vector<std::atomic<int>> hits(N);
+  marl::parallel_for(0, N, [&](size_t i) { ++hits[i]; });
+  for (size_t i = 0; i < N; ++i) {
+    ASSERT_EQ(hits[i].load(), 1) << "index " << i;
+  }
+}
+
+TEST_P(ParallelForTestWithBound, EmptyRange) {
+  std::atomic<int> calls{0};
+  marl::parallel_for(10, 10, [&](size_t) { ++calls; });
+  marl::parallel_for(10, 5, [&](size_t) { ++calls; });
+  ASSERT_EQ(calls.load(), 0);
+}
+
+TEST_P(ParallelForTestWithBound, FixedGrain) {
+  constexpr size_t Begin = 7;
+  constexpr size_t End = 10007;
+  for (size_t grain : {1, 3, 1000, 100000}) {
+    std::atomic<size_t> sum{0};
+    std::atomic<size_t> count{0};
+    marl::parallel_for(Begin, End, [&](size_t i) {
+      sum += i;
+      ++count;
+    }, grain);
+    ASSERT_EQ(count.load(), End - Begin);
+    ASSERT_EQ(sum.load(), (Begin + End - 1) * (End - Begin) / 2);
+  }
+}
+
+TEST_P(ParallelForTestWithBound, Skewed) {
+  // 开销集中在前几个元素上
+  constexpr size_t N = 1000;
+  std::vector<std::atomic<int>> hits(N);
+  marl::parallel_for(0, N, [&](size_t i) {
+    if (i < 4) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    ++hits[i];
+  }, 1);
+  for (size_t i = 0; i < N; ++i) {
+    ASSERT_EQ(hits[i].load(), 1);
+  }
+}
+
+TEST_P(ParallelForTestWithBound, Nested) {
+  constexpr size_t N = 64;
+  std::vector<std::atomic<int>> hits(N * N);
+  marl::parallel_for(0, N, [&](size_t i) {
+    marl::parallel_for(0, N, [&](size_t j) { ++hits[i * N + j]; });
+  }, 1);
+  for (auto &hit : hits) {
+    ASSERT_EQ(hit.load(), 1);
+  }
+}
+
+TEST_P(ParallelForTestWithBound, UsesIdleWorkers) {
+  if (GetParam().num_worker_threads < 2) {
+    GTEST_SKIP() << "需要至少两个工作线程";
+  }
+  // 每个元素都会阻塞一段时间，空闲的工作线程应该会分担其中的一部分
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  marl::parallel_for(0, 64, [&](size_t) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.insert(std::this_thread::get_id());
+  }, 1);
+  ASSERT_GT(threads.size(), 1u);
+}
@@ -0,0 +1,120 @@
+#include "marl/parallel_reduce.hpp"
+
+#include "marl_test.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ParallelReduceTestWithBound : public WithBoundScheduler {};
+INSTANTIATE_WithBoundSchedulerTest(ParallelReduceTestWithBound);
+
+namespace {
+
+auto add = [](uint64_t a, uint64_t b) { return a + b; };
+
+using Histogram = std::array<uint64_t, 16>;
+
+Histogram mergeHistograms(const Histogram &a, const Histogram &b) {
+  Histogram res;
+  for (size_t i = 0; i < res.size(); ++i) {
+    res[i] = a[i] + b[i];
+  }
+  return res;
+}
+
+/// 2x2矩阵乘法满足结合律但不满足交换律
+using Matrix = std::array<uint64_t, 4>;
+
+Matrix multiply(const Matrix &a, const Matrix &b) {
+  return {a[0] * b[0] + a[1] * b[2], a[0] * b[1] + a[1] * b[3],
+          a[2] * b[0] + a[3] * b[2], a[2] * b[1] + a[3] * b[3]};
+}
+
+Matrix element(size_t i) {
+  return {1, i % 7, i % 5, 1};
+}
+
+} // anonymous namespace
+
+TEST_P(ParallelReduceTestWithBound, Sum) {
+  constexpr size_t N = 1000000;
+  for (auto mode : {marl::ReduceMode::Commutative, marl::ReduceMode::Deterministic}) {
+    auto sum = marl::parallel_reduce(0, N, uint64_t(0), [](size_t i) { return uint64_t(i); }, add, mode);
+    ASSERT_EQ(sum, uint64_t(N) * (N - 1) / 2);
+  }
+}
+
+TEST_P(ParallelReduceTestWithBound, EmptyRange) {
+  auto res = marl::parallel_reduce(5, 5, uint64_t(42), [](size_t) { return uint64_t(1); }, add);
+  ASSERT_EQ(res, 42u);
+  res = marl::parallel_reduce(5, 1, uint64_t(42), [](size_t) { return uint64_t(1); }, add,
+                              marl::ReduceMode::Deterministic);
+  ASSERT_EQ(res, 42u);
+}
+
+TEST_P(ParallelReduceTestWithBound, FixedGrain) {
+  constexpr size_t Begin = 3;
+  constexpr size_t End = 10003;
+  for (auto mode : {marl::ReduceMode::Commutative, marl::ReduceMode::Deterministic}) {
+    for (size_t grain : {1, 7, 1000, 100000}) {
+      auto sum = marl::parallel_reduce(Begin, End, uint64_t(0), [](size_t i) { return uint64_t(i); },
+                                       add, mode, grain);
+      ASSERT_EQ(sum, (Begin + End - 1) * (End - Begin) / 2) << "grain " << grain;
+    }
+  }
+}
+
+TEST_P(ParallelReduceTestWithBound, Histogram) {
+  constexpr size_t N = 100000;
+  Histogram empty = {};
+  auto histogram = marl::parallel_reduce(0, N, empty, [](Histogram &acc, size_t i) {
+    ++acc[(i * 2654435761u) % acc.size()];
+  }, mergeHistograms);
+  Histogram expected = {};
+  for (size_t i = 0; i < N; ++i) {
+    ++expected[(i * 2654435761u) % expected.size()];
+  }
+  ASSERT_EQ(histogram, expected);
+}
+
+TEST_P(ParallelReduceTestWithBound, NonCommutative) {
+  constexpr size_t N = 50000;
+  Matrix identity = {1, 0, 0, 1};
+  Matrix expected = identity;
+  for (size_t i = 0; i < N; ++i) {
+    expected = multiply(expected, element(i));
+  }
+  for (size_t grain : {0, 1, 333}) {
+    auto product = marl::parallel_reduce(0, N, identity, element, multiply,
+                                         marl::ReduceMode::Deterministic, grain);
+    ASSERT_EQ(product, expected) << "grain " << grain;
+  }
+
+  // 字符串拼接也满足结合律但不满足交换律
+  auto text = marl::parallel_reduce(0, 26, std::string(), [](std::string &acc, size_t i) {
+    acc += static_cast<char>('a' + i);
+  }, [](const std::string &a, const std::string &b) { return a + b; }, marl::ReduceMode::Deterministic, 1);
+  ASSERT_EQ(text, "abcdefghijklmnopqrstuvwxyz");
+}
+
+TEST_P(ParallelReduceTestWithBound, DeterministicFloat) {
+  // 浮点数加法不满足结合律，Deterministic模式下每次的结果都应该完全相同
+  constexpr size_t N = 200000;
+  auto map = [](size_t i) { return 1.0 / static_cast<double>(i + 1); };
+  auto plus = [](double a, double b) { return a + b; };
+  auto first = marl::parallel_reduce(0, N, 0.0, map, plus, marl::ReduceMode::Deterministic);
+  for (int run = 0; run < 10; ++run) {
+    auto res = marl::parallel_reduce(0, N, 0.0, map, plus, marl::ReduceMode::Deterministic);
+    ASSERT_EQ(res, first);
+  }
+}
+
+TEST_P(ParallelReduceTestWithBound, Nested) {
+  constexpr size_t N = 64;
+  auto sum = marl::parallel_reduce(0, N, uint64_t(0), [](size_t i) {
+    return marl::parallel_reduce(0, N, uint64_t(0), [i](size_t j) { return uint64_t(i * N + j); }, add);
+  }, add, marl::ReduceMode::Commutative, 1);
+  ASSERT_EQ(sum, uint64_t(N * N) * (N * N - 1) / 2);
+}
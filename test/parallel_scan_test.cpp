@@ -0,0 +1,107 @@
+#include "marl/parallel_scan.hpp"
+
+#include "marl_test.hpp"
+
+#include <array>
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <vector>
+
+class ParallelScanTestWithBound : public WithBoundScheduler {};
+INSTANTIATE_WithBoundSchedulerTest(ParallelScanTestWithBound);
+
+namespace {
+
+auto add = [](uint64_t a, uint64_t b) { return a + b; };
+
+std::vector<uint64_t> input(size_t n) {
+  std::vector<uint64_t> in(n);
+  for (size_t i = 0; i < n; ++i) {
+    in[i] = (i * 2654435761u) % 1000;
+  }
+  return in;
+}
+
+} // anonymous namespace
+
+TEST_P(ParallelScanTestWithBound, Inclusive) {
+  auto in = input(1000003);
+  std::vector<uint64_t> expected(in.size());
+  std::inclusive_scan(in.begin(), in.end(), expected.begin());
+  std::vector<uint64_t> out(in.size());
+  marl::parallel_scan(in.begin(), in.end(), out.begin(), uint64_t(0), add);
+  ASSERT_EQ(out, expected);
+}
+
+TEST_P(ParallelScanTestWithBound, Exclusive) {
+  auto in = input(1000003);
+  std::vector<uint64_t> expected(in.size());
+  std::exclusive_scan(in.begin(), in.end(), expected.begin(), uint64_t(0));
+  std::vector<uint64_t> out(in.size());
+  marl::parallel_scan(in.begin(), in.end(), out.begin(), uint64_t(0), add, marl::ScanMode::Exclusive);
+  ASSERT_EQ(out, expected);
+}
+
+TEST_P(ParallelScanTestWithBound, BlockSizes) {
+  for (size_t n : {1, 2, 100, 1025}) {
+    auto in = input(n);
+    std::vector<uint64_t> inclusive(n), exclusive(n);
+    std::inclusive_scan(in.begin(), in.end(), inclusive.begin());
+    std::exclusive_scan(in.begin(), in.end(), exclusive.begin(), uint64_t(0));
+    for (size_t block : {1, 3, 64, 1024, 4096}) {
+      std::vector<uint64_t> out(n);
+      marl::parallel_scan(in.begin(), in.end(), out.begin(), uint64_t(0), add,
+                          marl::ScanMode::Inclusive, block);
+      ASSERT_EQ(out, inclusive) << "n " << n << " block " << block;
+      marl::parallel_scan(in.begin(), in.end(), out.begin(), uint64_t(0), add,
+                          marl::ScanMode::Exclusive, block);
+      ASSERT_EQ(out, exclusive) << "n " << n << " block " << block;
+    }
+  }
+}
+
+TEST_P(ParallelScanTestWithBound, EmptyRange) {
+  std::vector<uint64_t> in, out;
+  marl::parallel_scan(in.begin(), in.end(), out.begin(), uint64_t(0), add);
+  ASSERT_TRUE(out.empty());
+}
+
+TEST_P(ParallelScanTestWithBound, InPlace) {
+  auto in = input(100000);
+  std::vector<uint64_t> expected(in.size());
+  std::exclusive_scan(in.begin(), in.end(), expected.begin(), uint64_t(0));
+  marl::parallel_scan(in.data(), in.data() + in.size(), in.data(), uint64_t(0), add,
+                      marl::ScanMode::Exclusive, 1000);
+  ASSERT_EQ(in, expected);
+}
+
+TEST_P(ParallelScanTestWithBound, NonCommutative) {
+  // 字符串拼接满足结合律但不满足交换律
+  std::vector<std::string> in;
+  std::string expected;
+  for (int i = 0; i < 500; ++i) {
+    in.push_back(std::to_string(i) + ",");
+  }
+  std::vector<std::string> out(in.size());
+  marl::parallel_scan(in.begin(), in.end(), out.begin(), std::string(),
+                      [](const std::string &a, const std::string &b) { return a + b; },
+                      marl::ScanMode::Inclusive, 7);
+  for (size_t i = 0; i < in.size(); ++i) {
+    expected += in[i];
+    ASSERT_EQ(out[i], expected);
+  }
+}
+
+TEST_P(ParallelScanTestWithBound, Max) {
+  auto in = input(100000);
+  std::vector<uint64_t> out(in.size());
+  marl::parallel_scan(in.begin(), in.end(), out.begin(), uint64_t(0),
+                      [](uint64_t a, uint64_t b) { return std::max(a, b); },
+                      marl::ScanMode::Inclusive, 100);
+  uint64_t expected = 0;
+  for (size_t i = 0; i < in.size(); ++i) {
+    expected = std::max(expected, in[i]);
+    ASSERT_EQ(out[i], expected);
+  }
+}
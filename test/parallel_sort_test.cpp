@@ -0,0 +1,95 @@
+#include "marl/parallel_sort.hpp"
+
+#include "marl_test.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+class ParallelSortTestWithBound : public WithBoundScheduler {};
+INSTANTIATE_WithBoundSchedulerTest(ParallelSortTestWithBound);
+
+namespace {
+
+template<typename T>
+std::vector<T> randomKeys(size_t n, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  std::vector<T> keys(n);
+  for (auto &key : keys) {
+    key = static_cast<T>(rng());
+  }
+  return keys;
+}
+
+/// 分别用parallel_sort()和std::sort()排序keys，比较两者的结果
+template<typename T, typename... Compare>
+void checkSort(std::vector<T> keys, Compare... comp) {
+  auto expected = keys;
+  std::sort(expected.begin(), expected.end(), comp...);
+  marl::parallel_sort(keys.begin(), keys.end(), comp...);
+  ASSERT_EQ(keys, expected);
+}
+
+} // anonymous namespace
+
+TEST_P(ParallelSortTestWithBound, RadixUnsigned) {
+  checkSort(randomKeys<uint32_t>(300000, 1));
+  checkSort(randomKeys<uint64_t>(300000, 2));
+  checkSort(randomKeys<uint8_t>(100000, 3));
+}
+
+TEST_P(ParallelSortTestWithBound, RadixSigned) {
+  checkSort(randomKeys<int32_t>(300000, 4));
+  checkSort(randomKeys<int64_t>(300000, 5));
+  checkSort(randomKeys<int16_t>(100000, 6));
+}
+
+TEST_P(ParallelSortTestWithBound, RadixSkippedDigits) {
+  // 只有低位不同，高位的几趟都会被跳过
+  auto keys = randomKeys<uint64_t>(200000, 7);
+  for (auto &key : keys) {
+    key = 0x1234000000000000ull | (key & 0xfff);
+  }
+  checkSort(keys);
+  // 所有键都相同
+  checkSort(std::vector<int32_t>(100000, -3));
+}
+
+TEST_P(ParallelSortTestWithBound, MergeSort) {
+  checkSort(randomKeys<uint32_t>(300000, 8), std::greater<>());
+  checkSort(randomKeys<double>(300000, 9), std::less<>());
+}
+
+TEST_P(ParallelSortTestWithBound, Strings) {
+  // std::string不是平凡的类型，临时缓冲区中的元素需要被构造和析构
+  auto numbers = randomKeys<uint32_t>(100000, 10);
+  std::vector<std::string> strings;
+  for (auto number : numbers) {
+    strings.push_back(std::to_string(number % 50000));
+  }
+  checkSort(strings);
+}
+
+TEST_P(ParallelSortTestWithBound, Patterns) {
+  constexpr size_t N = 200000;
+  std::vector<int64_t> sorted(N), reversed(N), sawtooth(N);
+  for (size_t i = 0; i < N; ++i) {
+    sorted[i] = static_cast<int64_t>(i);
+    reversed[i] = static_cast<int64_t>(N - i);
+    sawtooth[i] = static_cast<int64_t>(i % 1000);
+  }
+  for (auto &keys : {sorted, reversed, sawtooth}) {
+    checkSort(keys);
+    checkSort(keys, std::less<>());
+  }
+}
+
+TEST_P(ParallelSortTestWithBound, SmallInputs) {
+  for (size_t n : {0, 1, 2, 17, 16384, 16385}) {
+    checkSort(randomKeys<int32_t>(n, n));
+    checkSort(randomKeys<int32_t>(n, n), std::greater<>());
+  }
+}
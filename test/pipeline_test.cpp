@@ -0,0 +1,182 @@
+#include "marl/pipeline.hpp"
+
+#include "marl_test.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+class PipelineTestWithBound : public WithBoundScheduler {};
+INSTANTIATE_WithBoundSchedulerTest(PipelineTestWithBound);
+
+namespace {
+
+/// 返回依次产生[0, n)的源阶段
+auto counter(int n) {
+  return [i = 0, n]() mutable -> std::optional<int> {
+    if (i == n) {
+      return std::nullopt;
+    }
+    return i++;
+  };
+}
+
+/// 使开销随元素变化，让token在并行阶段中乱序
+int jitter(int x) {
+  if (x % 7 == 0) {
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+  return x;
+}
+
+} // anonymous namespace
+
+TEST_P(PipelineTestWithBound, Ordered) {
+  constexpr int N = 2000;
+  std::vector<int> out;
+  marl::Pipeline pipeline(16);
+  pipeline.source(counter(N))
+      .then(marl::StageMode::Parallel, [](int &&x) { return jitter(x) * 2; })
+      .sink(marl::StageMode::Serial, [&](int &&x) { out.push_back(x); });
+  pipeline.run();
+  ASSERT_EQ(out.size(), size_t(N));
+  for (int i = 0; i < N; ++i) {
+    ASSERT_EQ(out[i], i * 2);
+  }
+}
+
+TEST_P(PipelineTestWithBound, Unordered) {
+  constexpr int N = 2000;
+  std::vector<int> out;
+  marl::Pipeline pipeline(16, marl::PipelineOrder::Unordered);
+  pipeline.source(counter(N))
+      .then(marl::StageMode::Parallel, [](int &&x) { return jitter(x); })
+      .sink(marl::StageMode::Serial, [&](int &&x) { out.push_back(x); });
+  pipeline.run();
+  std::sort(out.begin(), out.end());
+  ASSERT_EQ(out.size(), size_t(N));
+  for (int i = 0; i < N; ++i) {
+    ASSERT_EQ(out[i], i);
+  }
+}
+
+TEST_P(PipelineTestWithBound, BoundedTokens) {
+  // 汇阶段很慢，源阶段最多领先max_tokens个数据
+  constexpr int N = 300;
+  constexpr size_t MaxTokens = 4;
+  std::atomic<int> in_flight{0};
+  std::atomic<int> max_in_flight{0};
+  marl::Pipeline pipeline(MaxTokens);
+  pipeline.source([&, next = counter(N)]() mutable {
+        auto item = next();
+        if (item) {
+          auto n = ++in_flight;
+          auto prev = max_in_flight.load();
+          while (n > prev && !max_in_flight.compare_exchange_weak(prev, n)) {}
+        }
+        return item;
+      })
+      .then(marl::StageMode::Parallel, [](int &&x) { return x; })
+      .sink(marl::StageMode::Serial, [&](int &&) {
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+        --in_flight;
+      });
+  pipeline.run();
+  ASSERT_EQ(in_flight.load(), 0);
+  ASSERT_LE(max_in_flight.load(), int(MaxTokens));
+  ASSERT_GT(pipeline.stageStats(2).utilization, 0.0);
+}
+
+TEST_P(PipelineTestWithBound, SerialStageIsExclusive) {
+  constexpr int N = 1000;
+  for (auto order : {marl::PipelineOrder::Ordered, marl::PipelineOrder::Unordered}) {
+    std::atomic<int> inside{0};
+    std::atomic<bool> overlapped{false};
+    int next = 0;
+    bool in_order = true;
+    marl::Pipeline pipeline(32, order);
+    pipeline.source(counter(N))
+        .then(marl::StageMode::Parallel, [](int &&x) { return jitter(x); })
+        .then(marl::StageMode::Serial, [&](int &&x) {
+          if (++inside != 1) {
+            overlapped = true;
+          }
+          in_order &= x == next++;
+          --inside;
+          return x;
+        })
+        .sink(marl::StageMode::Parallel, [](int &&) {});
+    pipeline.run();
+    ASSERT_FALSE(overlapped);
+    ASSERT_EQ(next, N);
+    if (order == marl::PipelineOrder::Ordered) {
+      ASSERT_TRUE(in_order);
+    }
+  }
+}
+
+TEST_P(PipelineTestWithBound, TypesAndMoveOnly) {
+  constexpr int N = 500;
+  std::vector<std::string> out;
+  marl::Pipeline pipeline(8);
+  pipeline.source(counter(N))
+      .then(marl::StageMode::Parallel, [](int &&x) { return std::make_unique<int>(x); })
+      .then(marl::StageMode::Serial, [](std::unique_ptr<int> &&p) { return std::to_string(*p); })
+      .sink(marl::StageMode::Serial, [&](std::string &&s) { out.push_back(std::move(s)); });
+  pipeline.run();
+  ASSERT_EQ(out.size(), size_t(N));
+  for (int i = 0; i < N; ++i) {
+    ASSERT_EQ(out[i], std::to_string(i));
+  }
+}
+
+TEST_P(PipelineTestWithBound, Stats) {
+  constexpr int N = 1000;
+  int next = 0;
+  marl::Pipeline pipeline(8);
+  pipeline.source([&]() -> std::optional<int> {
+        if (next == N) {
+          return std::nullopt;
+        }
+        return next++;
+      })
+      .then(marl::StageMode::Parallel, [](int &&x) { return x + 1; })
+      .sink(marl::StageMode::Serial, [](int &&) {});
+  ASSERT_EQ(pipeline.numStages(), 3u);
+  // 可以多次运行，统计数据只包含最近一次运行
+  for (int run = 0; run < 2; ++run) {
+    next = 0;
+    pipeline.run();
+    ASSERT_GT(pipeline.elapsed().count(), 0);
+    for (size_t stage = 0; stage < pipeline.numStages(); ++stage) {
+      auto stats = pipeline.stageStats(stage);
+      ASSERT_EQ(stats.items, uint64_t(N)) << "stage " << stage;
+      ASSERT_GT(stats.throughput, 0.0);
+    }
+  }
+}
+
+TEST_P(PipelineTestWithBound, EmptySource) {
+  int calls = 0;
+  marl::Pipeline pipeline(4);
+  pipeline.source(counter(0))
+      .sink(marl::StageMode::Serial, [&](int &&) { ++calls; });
+  pipeline.run();
+  ASSERT_EQ(calls, 0);
+  ASSERT_EQ(pipeline.stageStats(0).items, 0u);
+}
+
+TEST_P(PipelineTestWithBound, SingleToken) {
+  constexpr int N = 100;
+  std::vector<int> out;
+  marl::Pipeline pipeline(1, marl::PipelineOrder::Unordered);
+  pipeline.source(counter(N))
+      .then(marl::StageMode::Parallel, [](int &&x) { return x; })
+      .sink(marl::StageMode::Serial, [&](int &&x) { out.push_back(x); });
+  pipeline.run();
+  ASSERT_EQ(out.size(), size_t(N));
+  ASSERT_TRUE(std::is_sorted(out.begin(), out.end()));
+}
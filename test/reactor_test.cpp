@@ -0,0 +1,384 @@
+#include "marl/reactor.hpp"
+
+#include "marl_test.hpp"
+
+#include "marl/defer.hpp"
+#include "marl/scheduler.hpp"
+#include "marl/wait_group.hpp"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/// 一对非阻塞的Unix domain socket，析构时关闭
+class SocketPair {
+ public:
+  SocketPair() {
+    auto res = socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds_);
+    EXPECT_EQ(res, 0);
+  }
+  ~SocketPair() {
+    close(fds_[0]);
+    close(fds_[1]);
+  }
+
+  SocketPair(const SocketPair &) = delete;
+  SocketPair &operator=(const SocketPair &) = delete;
+
+  [[nodiscard]] int first() const { return fds_[0]; }
+  [[nodiscard]] int second() const { return fds_[1]; }
+
+ private:
+  int fds_[2] = {-1, -1};
+};
+
+/// 读取恰好len字节
+bool readAll(int fd, char *buf, size_t len) {
+  while (len > 0) {
+    auto res = marl::net::read(fd, buf, len);
+    if (res <= 0) {
+      return false;
+    }
+    buf += res;
+    len -= static_cast<size_t>(res);
+  }
+  return true;
+}
+
+/// 写入恰好len字节
+bool writeAll(int fd, const char *buf, size_t len) {
+  while (len > 0) {
+    auto res = marl::net::write(fd, buf, len);
+    if (res <= 0) {
+      return false;
+    }
+    buf += res;
+    len -= static_cast<size_t>(res);
+  }
+  return true;
+}
+
+} // anonymous namespace
+
+class ReactorTestWithBound : public WithBoundScheduler {};
+
+INSTANTIATE_WithBoundSchedulerTest(ReactorTestWithBound);
+
+TEST_P(ReactorTestWithBound, PingPong) {
+  constexpr int N = 1000;
+  SocketPair sockets;
+  marl::WaitGroup wg(2);
+  marl::schedule([&, wg] {
+    defer(wg.done());
+    for (int i = 0; i < N; ++i) {
+      int value = -1;
+      ASSERT_TRUE(readAll(sockets.second(), reinterpret_cast<char *>(&value), sizeof(value)));
+      ASSERT_EQ(value, i);
+      ++value;
+      ASSERT_TRUE(writeAll(sockets.second(), reinterpret_cast<char *>(&value), sizeof(value)));
+    }
+  });
+  marl::schedule([&, wg] {
+    defer(wg.done());
+    for (int i = 0; i < N; ++i) {
+      int value = i;
+      ASSERT_TRUE(writeAll(sockets.first(), reinterpret_cast<char *>(&value), sizeof(value)));
+      ASSERT_TRUE(readAll(sockets.first(), reinterpret_cast<char *>(&value), sizeof(value)));
+      ASSERT_EQ(value, i + 1);
+    }
+  });
+  wg.wait();
+}
+
+TEST_P(ReactorTestWithBound, PipeBackpressure) {
+  // 写入的数据远大于pipe的缓冲区，写者需要等待读者
+  constexpr size_t Size = 4 * 1024 * 1024;
+  int fds[2];
+  ASSERT_EQ(pipe2(fds, O_NONBLOCK | O_CLOEXEC), 0);
+  std::vector<char> data(Size), out(Size);
+  for (size_t i = 0; i < Size; ++i) {
+    data[i] = static_cast<char>(i * 7);
+  }
+  marl::WaitGroup wg(2);
+  marl::schedule([&, wg] {
+    defer(wg.done());
+    EXPECT_TRUE(writeAll(fds[1], data.data(), data.size()));
+    close(fds[1]);
+  });
+  marl::schedule([&, wg] {
+    defer(wg.done());
+    EXPECT_TRUE(readAll(fds[0], out.data(), out.size()));
+    char c;
+    EXPECT_EQ(marl::net::read(fds[0], &c, 1), 0);  // 写端已经关闭
+  });
+  wg.wait();
+  close(fds[0]);
+  ASSERT_EQ(out, data);
+}
+
+TEST_P(ReactorTestWithBound, ManyFds) {
+  constexpr int N = 64;
+  std::vector<SocketPair> sockets(N);
+  marl::WaitGroup wg(2 * N);
+  for (int i = 0; i < N; ++i) {
+    marl::schedule([&, i, wg] {
+      defer(wg.done());
+      char c = 0;
+      EXPECT_EQ(marl::net::read(sockets[i].second(), &c, 1), 1);
+      EXPECT_EQ(c, static_cast<char>(i));
+    });
+  }
+  // 逆序写入，使读者被乱序唤醒
+  for (int i = N - 1; i >= 0; --i) {
+    marl::schedule([&, i, wg] {
+      defer(wg.done());
+      auto c = static_cast<char>(i);
+      EXPECT_EQ(marl::net::write(sockets[i].first(), &c, 1), 1);
+    });
+  }
+  wg.wait();
+}
+
+TEST_P(ReactorTestWithBound, ReaderAndWriterOnSameFd) {
+  // 先填满发送缓冲区，使同一个fd上同时有等待可读和等待可写的fiber
+  SocketPair sockets;
+  std::vector<char> block(64 * 1024, 'x');
+  size_t filled = 0;
+  while (true) {
+    auto res = ::write(sockets.first(), block.data(), block.size());
+    if (res < 0) {
+      break;
+    }
+    filled += static_cast<size_t>(res);
+  }
+  marl::WaitGroup wg(3);
+  marl::schedule([&, wg] {
+    defer(wg.done());
+    char c = 0;
+    EXPECT_EQ(marl::net::read(sockets.first(), &c, 1), 1);
+    EXPECT_EQ(c, 'y');
+  });
+  marl::schedule([&, wg] {
+    defer(wg.done());
+    char c = 'z';
+    EXPECT_EQ(marl::net::write(sockets.first(), &c, 1), 1);
+  });
+  marl::schedule([&, wg] {
+    defer(wg.done());
+    // 读空first()发送的所有数据，然后回复一个字节
+    std::vector<char> out(filled + 1);
+    EXPECT_TRUE(readAll(sockets.second(), out.data(), out.size()));
+    EXPECT_EQ(out.back(), 'z');
+    char c = 'y';
+    EXPECT_EQ(marl::net::write(sockets.second(), &c, 1), 1);
+  });
+  wg.wait();
+}
+
+TEST_P(ReactorTestWithBound, Timeout) {
+  SocketPair sockets;
+  marl::WaitGroup wg(1);
+  marl::schedule([&, wg] {
+    defer(wg.done());
+    auto timeout = timeLater(std::chrono::milliseconds(10));
+    EXPECT_EQ(marl::net::waitReadable(sockets.first(), &timeout), -ETIMEDOUT);
+    EXPECT_GE(std::chrono::system_clock::now(), timeout);
+    // 超时之后fd仍然可以正常使用
+    char c = 'a';
+    EXPECT_EQ(marl::net::write(sockets.second(), &c, 1), 1);
+    timeout = timeLater(std::chrono::seconds(10));
+    EXPECT_EQ(marl::net::waitReadable(sockets.first(), &timeout), 0);
+    EXPECT_EQ(marl::net::waitWritable(sockets.first(), &timeout), 0);
+  });
+  wg.wait();
+}
+
+TEST_P(ReactorTestWithBound, FdReusedAfterTimeout) {
+  marl::WaitGroup wg(1);
+  marl::schedule([&, wg] {
+    defer(wg.done());
+    int fd;
+    {
+      SocketPair sockets;
+      fd = dup(sockets.first());
+      auto timeout = timeLater(std::chrono::milliseconds(10));
+      EXPECT_EQ(marl::net::waitReadable(fd, &timeout), -ETIMEDOUT);
+      // 关闭之后epoll会移除fd原本的注册
+      close(fd);
+    }
+    // 同一个fd编号被复用为另一个socket，之前超时留下的监听状态不能使新的等待者跳过注册
+    SocketPair sockets;
+    EXPECT_EQ(dup2(sockets.first(), fd), fd);
+    char c = 'a';
+    EXPECT_EQ(marl::net::write(sockets.second(), &c, 1), 1);
+    auto timeout = timeLater(std::chrono::seconds(5));
+    EXPECT_EQ(marl::net::waitReadable(fd, &timeout), 0);
+    close(fd);
+  });
+  wg.wait();
+}
+
+TEST_P(ReactorTestWithBound, Loopback) {
+  auto listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  ASSERT_GE(listener, 0);
+  defer(close(listener));
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  ASSERT_EQ(bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), 0);
+  socklen_t len = sizeof(addr);
+  ASSERT_EQ(getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &len), 0);
+  ASSERT_EQ(listen(listener, 16), 0);
+
+  constexpr int N = 8;
+  marl::WaitGroup wg(N + 1);
+  marl::schedule([&, wg] {
+    defer(wg.done());
+    // 回显每个连接收到的数据
+    for (int i = 0; i < N; ++i) {
+      auto fd = marl::net::accept(listener);
+      ASSERT_GE(fd, 0);
+      marl::schedule([fd, wg] {
+        defer(wg.done());
+        char buf[64];
+        ssize_t res;
+        while ((res = marl::net::read(fd, buf, sizeof(buf))) > 0) {
+          EXPECT_TRUE(writeAll(fd, buf, static_cast<size_t>(res)));
+        }
+        EXPECT_EQ(res, 0);
+        close(fd);
+      });
+    }
+  });
+
+  marl::WaitGroup clients(N);
+  for (int i = 0; i < N; ++i) {
+    marl::schedule([&, i, clients] {
+      defer(clients.done());
+      auto fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+      ASSERT_GE(fd, 0);
+      defer(close(fd));
+      ASSERT_EQ(marl::net::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), 0);
+      auto message = "hello " + std::to_string(i);
+      ASSERT_TRUE(writeAll(fd, message.data(), message.size()));
+      std::string reply(message.size(), '\0');
+      ASSERT_TRUE(readAll(fd, &reply[0], reply.size()));
+      EXPECT_EQ(reply, message);
+      shutdown(fd, SHUT_WR);
+    });
+  }
+  clients.wait();
+  wg.wait();
+}
+
+TEST_P(ReactorTestWithBound, ConnectRefused) {
+  // 先绑定一个端口再关闭，得到一个没有监听的端口
+  auto fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  ASSERT_GE(fd, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), 0);
+  socklen_t len = sizeof(addr);
+  ASSERT_EQ(getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len), 0);
+  close(fd);
+
+  marl::WaitGroup wg(1);
+  marl::schedule([&, wg] {
+    defer(wg.done());
+    auto client = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    ASSERT_GE(client, 0);
+    defer(close(client));
+    EXPECT_EQ(marl::net::connect(client, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)),
+              -ECONNREFUSED);
+  });
+  wg.wait();
+}
+
+TEST_P(ReactorTestWithBound, Error) {
+  char c;
+  ASSERT_EQ(marl::net::read(-1, &c, 1), -EBADF);
+  ASSERT_EQ(marl::net::waitReadable(-1), -EBADF);
+}
+
+class ReactorTestWithoutBound : public WithoutBoundScheduler {};
+
+TEST_F(ReactorTestWithoutBound, NoScheduler) {
+  SocketPair sockets;
+  std::thread writer([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    char c = 'a';
+    EXPECT_EQ(marl::net::write(sockets.second(), &c, 1), 1);
+  });
+  char c = 0;
+  EXPECT_EQ(marl::net::read(sockets.first(), &c, 1), 1);
+  EXPECT_EQ(c, 'a');
+  writer.join();
+
+  auto timeout = timeLater(std::chrono::milliseconds(10));
+  EXPECT_EQ(marl::net::waitReadable(sockets.first(), &timeout), -ETIMEDOUT);
+}
+
+TEST_F(ReactorTestWithoutBound, IdleWorkerTakesOverPoll) {
+  // 两个fiber分别在两个Worker上等待fd，其中一个恢复之后长时间占用它的Worker，
+  // 即使这个Worker之前是轮询者，另一个休眠的Worker也需要接替轮询
+  marl::Scheduler::Config cfg;
+  cfg.setAllocator(allocator_).setWorkerThreadCount(2);
+  marl::Scheduler scheduler(cfg);
+  SocketPair busy_sockets;
+  SocketPair idle_sockets;
+  std::atomic<bool> stop{false};
+  std::atomic<std::thread::id> busy_thread{};
+  std::promise<void> busy_started;
+  std::promise<std::chrono::steady_clock::duration> elapsed;
+
+  // 当前线程没有绑定Scheduler，不会在等待时代替工作线程轮询Reactor
+  scheduler.enqueue(marl::Task([&] {
+    busy_thread = std::this_thread::get_id();
+    char c = 0;
+    EXPECT_EQ(marl::net::read(busy_sockets.first(), &c, 1), 1);
+    busy_started.set_value();
+    auto start = std::chrono::steady_clock::now();
+    while (!stop && std::chrono::steady_clock::now() - start < std::chrono::seconds(2)) {
+      std::this_thread::yield();
+    }
+  }));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  // 在另一个Worker上等待，落在同一个Worker上时重新调度
+  std::function<void()> idle_reader = [&] {
+    if (std::this_thread::get_id() == busy_thread.load()) {
+      marl::schedule(idle_reader);
+      return;
+    }
+    // 让busy_thread所在的Worker先重新开始轮询
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto start = std::chrono::steady_clock::now();
+    char c = 0;
+    EXPECT_EQ(marl::net::read(idle_sockets.first(), &c, 1), 1);
+    elapsed.set_value(std::chrono::steady_clock::now() - start);
+  };
+  scheduler.enqueue(marl::Task(idle_reader));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  char c = 'a';
+  ASSERT_EQ(::write(busy_sockets.second(), &c, 1), 1);
+  busy_started.get_future().wait();
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  ASSERT_EQ(::write(idle_sockets.second(), &c, 1), 1);
+  auto duration = elapsed.get_future().get();
+  stop = true;
+  ASSERT_LT(std::chrono::duration_cast<std::chrono::milliseconds>(duration).count(), 1000);
+}
@@ -0,0 +1,90 @@
+#include "marl/sharded_wait_group.hpp"
+
+#include "marl_test.hpp"
+
+#include "marl/defer.hpp"
+#include "marl/wait_group.hpp"
+
+class ShardedWaitGroupTestWithoutBound : public WithoutBoundScheduler {};
+
+class ShardedWaitGroupTestWithBound : public WithBoundScheduler {};
+
+INSTANTIATE_WithBoundSchedulerTest(ShardedWaitGroupTestWithBound)
+
+TEST_F(ShardedWaitGroupTestWithoutBound, Done) {
+  marl::ShardedWaitGroup wg(2, allocator_);  // 不需要在scheduler环境下运行
+  EXPECT_FALSE(wg.done());
+  EXPECT_TRUE(wg.done());
+  wg.wait();
+}
+
+TEST_F(ShardedWaitGroupTestWithoutBound, DoneTooMany) {
+  marl::ShardedWaitGroup wg(2, allocator_);
+  wg.done();
+  wg.done();
+  EXPECT_DEATH(wg.done(), "done\\(\\) called too many times");
+}
+
+TEST_F(ShardedWaitGroupTestWithoutBound, Reuse) {
+  marl::ShardedWaitGroup wg(0, allocator_);
+  for (int round = 0; round < 3; ++round) {
+    wg.add(1000);
+    int zeros = 0;
+    for (int i = 0; i < 1000; ++i) {
+      zeros += wg.done() ? 1 : 0;
+    }
+    EXPECT_EQ(zeros, 1);
+    wg.wait();
+  }
+}
+
+TEST_P(ShardedWaitGroupTestWithBound, OneTask) {
+  marl::ShardedWaitGroup wg(1, allocator_);
+  std::atomic<int> counter{0};
+  marl::schedule([&counter, wg] {
+    ++counter;
+    wg.done();
+  });
+  wg.wait();
+  EXPECT_EQ(counter.load(), 1);
+}
+
+TEST_P(ShardedWaitGroupTestWithBound, ManyTasks) {
+  constexpr int num_tasks = 10000;
+  marl::ShardedWaitGroup wg(num_tasks, allocator_);
+  marl::WaitGroup finished(num_tasks);
+  std::atomic<int> counter{0};
+  std::atomic<int> zeros{0};
+  for (int i = 0; i < num_tasks; i++) {
+    marl::schedule([&counter, &zeros, wg, finished] {
+      defer(finished.done());
+      counter++;
+      if (wg.done()) {
+        zeros++;
+      }
+    });
+  }
+  wg.wait();
+  ASSERT_EQ(counter.load(), num_tasks);
+  finished.wait();
+  ASSERT_EQ(zeros.load(), 1);
+}
+
+TEST_P(ShardedWaitGroupTestWithBound, NestedAdd) {
+  marl::ShardedWaitGroup wg(10, allocator_);
+  std::atomic<int> counter{0};
+  for (int i = 0; i < 10; i++) {
+    marl::schedule([&counter, wg] {
+      defer(wg.done());
+      wg.add(100);
+      for (int j = 0; j < 100; j++) {
+        marl::schedule([&counter, wg] {
+          counter++;
+          wg.done();
+        });
+      }
+    });
+  }
+  wg.wait();
+  ASSERT_EQ(counter.load(), 1000);
+}
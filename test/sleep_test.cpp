@@ -0,0 +1,88 @@
+#include "marl/sleep.hpp"
+
+#include "marl_test.hpp"
+
+#include "marl/defer.hpp"
+#include "marl/wait_group.hpp"
+
+#include <atomic>
+
+class SleepTestWithBound : public WithBoundScheduler {};
+
+INSTANTIATE_WithBoundSchedulerTest(SleepTestWithBound);
+
+TEST_P(SleepTestWithBound, SleepFor) {
+  marl::WaitGroup wg(1);
+  marl::schedule([wg] {
+    defer(wg.done());
+    auto start = std::chrono::steady_clock::now();
+    marl::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+  });
+  wg.wait();
+}
+
+TEST_P(SleepTestWithBound, SleepUntil) {
+  marl::WaitGroup wg(2);
+  marl::schedule([wg] {
+    defer(wg.done());
+    auto timeout = std::chrono::system_clock::now() + std::chrono::milliseconds(10);
+    marl::sleep_until(timeout);
+    EXPECT_GE(std::chrono::system_clock::now(), timeout);
+  });
+  marl::schedule([wg] {
+    defer(wg.done());
+    auto timeout = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+    marl::sleep_until(timeout);
+    EXPECT_GE(std::chrono::steady_clock::now(), timeout);
+  });
+  wg.wait();
+}
+
+TEST_P(SleepTestWithBound, Zero) {
+  marl::sleep_for(std::chrono::milliseconds(0));
+  marl::sleep_for(std::chrono::milliseconds(-1));
+  marl::sleep_until(std::chrono::system_clock::now() - std::chrono::seconds(1));
+}
+
+TEST_P(SleepTestWithBound, WorkerStaysAvailable) {
+  // 即使只有一个Worker，其他任务也可以在休眠的fiber醒来之前执行完
+  constexpr int N = 100;
+  std::atomic<int> num_done{0};
+  marl::WaitGroup wg(N + 1);
+  marl::schedule([&, wg] {
+    defer(wg.done());
+    marl::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(num_done.load(), N);
+  });
+  for (int i = 0; i < N; ++i) {
+    marl::schedule([&, wg] {
+      defer(wg.done());
+      ++num_done;
+    });
+  }
+  wg.wait();
+}
+
+TEST_P(SleepTestWithBound, ManySleepers) {
+  constexpr int N = 1000;
+  marl::WaitGroup wg(N);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < N; ++i) {
+    marl::schedule([=] {
+      defer(wg.done());
+      marl::sleep_for(std::chrono::milliseconds(1 + i % 10));
+    });
+  }
+  wg.wait();
+  // 所有的fiber同时休眠，总时间远小于休眠时间之和
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+class SleepTestWithoutBound : public WithoutBoundScheduler {};
+
+TEST_F(SleepTestWithoutBound, NoScheduler) {
+  auto start = std::chrono::steady_clock::now();
+  marl::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(10));
+}
@@ -0,0 +1,121 @@
+#include "marl/task_group.hpp"
+
+#include "marl_test.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+class TaskGroupTestWithBound : public WithBoundScheduler {};
+INSTANTIATE_WithBoundSchedulerTest(TaskGroupTestWithBound);
+
+namespace {
+
+uint64_t fib(int n) {
+  if (n < 2) {
+    return static_cast<uint64_t>(n);
+  }
+  uint64_t x = 0;
+  marl::TaskGroup group;
+  group.spawn([&] { x = fib(n - 1); });
+  auto y = fib(n - 2);
+  group.sync();
+  return x + y;
+}
+
+void quicksort(int *first, int *last) {
+  if (last - first <= 64) {
+    std::sort(first, last);
+    return;
+  }
+  auto pivot = first[(last - first) / 2];
+  auto lt = std::partition(first, last, [pivot](int x) { return x < pivot; });
+  auto gt = std::partition(lt, last, [pivot](int x) { return !(pivot < x); });
+  marl::TaskGroup group;
+  group.spawn([=] { quicksort(first, lt); });
+  quicksort(gt, last);
+}
+
+} // anonymous namespace
+
+TEST_P(TaskGroupTestWithBound, Fib) {
+  ASSERT_EQ(fib(20), 6765U);
+}
+
+TEST_P(TaskGroupTestWithBound, QuickSort) {
+  std::mt19937 rng(1);
+  std::vector<int> keys(200000);
+  for (auto &key : keys) {
+    key = static_cast<int>(rng() % 50000);
+  }
+  auto expected = keys;
+  std::sort(expected.begin(), expected.end());
+  quicksort(keys.data(), keys.data() + keys.size());
+  ASSERT_EQ(keys, expected);
+}
+
+TEST_P(TaskGroupTestWithBound, EmptyAndReuse) {
+  marl::TaskGroup group;
+  group.sync();
+  std::atomic<int> counter = {0};
+  for (int round = 0; round < 10; ++round) {
+    for (int i = 0; i < 4; ++i) {
+      group.spawn([&] { ++counter; });
+    }
+    group.sync();
+    ASSERT_EQ(counter.load(), (round + 1) * 4);
+  }
+  group.spawn([&] { ++counter; });
+  // 析构时隐式地sync()
+}
+
+TEST_P(TaskGroupTestWithBound, ManySpawns) {
+  // 超出内部空间的子任务从Allocator中分配，由TearDown()检查是否全部被释放
+  constexpr int N = 1000;
+  std::atomic<uint64_t> sum = {0};
+  {
+    marl::TaskGroup group;
+    for (int i = 0; i < N; ++i) {
+      std::array<uint64_t, 8> payload = {};
+      payload[7] = static_cast<uint64_t>(i);
+      group.spawn([&sum, payload] { sum += payload[7]; });
+    }
+  }
+  ASSERT_EQ(sum.load(), uint64_t(N) * (N - 1) / 2);
+}
+
+TEST_P(TaskGroupTestWithBound, StolenChildren) {
+  // 子任务阻塞时，其余的子任务被其他工作线程窃取，sync()必须等待它们全部完成
+  constexpr int N = 32;
+  std::vector<std::atomic<bool>> finished(N);
+  marl::TaskGroup group;
+  for (int i = 0; i < N; ++i) {
+    group.spawn([&, i] {
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      finished[i] = true;
+    });
+  }
+  group.sync();
+  for (int i = 0; i < N; ++i) {
+    ASSERT_TRUE(finished[i]);
+  }
+}
+
+TEST_P(TaskGroupTestWithBound, SyncRunsChildrenInline) {
+  if (GetParam().num_worker_threads > 0) {
+    return;
+  }
+  // 没有工作线程时子任务不会被窃取，sync()在当前fiber上按后进先出的顺序执行它们
+  std::vector<int> order;
+  marl::TaskGroup group;
+  for (int i = 0; i < 4; ++i) {
+    group.spawn([&, i] { order.push_back(i); });
+  }
+  ASSERT_TRUE(order.empty());
+  group.sync();
+  ASSERT_EQ(order, std::vector<int>({3, 2, 1, 0}));
+}
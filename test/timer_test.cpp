@@ -0,0 +1,214 @@
+#include "marl_test.hpp"
+
+#include "marl/defer.hpp"
+#include "marl/event.hpp"
+#include "marl/sleep.hpp"
+#include "marl/wait_group.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TimerTestWithBound : public WithBoundScheduler {
+ public:
+  static marl::Scheduler *scheduler() { return marl::Scheduler::get(); }
+};
+
+INSTANTIATE_WithBoundSchedulerTest(TimerTestWithBound);
+
+TEST_P(TimerTestWithBound, EnqueueAfter) {
+  marl::WaitGroup wg(1);
+  auto start = std::chrono::steady_clock::now();
+  auto timer = scheduler()->enqueueAfter(std::chrono::milliseconds(20), marl::Task([wg] {
+    wg.done();
+  }));
+  ASSERT_TRUE(timer);
+  wg.wait();
+  ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+}
+
+TEST_P(TimerTestWithBound, EnqueueAtPast) {
+  marl::WaitGroup wg(1);
+  scheduler()->enqueueAt(timeLater(-std::chrono::seconds(1)), marl::Task([wg] { wg.done(); }));
+  wg.wait();
+}
+
+TEST_P(TimerTestWithBound, Order) {
+  // 单个Worker上的定时任务按触发时间的顺序执行
+  if (GetParam().num_worker_threads > 1) {
+    GTEST_SKIP() << "定时任务分布在多个Worker上时不保证执行顺序";
+  }
+  constexpr int N = 10;
+  std::mutex mutex;
+  std::vector<int> order;
+  marl::WaitGroup wg(N);
+  auto now = std::chrono::system_clock::now();
+  for (int i = N - 1; i >= 0; --i) {
+    scheduler()->enqueueAt(now + std::chrono::milliseconds(5 * (i + 1)), marl::Task([&, i, wg] {
+      std::unique_lock<std::mutex> lock(mutex);
+      order.push_back(i);
+      wg.done();
+    }));
+  }
+  wg.wait();
+  ASSERT_EQ(order.size(), static_cast<size_t>(N));
+  for (int i = 0; i < N; ++i) {
+    ASSERT_EQ(order[i], i);
+  }
+}
+
+TEST_P(TimerTestWithBound, Cancel) {
+  std::atomic<bool> fired{false};
+  auto timer = scheduler()->enqueueAfter(std::chrono::milliseconds(10), marl::Task([&] {
+    fired = true;
+  }));
+  timer.cancel();
+  // 在被取消任务原本的触发时间之后调度一个任务，确认被取消的任务没有执行
+  marl::WaitGroup wg(1);
+  scheduler()->enqueueAfter(std::chrono::milliseconds(30), marl::Task([wg] { wg.done(); }));
+  wg.wait();
+  ASSERT_FALSE(fired);
+}
+
+TEST_P(TimerTestWithBound, DropHandle) {
+  // 句柄析构时不会取消定时任务
+  marl::WaitGroup wg(1);
+  {
+    auto timer = scheduler()->enqueueAfter(std::chrono::milliseconds(1), marl::Task([wg] {
+      wg.done();
+    }));
+  }
+  wg.wait();
+}
+
+TEST_P(TimerTestWithBound, Periodic) {
+  constexpr int N = 5;
+  std::atomic<int> count{0};
+  marl::Event done;
+  auto timer = scheduler()->enqueuePeriodic(std::chrono::milliseconds(2), marl::Task([&] {
+    if (++count == N) {
+      done.signal();
+    }
+  }));
+  done.wait();
+  timer.cancel();
+  auto fired = count.load();
+  marl::WaitGroup wg(1);
+  scheduler()->enqueueAfter(std::chrono::milliseconds(20), marl::Task([wg] { wg.done(); }));
+  wg.wait();
+  // 取消时可能已经有一次触发在执行，之后不会再触发
+  ASSERT_LE(count.load(), fired + 1);
+}
+
+TEST_P(TimerTestWithBound, PeriodicCancelItself) {
+  constexpr int N = 3;
+  std::atomic<int> count{0};
+  marl::Scheduler::Timer timer;
+  // 等待timer被赋值之后再访问它
+  marl::Event assigned(marl::Event::Mode::Manual);
+  marl::WaitGroup wg(1);
+  timer = scheduler()->enqueuePeriodic(std::chrono::milliseconds(1), marl::Task([&, wg] {
+    assigned.wait();
+    if (++count == N) {
+      timer.cancel();
+      wg.done();
+    }
+  }));
+  assigned.signal();
+  wg.wait();
+  marl::WaitGroup later(1);
+  scheduler()->enqueueAfter(std::chrono::milliseconds(10), marl::Task([later] { later.done(); }));
+  later.wait();
+  ASSERT_EQ(count.load(), N);
+}
+
+TEST_P(TimerTestWithBound, Many) {
+  constexpr int N = 10000;
+  marl::WaitGroup wg(N);
+  auto now = std::chrono::system_clock::now();
+  std::vector<marl::Scheduler::Timer> timers;
+  for (int i = 0; i < N; ++i) {
+    timers.emplace_back(scheduler()->enqueueAt(
+        now + std::chrono::microseconds(i * 3 % 5000), marl::Task([wg] { wg.done(); })));
+  }
+  wg.wait();
+}
+
+TEST_P(TimerTestWithBound, FromTask) {
+  marl::WaitGroup wg(1);
+  marl::schedule([wg] {
+    scheduler()->enqueueAfter(std::chrono::milliseconds(5), marl::Task([wg] { wg.done(); }));
+  });
+  wg.wait();
+}
+
+TEST_P(TimerTestWithBound, DestructWithPendingTimers) {
+  // 尚未触发的定时任务在Scheduler析构时被丢弃，不会泄漏内存（由TearDown()检查）
+  std::atomic<bool> fired{false};
+  scheduler()->enqueueAfter(std::chrono::hours(1), marl::Task([&] { fired = true; }));
+  scheduler()->enqueuePeriodic(std::chrono::hours(1), marl::Task([&] { fired = true; }));
+  ASSERT_FALSE(fired);
+}
+
+TEST_P(TimerTestWithBound, BusyWorker) {
+  // 长时间执行同一个任务的Worker的定时任务由空闲的Worker代为触发
+  auto num_workers = GetParam().num_worker_threads;
+  if (num_workers < 2) {
+    GTEST_SKIP() << "需要至少两个工作线程";
+  }
+  std::atomic<bool> stop{false};
+  marl::WaitGroup spinning(1);
+  marl::schedule([&, spinning] {
+    spinning.done();
+    auto start = std::chrono::steady_clock::now();
+    while (!stop && std::chrono::steady_clock::now() - start < std::chrono::seconds(2)) {
+      std::this_thread::yield();
+    }
+  });
+  spinning.wait();
+  // 定时任务轮流分配给各个Worker，其中一个属于正在忙碌的Worker
+  auto start = std::chrono::steady_clock::now();
+  marl::WaitGroup wg(num_workers);
+  for (int i = 0; i < num_workers; ++i) {
+    scheduler()->enqueueAfter(std::chrono::milliseconds(2), marl::Task([wg] { wg.done(); }));
+  }
+  wg.wait();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  stop = true;
+  ASSERT_LT(elapsed, std::chrono::seconds(1));
+}
+
+TEST_P(TimerTestWithBound, CancelReleasesTasks) {
+  // 被取消的定时任务不需要等到原本的触发时间就会被释放
+  constexpr int N = 10000;
+  auto token = std::make_shared<int>(0);
+  std::vector<marl::Scheduler::Timer> timers;
+  for (int i = 0; i < N; ++i) {
+    timers.emplace_back(scheduler()->enqueueAfter(std::chrono::hours(1), marl::Task([token] {})));
+  }
+  ASSERT_EQ(token.use_count(), N + 1);
+  for (auto &timer : timers) {
+    timer.cancel();
+  }
+  auto start = std::chrono::steady_clock::now();
+  while (token.use_count() > 1 && std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) {
+    marl::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(token.use_count(), 1);
+}
+
+class TimerTestWithoutBound : public WithoutBoundScheduler {};
+
+TEST_F(TimerTestWithoutBound, HandleOutlivesScheduler) {
+  marl::Scheduler::Timer timer;
+  {
+    marl::Scheduler::Config cfg;
+    cfg.setAllocator(allocator_).setWorkerThreadCount(2);
+    marl::Scheduler scheduler(cfg);
+    timer = scheduler.enqueueAfter(std::chrono::hours(1), marl::Task([] {}));
+  }
+  ASSERT_TRUE(timer);
+  timer.cancel();
+}
@@ -44,3 +44,61 @@ TEST_P(WaitGroupTestWithBound, ManyTasks) {
   wg.wait();
   ASSERT_EQ(counter.load(), 10);
 }
+
+TEST_F(WaitGroupTestWithoutBound, UsesAllocator) {
+  marl::WaitGroup wg(1, allocator_);
+  EXPECT_EQ(allocator_->stats().by_usage[int(marl::Allocation::Usage::Create)].count, 1U);
+  wg.done();
+}
+
+TEST_F(WaitGroupTestWithoutBound, InlineNoAllocation) {
+  marl::InlineWaitGroup wg(0, allocator_);
+  wg.add(8);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([ref = wg.ref()] { ref.done(); });
+  }
+  wg.wait();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(allocator_->stats().numAllocations(), 0U);
+}
+
+TEST_F(WaitGroupTestWithoutBound, InlineDoneTooMany) {
+  marl::InlineWaitGroup wg(2);
+  wg.done();
+  wg.done();
+  EXPECT_DEATH(wg.done(), "done\\(\\) called too many times");
+}
+
+TEST_P(WaitGroupTestWithBound, InlineManyTasks) {
+  marl::InlineWaitGroup wg(10);
+  std::atomic<int> counter{0};
+  for (int i = 0; i < 10; i++) {
+    marl::schedule([&counter, ref = wg.ref()] {
+      counter++;
+      ref.done();
+    });
+  }
+  wg.wait();
+  ASSERT_EQ(counter.load(), 10);
+}
+
+TEST_P(WaitGroupTestWithBound, InlineDestroyAfterWait) {
+  // wait()返回后立即销毁InlineWaitGroup，done()不能再访问它
+  for (int i = 0; i < 100; i++) {
+    std::atomic<int> counter{0};
+    {
+      marl::InlineWaitGroup wg(3);
+      for (int j = 0; j < 3; j++) {
+        marl::schedule([&counter, ref = wg.ref()] {
+          counter++;
+          ref.done();
+        });
+      }
+      wg.wait();
+    }
+    ASSERT_EQ(counter.load(), 3);
+  }
+}